@@ -2,10 +2,12 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <functional>
 #include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -24,6 +26,18 @@ Refer to https://skyzh.github.io/mini-lsm/week1-03-block.html for memory layout
 |key_len (2B)|key(keylen)|val_len(2B)|val(vallen)|tranc_id(8B)| ... |
 ---------------------------------------------------------------------
 
+可选的哈希索引 (类似 RocksDB 的 kDataBlockBinaryAndHash) 位于 Offset Section
+之后, 此时 num_of_elements 的最高位被置为 1:
+-------------------------------------------------------------------------------
+| Offset Section | Bucket#1 | ... | Bucket#M | num_buckets (2B) | num (2B)    |
+-------------------------------------------------------------------------------
+每个 Bucket(2B) 记录哈希到该桶的 key 的第一个版本的 entry 索引,
+HASH_BUCKET_EMPTY 表示没有 key 落在该桶, HASH_BUCKET_COLLISION 表示有多个
+不同的 key 落在该桶, 需要回退到二分查找
+
+通过 decode_view 解码的 block 不拷贝数据, 直接引用编码后的内存 (通常是 sst
+文件的 mmap 映射), Offset Section 和哈希索引也在原处读取
+
 */
 
 namespace tiny_lsm {
@@ -35,8 +49,63 @@ class Block : public std::enable_shared_from_this<Block> {
 private:
   std::vector<uint8_t> data;
   std::vector<uint16_t> offsets;
+  std::vector<uint16_t> hash_buckets; // 为空表示没有哈希索引
   size_t capacity;
 
+  // 视图模式下上面的 vector 均为空, 数据直接从 pin_ 持有的内存中读取
+  bool is_view_ = false;
+  std::shared_ptr<const uint8_t> pin_;
+  const uint8_t *view_data_ = nullptr;
+  size_t view_data_size_ = 0;
+  const uint8_t *view_offsets_ = nullptr;
+  size_t view_num_offsets_ = 0;
+  const uint8_t *view_buckets_ = nullptr;
+  size_t view_num_buckets_ = 0;
+
+  // 屏蔽两种模式差异的访问函数
+  const uint8_t *data_ptr() const {
+    return is_view_ ? view_data_ : data.data();
+  }
+  size_t data_size() const { return is_view_ ? view_data_size_ : data.size(); }
+  size_t num_offsets() const {
+    return is_view_ ? view_num_offsets_ : offsets.size();
+  }
+  uint16_t offset_at(size_t idx) const {
+    if (!is_view_) {
+      return offsets[idx];
+    }
+    uint16_t offset;
+    memcpy(&offset, view_offsets_ + idx * sizeof(uint16_t), sizeof(uint16_t));
+    return offset;
+  }
+  size_t num_buckets() const {
+    return is_view_ ? view_num_buckets_ : hash_buckets.size();
+  }
+  uint16_t bucket_at(size_t idx) const {
+    if (!is_view_) {
+      return hash_buckets[idx];
+    }
+    uint16_t bucket;
+    memcpy(&bucket, view_buckets_ + idx * sizeof(uint16_t), sizeof(uint16_t));
+    return bucket;
+  }
+
+  // 编码后的 block 中各段的位置
+  struct Layout {
+    size_t data_size;
+    size_t num_offsets;
+    size_t buckets_pos;
+    size_t num_buckets;
+  };
+  static Layout parse_layout(const uint8_t *encoded, size_t size,
+                             bool with_hash);
+
+  static constexpr uint16_t HASH_INDEX_FLAG = 0x8000;
+  static constexpr uint16_t HASH_BUCKET_EMPTY = 0xFFFF;
+  static constexpr uint16_t HASH_BUCKET_COLLISION = 0xFFFE;
+  // 桶的利用率, 桶数量 = 不同 key 的数量 / 利用率
+  static constexpr double HASH_INDEX_UTIL_RATIO = 0.75;
+
   struct Entry {
     std::string key;
     std::string value;
@@ -44,23 +113,36 @@ private:
   };
   Entry get_entry_at(size_t offset) const;
   std::string get_key_at(size_t offset) const;
+  // 不拷贝 key, 返回的视图在 block 存活期间有效
+  std::string_view get_key_view_at(size_t offset) const;
   std::string get_value_at(size_t offset) const;
+  std::string_view get_value_view_at(size_t offset) const;
   uint64_t get_tranc_id_at(size_t offset) const;
   int compare_key_at(size_t offset, const std::string &target) const;
 
   // 根据id的可见性调整位置
   int adjust_idx_by_tranc_id(size_t idx, uint64_t tranc_id);
 
-  bool is_same_key(size_t idx, const std::string &target_key) const;
+  bool is_same_key(size_t idx, std::string_view target_key) const;
+
+  // 构建哈希索引的桶数组
+  std::vector<uint16_t> build_hash_buckets() const;
+  // 通过哈希索引查找, 桶冲突时 fallback 被置为 true
+  std::optional<size_t> get_idx_hash(const std::string &key, uint64_t tranc_id,
+                                     bool &fallback, bool *key_exists);
 
 public:
   Block() = default;
   Block(size_t capacity);
   // ! 这里的编码函数不包括 hash
-  std::vector<uint8_t> encode();
+  // with_hash_index 为 true 时在末尾附加哈希索引
+  std::vector<uint8_t> encode(bool with_hash_index = false);
   // ! 这里的解码函数可指定切片是否包括 hash
   static std::shared_ptr<Block> decode(const std::vector<uint8_t> &encoded,
                                        bool with_hash = false);
+  // 零拷贝解码, 返回的 block 持有 encoded 的引用, encoded 需要保持不变
+  static std::shared_ptr<Block> decode_view(std::shared_ptr<const uint8_t> encoded,
+                                            size_t size, bool with_hash = false);
   std::string get_first_key();
   size_t get_offset_at(size_t idx) const;
   bool add_entry(const std::string &key, const std::string &value,
@@ -72,7 +154,15 @@ public:
   size_t cur_size() const;
   bool is_empty() const;
   std::optional<size_t> get_idx_binary(const std::string &key,
-                                       uint64_t tranc_id);
+                                       uint64_t tranc_id,
+                                       bool *key_exists = nullptr);
+  // 点查定位: 有哈希索引时优先使用哈希索引, 否则二分查找.
+  // key_exists 不为空时报告 block 中是否存在 key 的任意版本
+  std::optional<size_t> get_idx(const std::string &key, uint64_t tranc_id,
+                                bool *key_exists = nullptr);
+  // 返回第一个 key 不小于 key 的条目的索引, 不存在时返回 size()
+  size_t lower_bound(std::string_view key) const;
+  bool has_hash_index() const;
 
   // 按照谓词返回迭代器, 左闭右开
   std::optional<
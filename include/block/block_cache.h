@@ -12,12 +12,24 @@
 
 namespace tiny_lsm {
 
+// 缓存优先级, 高优先级的项 (索引/过滤器分区) 只有在低优先级的项淘汰完,
+// 或者自身占用超过高优先级池的容量时才会被淘汰
+enum class CachePriority { LOW, HIGH };
+
+// data block 之外的可缓存对象的基类, 例如 sst 的索引分区和过滤器分区
+class CacheEntry {
+public:
+  virtual ~CacheEntry() = default;
+};
+
 // 定义缓存项
 struct CacheItem {
   int sst_id;
   int block_id;
   std::shared_ptr<Block> cache_block;
   uint64_t access_count; // 访问计数
+  std::shared_ptr<CacheEntry> cache_entry = nullptr;
+  CachePriority priority = CachePriority::LOW;
 };
 
 // 自定义哈希函数
@@ -51,6 +63,12 @@ public:
   // 插入缓存项
   void put(int sst_id, int block_id, std::shared_ptr<Block> data);
 
+  // 获取 sst 的元数据项 (如索引/过滤器分区), meta_id 由调用方自行编号
+  std::shared_ptr<CacheEntry> get_meta(int sst_id, int meta_id);
+
+  // 以高优先级插入 sst 的元数据项
+  void put_meta(int sst_id, int meta_id, std::shared_ptr<CacheEntry> entry);
+
   // 获取缓存命中率
   double hit_rate() const;
 
@@ -62,6 +80,11 @@ private:
   // 双向链表存储缓存项
   std::list<CacheItem> cache_list_greater_k;
   std::list<CacheItem> cache_list_less_k;
+  // 高优先级项单独使用 LRU 链表
+  std::list<CacheItem> cache_list_high_pri;
+
+  // 高优先级项最多占用的容量比例
+  static constexpr double HIGH_PRI_POOL_RATIO = 0.5;
 
   // 哈希表索引缓存项
   std::unordered_map<std::pair<int, int>, std::list<CacheItem>::iterator,
@@ -71,6 +94,13 @@ private:
   // 更新缓存项的访问时间
   void update_access_count(std::list<CacheItem>::iterator it);
 
+  // 插入新项前按优先级淘汰, 需持有锁
+  void evict_for(CachePriority priority);
+  void evict_tail(std::list<CacheItem> &list);
+
+  // 元数据项在哈希表中使用负数的 block_id, 与 data block 区分
+  static int meta_key(int meta_id) { return -1 - meta_id; }
+
   // 记录请求数和命中数
   mutable size_t total_requests_ = 0;
   mutable size_t hit_requests_ = 0;
@@ -6,6 +6,7 @@
 #include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <utility>
 
 namespace tiny_lsm {
@@ -22,8 +23,9 @@ public:
 
   // 构造函数
   BlockIterator(std::shared_ptr<Block> b, size_t index, uint64_t tranc_id);
+  // key_exists 不为空时报告 block 中是否存在 key 的任意版本
   BlockIterator(std::shared_ptr<Block> b, const std::string &key,
-                uint64_t tranc_id);
+                uint64_t tranc_id, bool *key_exists = nullptr);
   // BlockIterator(std::shared_ptr<Block> b, uint64_t tranc_id);
   BlockIterator()
       : block(nullptr), current_index(0), tranc_id_(0) {} // end iterator
@@ -37,6 +39,10 @@ public:
   value_type operator*() const;
   bool is_end() const;
 
+  // 不拷贝的 key 和 value, 视图在 block 存活期间有效
+  std::string_view key() const;
+  std::string_view value() const;
+
   // Return tranc_id of the current entry (or 0 if invalid/end)
   uint64_t current_tranc_id() const;
 
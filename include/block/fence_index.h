@@ -0,0 +1,49 @@
+#pragma once
+
+#include "blockmeta.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace tiny_lsm {
+
+/**
+ * SST 内 block 定位使用的紧凑栅栏索引 (fence pointers)
+ *
+ * 第 i 个栅栏 key 是满足 last_key(i-1) < fence(i) <= first_key(i)
+ * 的最短分隔 key, 第 0 个栅栏是第一个 block 的 first_key.
+ * 所有栅栏 key 连续存放在同一个缓冲区中, 通过偏移数组定位:
+ * ---------------------------------------------------------
+ * | keys_:    fence(0) | fence(1) | ... | fence(n-1)       |
+ * | offsets_: 0 | off(1) | ... | off(n-1) | keys_.size()   |
+ * ---------------------------------------------------------
+ * 查找时对栅栏 key 做二分, 找到最后一个 fence(i) <= key 的 block.
+ * 如果 block 之间不是严格有序的, 索引为空, 由调用方自行回退
+ */
+class FenceIndex {
+public:
+  FenceIndex() = default;
+  explicit FenceIndex(const std::vector<BlockMeta> &meta_entries);
+
+  // 返回可能包含 key 的 block 的索引, key 小于第一个栅栏时返回 -1
+  size_t find(std::string_view key) const;
+
+  // 栅栏(即 block)的数量
+  size_t size() const;
+
+  // 索引占用的内存字节数
+  size_t memory_usage() const;
+
+  // 计算满足 prev < sep <= next 的最短分隔 key
+  static std::string shortest_separator(std::string_view prev,
+                                        std::string_view next);
+
+private:
+  std::string keys_;
+  std::vector<uint32_t> offsets_;
+
+  std::string_view fence_at(size_t idx) const;
+};
+} // namespace tiny_lsm
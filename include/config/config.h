@@ -17,10 +17,25 @@ private:
   long long lsm_per_mem_size_limit_;
   int lsm_block_size_;
   int lsm_sst_level_ratio_;
+  bool lsm_block_hash_index_;
+  int lsm_sst_index_partition_blocks_;
+  bool lsm_sst_mmap_read_;
+  int lsm_sst_read_queue_depth_;
+  int lsm_sst_readahead_max_blocks_;
+  int lsm_compaction_readahead_blocks_;
+  int lsm_wal_group_commit_max_size_;
+  int lsm_wal_group_commit_max_wait_us_;
+  int lsm_wal_segment_size_;
+  int lsm_wal_recovery_threads_;
+  int lsm_max_immutable_memtables_;
+  int lsm_high_priority_threads_;
+  int lsm_low_priority_threads_;
+  int lsm_max_subcompactions_;
 
   // --- LSM Cache ---
   int lsm_block_cache_capacity_;
   int lsm_block_cache_k_;
+  long long lsm_row_cache_capacity_;
 
   // --- Redis Headers/Separators ---
   std::string redis_expire_header_;
@@ -35,6 +50,8 @@ private:
   // --- Bloom Filter ---
   int bloom_filter_expected_size_;
   double bloom_filter_expected_error_rate_;
+  int bloom_filter_prefix_stride_;
+  int bloom_filter_prefix_max_len_;
 
   // Private method to set default values
   void setDefaultValues();
@@ -58,9 +75,24 @@ public:
   long long getLsmPerMemSizeLimit() const;
   int getLsmBlockSize() const;
   int getLsmSstLevelRatio() const;
+  bool getLsmBlockHashIndex() const;
+  int getLsmSstIndexPartitionBlocks() const;
+  bool getLsmSstMmapRead() const;
+  int getLsmSstReadQueueDepth() const;
+  int getLsmSstReadaheadMaxBlocks() const;
+  int getLsmCompactionReadaheadBlocks() const;
+  int getLsmWalGroupCommitMaxSize() const;
+  int getLsmWalGroupCommitMaxWaitUs() const;
+  int getLsmWalSegmentSize() const;
+  int getLsmWalRecoveryThreads() const;
+  int getLsmMaxImmutableMemtables() const;
+  int getLsmHighPriorityThreads() const;
+  int getLsmLowPriorityThreads() const;
+  int getLsmMaxSubcompactions() const;
 
   int getLsmBlockCacheCapacity() const;
   int getLsmBlockCacheK() const;
+  long long getLsmRowCacheCapacity() const;
 
   const std::string &getRedisExpireHeader() const;
   const std::string &getRedisHashValuePreffix() const;
@@ -73,6 +105,8 @@ public:
 
   int getBloomFilterExpectedSize() const;
   double getBloomFilterExpectedErrorRate() const;
+  int getBloomFilterPrefixStride() const;
+  int getBloomFilterPrefixMaxLen() const;
 
   static const TomlConfig &
   getInstance(const std::string &config_path = "config.toml");
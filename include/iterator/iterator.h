@@ -5,6 +5,7 @@
 #include <optional>
 #include <queue>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -18,6 +19,7 @@ enum class IteratorType {
   TwoMergeIterator,
   ConcactIterator,
   LevelIterator,
+  MergeIterator,
   Undefined,
 };
 
@@ -31,6 +33,10 @@ public:
   virtual bool operator==(const BaseIterator &other) const = 0;
   virtual bool operator!=(const BaseIterator &other) const = 0;
   virtual value_type operator*() const = 0;
+  // 返回当前 key 和 value 的视图, 不拷贝数据, 迭代器移动后失效
+  // 扫描时应优先使用这两个接口, operator* 每次都会构造新的 pair
+  virtual std::string_view key() const = 0;
+  virtual std::string_view value() const = 0;
   virtual IteratorType get_type() const = 0;
   virtual uint64_t get_tranc_id() const = 0;
   virtual bool is_end() const = 0;
@@ -66,6 +72,8 @@ public:
                bool filter_empty = true);
   pointer operator->() const;
   virtual value_type operator*() const override;
+  virtual std::string_view key() const override;
+  virtual std::string_view value() const override;
   BaseIterator &operator++() override;
   BaseIterator operator++(int) = delete;
   virtual bool operator==(const BaseIterator &other) const override;
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "iterator.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace tiny_lsm {
+
+// *************************** MergeIterator ***************************
+/**
+ * 基于败者树的多路归并迭代器
+ *
+ * children 需要按 key 升序输出, 同一 key 的多个版本按 tranc_id 降序排列,
+ * 并且按照数据的新旧顺序排列 (下标小的数据源更新).
+ * 同一 key 的多个候选中, tranc_id 更大的优先, tranc_id 相同时下标小的优先,
+ * 每个 key 只输出胜出的一个版本.
+ *
+ * 败者树的内部节点记录比赛的败者, tree_[0] 记录最终的胜者,
+ * 胜者前进后只需要沿着到根的路径重新比赛, 每一步需要 O(log k) 次比较,
+ * 比较直接使用子迭代器的 key 视图, 不拷贝数据
+ */
+class MergeIterator : public BaseIterator {
+public:
+  MergeIterator() = default;
+  // filter_empty 为 true 时跳过删除标记, compaction 需要保留删除标记
+  MergeIterator(std::vector<std::shared_ptr<BaseIterator>> children,
+                uint64_t max_tranc_id, bool filter_empty = true);
+
+  virtual BaseIterator &operator++() override;
+  virtual bool operator==(const BaseIterator &other) const override;
+  virtual bool operator!=(const BaseIterator &other) const override;
+  virtual value_type operator*() const override;
+  virtual std::string_view key() const override;
+  virtual std::string_view value() const override;
+  virtual IteratorType get_type() const override;
+  // 返回当前条目的事务id
+  virtual uint64_t get_tranc_id() const override;
+  virtual bool is_end() const override;
+  virtual bool is_valid() const override;
+
+  pointer operator->() const;
+
+private:
+  // a 是否应该排在 b 之前, 无效的子迭代器总是排在最后
+  bool less(size_t a, size_t b) const;
+  // 计算以 node 为根的子树的胜者, 并在内部节点记录败者
+  size_t build(size_t node);
+  // 子迭代器 idx 前进后, 沿到根的路径重新比赛
+  void replay(size_t idx);
+  // 跳过所有与 key 相同的条目
+  void skip_key(std::string_view key);
+  // 跳过对当前事务不可见的条目和删除标记
+  void seek_valid();
+
+  std::vector<std::shared_ptr<BaseIterator>> children_;
+  std::vector<size_t> tree_;
+  uint64_t max_tranc_id_ = 0;
+  bool filter_empty_ = true;
+  // 子迭代器前进后其视图可能失效, 跳过同一 key 时使用这个缓冲区
+  std::string skip_buf_;
+  mutable std::optional<value_type> cached_value_;
+};
+} // namespace tiny_lsm
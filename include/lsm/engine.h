@@ -2,11 +2,20 @@
 
 #include "../memtable/memtable.h"
 #include "../sst/sst.h"
+#include "../utils/job_scheduler.h"
+#include "../utils/row_cache.h"
 #include "compact.h"
 #include "transaction.h"
 #include "two_merge_iterator.h"
+#include "version.h"
+#include "write_batch.h"
+#include <array>
+#include <atomic>
+#include <condition_variable>
 #include <cstddef>
 #include <deque>
+#include <functional>
+#include <future>
 #include <map>
 #include <memory>
 #include <string>
@@ -17,16 +26,30 @@ namespace tiny_lsm {
 
 class Level_Iterator;
 
+// 某一层 SST 的布隆过滤器在点查中的效果统计
+struct BloomFilterStats {
+  // 过滤器判定 key 不存在, 省去了 block 读取的次数
+  uint64_t useful = 0;
+  // 过滤器判定 key 可能存在, 但 SST 中实际没有该 key 的次数
+  uint64_t false_positive = 0;
+  // key 存在, 但所有版本对查询的事务都不可见的次数, 不属于误判
+  uint64_t invisible = 0;
+};
+
 class LSMEngine : public std::enable_shared_from_this<LSMEngine> {
 public:
   std::string data_dir;
   MemTable memtable;
   std::map<size_t, std::deque<size_t>> level_sst_ids;
   std::unordered_map<size_t, std::shared_ptr<SST>> ssts;
+  // 保护 level_sst_ids 和 ssts, flush 和 compaction 只在选取输入和安装输出
+  // 时持有写锁. 读取通过 get_version 获取的快照进行, 不需要加锁
   std::shared_mutex ssts_mtx;
   std::shared_ptr<BlockCache> block_cache;
+  std::shared_ptr<RowCache> row_cache; // 容量为 0 时为 nullptr
   size_t next_sst_id = 0;
-  size_t cur_max_level = 0;
+  // 在 ssts_mtx 的保护下修改, 统计信息不加锁读取
+  std::atomic<size_t> cur_max_level{0};
 
 public:
   LSMEngine(std::string path);
@@ -34,6 +57,7 @@ public:
 
   std::optional<std::pair<std::string, uint64_t>> get(const std::string &key,
                                                       uint64_t tranc_id);
+  // 与 get 不同, 被删除的 key 以空 value 返回
   std::vector<
       std::pair<std::string, std::optional<std::pair<std::string, uint64_t>>>>
   get_batch(const std::vector<std::string> &keys, uint64_t tranc_id);
@@ -41,19 +65,34 @@ public:
   std::optional<std::pair<std::string, uint64_t>>
   sst_get_(const std::string &key, uint64_t tranc_id);
 
-  // 如果触发了刷盘, 返回当前刷入sst的最大事务id
-  uint64_t put(const std::string &key, const std::string &value,
-               uint64_t tranc_id);
+  // 写入只修改 memtable, 写满的 memtable 由后台的高优先级任务刷盘.
+  // 等待刷盘的冻结表过多时写入会阻塞, 直到刷盘赶上
+  void put(const std::string &key, const std::string &value,
+           uint64_t tranc_id);
 
-  uint64_t
-  put_batch(const std::vector<std::pair<std::string, std::string>> &kvs,
-            uint64_t tranc_id);
+  void put_batch(const std::vector<std::pair<std::string, std::string>> &kvs,
+                 uint64_t tranc_id);
 
-  uint64_t remove(const std::string &key, uint64_t tranc_id);
-  uint64_t remove_batch(const std::vector<std::string> &keys,
-                        uint64_t tranc_id);
+  void remove(const std::string &key, uint64_t tranc_id);
+  void remove_batch(const std::vector<std::string> &keys, uint64_t tranc_id);
   void clear();
-  uint64_t flush();
+
+  // 请求将当前 memtable 中的所有数据刷盘, 不等待刷盘完成.
+  // 返回的 future 在这些数据都写入 sst 后就绪, 值为已刷盘的最大事务 id
+  std::shared_future<uint64_t> flush();
+
+  // 写入是否会因为等待刷盘而阻塞
+  bool write_stalled();
+
+  // 设置每次刷盘完成后的回调, 参数为已刷盘的最大事务 id, 在后台线程中调用
+  void set_flush_listener(std::function<void(uint64_t)> listener);
+
+  // 执行刷盘 (高优先级) 和 compaction, 删除文件 (低优先级) 的调度器,
+  // 其他组件可以提交自己的后台任务, 引擎析构时关闭
+  std::shared_ptr<JobScheduler> get_scheduler() const;
+
+  // 等待所有已提交的后台任务执行完成, 包括它们触发的后续任务
+  void wait_for_background_jobs();
 
   std::string get_sst_path(size_t sst_id, size_t target_level);
 
@@ -63,21 +102,148 @@ public:
 
   Level_Iterator begin(uint64_t tranc_id);
   Level_Iterator end();
+  // 返回 [lower, upper) 范围的迭代器, upper 为空表示没有上界
+  Level_Iterator scan(const std::string &lower, const std::string &upper,
+                      uint64_t tranc_id);
+  // 返回前缀为 prefix 的所有 key 的迭代器, 使用前缀过滤器跳过无关的 sst
+  Level_Iterator scan_prefix(const std::string &prefix, uint64_t tranc_id);
 
   static size_t get_sst_size(size_t level);
 
+  // 获取当前 sst 布局的快照, 持有期间其中的 sst 不会被释放
+  std::shared_ptr<const Version> get_version() const;
+
+  // 返回 0 ~ cur_max_level 各层的布隆过滤器统计
+  std::vector<BloomFilterStats> get_bloom_filter_stats() const;
+
 private:
+  struct BloomFilterCounter {
+    std::atomic<uint64_t> useful{0};
+    std::atomic<uint64_t> false_positive{0};
+    std::atomic<uint64_t> invisible{0};
+  };
+  // 超过该层数的统计都计入最后一个计数器
+  static constexpr size_t BLOOM_STATS_MAX_LEVEL = 16;
+  std::array<BloomFilterCounter, BLOOM_STATS_MAX_LEVEL> bloom_counters_;
+
+  std::atomic<std::shared_ptr<const Version>> version_;
+
+  std::shared_ptr<JobScheduler> scheduler_;
+
+  // 刷盘任务及其状态, 均由 flush_mtx_ 保护
+  struct FlushRequest {
+    // 累计刷盘 (或被 clear 丢弃) 的冻结表数量达到 target 时完成
+    uint64_t target;
+    std::promise<uint64_t> promise;
+  };
+  std::mutex flush_mtx_;
+  // 唤醒因等待刷盘而阻塞的写入者, 以及等待刷盘请求完成的析构
+  std::condition_variable stall_cv_;
+  std::vector<FlushRequest> flush_requests_;
+  // 已经刷盘 (或被 clear 丢弃) 的冻结表数量, 在通知 listener 之后更新
+  uint64_t flushed_total_ = 0;
+  uint64_t max_flushed_tranc_id_ = 0;
+  // 同一时间只有一个刷盘任务, 冻结表按从旧到新的顺序写入 sst
+  bool flush_scheduled_ = false;
+  // 连续失败的刷盘次数, 成功后清零. 超过上限后不再自动重试,
+  // 之后的写入或 flush 请求各自再触发一次尝试
+  size_t flush_failures_ = 0;
+  static constexpr size_t MAX_FLUSH_RETRIES = 5;
+  bool stop_flush_ = false;
+  std::function<void(uint64_t)> flush_listener_;
+
+  std::atomic<bool> compaction_scheduled_{false};
+  // 串行化 compaction, 以及 compaction 和 clear
+  std::mutex compaction_mtx_;
+  // 串行化 flush_oldest_ 和 clear. 锁的顺序为 compaction_mtx_,
+  // flush_oldest_mtx_, ssts_mtx, flush_mtx_
+  std::mutex flush_oldest_mtx_;
+  // compaction 替换下来等待删除的 sst, 由低优先级任务删除文件
+  std::mutex obsolete_mtx_;
+  std::vector<std::shared_ptr<SST>> obsolete_ssts_;
+
+  // 刷盘任务: 写入最老的冻结表, 仍有冻结表时提交下一个任务
+  void flush_job_();
+  // 将最老的冻结表写入 sst, 返回其最大事务 id, 没有冻结表时返回 nullopt
+  std::optional<uint64_t> flush_oldest_();
+  // 写入前等待, 直到等待刷盘的冻结表数量低于上限
+  void wait_for_flush_room_();
+  // 存在冻结表且没有刷盘任务时提交刷盘任务
+  void schedule_flush_();
+  // 同上, 需要持有 flush_mtx_
+  void schedule_flush_locked_();
+  // 完成已经满足的刷盘请求, 需要持有 flush_mtx_
+  void complete_flush_requests_();
+
+  // l0 的 sst 数量达到上限时提交 compaction 任务
+  void schedule_compaction_();
+  void compaction_job_();
+  // 删除 obsolete_ssts_ 中的文件
+  void delete_obsolete_ssts_();
+
+  // 根据 level_sst_ids 生成新的版本并发布, 调用者需要持有 ssts_mtx 写锁
+  void install_version_();
+
+  // 不经过行缓存的查询, 删除标记以空 value 返回, nullopt 表示不存在
+  std::optional<std::pair<std::string, uint64_t>> get_(const std::string &key,
+                                                       uint64_t tranc_id);
+  std::vector<
+      std::pair<std::string, std::optional<std::pair<std::string, uint64_t>>>>
+  get_batch_(const std::vector<std::string> &keys, uint64_t tranc_id);
+  // 在版本 version 的 sst 中查询, 删除标记以空 value 返回
+  std::optional<std::pair<std::string, uint64_t>>
+  version_get_(const Version &version, const std::string &key,
+               uint64_t tranc_id);
+
+  // 在单个 sst 中点查, 先检查 key 范围和布隆过滤器, 再读取 block
+  SstIterator sst_point_get_(const std::shared_ptr<SST> &sst,
+                             const std::string &key, uint64_t tranc_id,
+                             size_t level);
+
+  // 在单个 sst 中批量点查 order[begin, end) 指向的 key (按 key 升序),
+  // 先统一检查布隆过滤器, 再按 block 分组读取, 命中的结果写入 results
+  void sst_get_batch_(
+      const std::shared_ptr<SST> &sst,
+      std::vector<std::pair<std::string,
+                            std::optional<std::pair<std::string, uint64_t>>>>
+          &results,
+      const std::vector<size_t> &order, size_t begin, size_t end,
+      uint64_t tranc_id, size_t level);
+
   void full_compact(size_t src_level);
-  std::vector<std::shared_ptr<SST>>
-  full_l0_l1_compact(std::vector<size_t> &l0_ids, std::vector<size_t> &l1_ids);
+
+  // 一组按 key 有序且互不重叠的 sst, 作为归并的一路输入
+  using SortedRun = std::vector<std::shared_ptr<SST>>;
+
+  std::vector<std::shared_ptr<SST>> full_l0_l1_compact(const SortedRun &l0_ssts,
+                                                       const SortedRun &l1_ssts);
 
   std::vector<std::shared_ptr<SST>>
-  full_common_compact(std::vector<size_t> &lx_ids, std::vector<size_t> &ly_ids,
+  full_common_compact(const SortedRun &lx_ssts, const SortedRun &ly_ssts,
                       size_t level_y);
 
-  std::vector<std::shared_ptr<SST>> gen_sst_from_iter(BaseIterator &iter,
-                                                      size_t target_sst_size,
-                                                      size_t target_level);
+  // 归并 runs (新的在前) 并写入 target_level, 返回按 key 排序的输出.
+  // 输入足够大时按输入 sst 的首 key 划分为互不相交的 key 范围,
+  // 各个范围在低优先级线程池中并行归并 (subcompaction). 任意范围失败
+  // 或调度器关闭时删除所有已生成的输出并抛出异常
+  std::vector<std::shared_ptr<SST>>
+  compact_runs_(const std::vector<SortedRun> &runs, size_t target_sst_size,
+                size_t target_level);
+
+  // 归并 runs 中 [lower, upper) 范围的数据, upper 为空表示没有上界
+  std::vector<std::shared_ptr<SST>>
+  compact_range_(const std::vector<SortedRun> &runs, const std::string &lower,
+                 const std::string &upper, size_t target_sst_size,
+                 size_t target_level);
+
+  // 从 iter 生成 sst 直到 iter 结束或 key 不小于 upper (为空时没有上界)
+  std::vector<std::shared_ptr<SST>>
+  gen_sst_from_iter(BaseIterator &iter, size_t target_sst_size,
+                    size_t target_level, const std::string &upper = "");
+
+  // 分配新的 sst id, 并行的 subcompaction 会同时调用
+  size_t allocate_sst_id_();
+  std::mutex sst_id_mtx_;
 };
 
 class LSM {
@@ -101,14 +267,27 @@ public:
   void remove(const std::string &key);
   void remove_batch(const std::vector<std::string> &keys);
 
+  // 以一个事务原子地写入 batch: 写入 WAL 一次后一次性插入 memtable.
+  // 设置 no_slowdown 且写入需要等待 flush 时不写入并返回 false
+  bool write(const WriteBatch &batch,
+             const WriteOptions &options = WriteOptions());
+
   using LSMIterator = Level_Iterator;
   LSMIterator begin(uint64_t tranc_id);
   LSMIterator end();
+  // 返回 [lower, upper) 范围的迭代器, upper 为空表示没有上界
+  // 迭代器持有 sst 布局的快照, 不阻塞写入, flush 和 compaction
+  LSMIterator scan(const std::string &lower, const std::string &upper,
+                   uint64_t tranc_id = 0);
+  // 返回前缀为 prefix 的所有 key 的迭代器
+  LSMIterator scan_prefix(const std::string &prefix, uint64_t tranc_id = 0);
   std::optional<std::pair<TwoMergeIterator, TwoMergeIterator>>
   lsm_iters_monotony_predicate(
       uint64_t tranc_id, std::function<int(const std::string &)> predicate);
   void clear();
-  void flush();
+  // 请求刷盘, 不等待完成, 需要等待时使用返回的 future
+  std::shared_future<uint64_t> flush();
+  // 刷盘并等待所有 memtable 写入 sst
   void flush_all();
 
   // 开启一个事务
@@ -1,8 +1,10 @@
 #pragma once
 #include "../iterator/iterator.h"
+#include "../iterator/merge_iterator.h"
+#include "version.h"
 #include <memory>
 #include <optional>
-#include <shared_mutex>
+#include <string>
 
 namespace tiny_lsm {
 class LSMEngine;
@@ -11,11 +13,22 @@ class Level_Iterator : public BaseIterator {
 public:
   Level_Iterator() = default;
   Level_Iterator(std::shared_ptr<LSMEngine> engine_, uint64_t max_tranc_id);
+  // 范围迭代器, 只输出 [lower, upper) 中的 key, upper 为空表示没有上界
+  // prefix 不为空时表示前缀扫描, 范围内的 key 都以 prefix 开头,
+  // 可以使用 sst 的前缀过滤器跳过不包含该前缀的 sst
+  Level_Iterator(std::shared_ptr<LSMEngine> engine_, uint64_t max_tranc_id,
+                 const std::string &lower, const std::string &upper,
+                 const std::string &prefix = "");
+
+  // 移动到第一个不小于 key 的位置, 上界保持不变
+  void seek(const std::string &key);
 
   virtual BaseIterator &operator++() override;
   virtual bool operator==(const BaseIterator &other) const override;
   virtual bool operator!=(const BaseIterator &other) const override;
   virtual value_type operator*() const override;
+  virtual std::string_view key() const override;
+  virtual std::string_view value() const override;
   virtual IteratorType get_type() const override;
   virtual uint64_t get_tranc_id() const override;
   virtual bool is_end() const override;
@@ -25,15 +38,18 @@ public:
 
 private:
   std::shared_ptr<LSMEngine> engine_;
-  std::vector<std::shared_ptr<BaseIterator>> iter_vec;
-  size_t cur_idx_;
   uint64_t max_tranc_id_;
+  std::string upper_;
+  std::string prefix_;
   mutable std::optional<value_type> cached_value; // 缓存当前值
-  std::shared_lock<std::shared_mutex> rlock_;
+  // 迭代期间持有的 sst 布局快照, flush 和 compaction 不会被迭代器阻塞
+  std::shared_ptr<const Version> version_;
+  // 需要在版本之后析构
+  MergeIterator merge_it_;
 
 private:
   void update_current() const;
-  std::pair<size_t, std::string> get_min_key_idx() const;
-  void skip_key(const std::string &key);
+  // 创建定位到 lower 的各个数据源, 跳过与 [lower, upper_) 不相交的 sst
+  void build_iters(const std::string &lower);
 };
 } // namespace tiny_lsm
@@ -75,9 +75,12 @@ public:
   void update_max_finished_tranc_id(uint64_t tranc_id);
   void update_max_flushed_tranc_id(uint64_t tranc_id);
 
-  bool write_to_wal(const std::vector<Record> &records);
+  // 以组提交的方式写入 WAL, sync 为 false 时只写入操作系统
+  bool write_to_wal(const std::vector<Record> &records, bool sync = true);
 
   std::map<uint64_t, std::vector<Record>> check_recover();
+  // 流式重放 WAL 中需要恢复的已提交事务, callback 可能被多个线程并发调用
+  void replay_wal(const WAL::ReplayCallback &callback);
 
   std::string get_tranc_id_file_path();
   void write_tranc_id_file();
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "../sst/sst.h"
+#include <memory>
+#include <vector>
+
+namespace tiny_lsm {
+
+/**
+ * sst 布局的不可变快照
+ *
+ * flush 和 compaction 在 ssts_mtx 的保护下修改 level_sst_ids 和 ssts,
+ * 完成后发布新的 Version. 读取者原子地获取当前 Version 的引用即可,
+ * 不需要持有 ssts_mtx, 持有引用期间其中的 sst 对象不会被释放
+ */
+struct Version {
+  // levels[level] 为该层的 sst, L0 按从新到旧排列, 其他层按 key 有序
+  // 至少包含 L0 (可能为空)
+  std::vector<std::vector<std::shared_ptr<SST>>> levels;
+};
+} // namespace tiny_lsm
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tiny_lsm {
+
+/**
+ * 一组原子写入的操作
+ *
+ * 通过 LSM::write 提交时整个 batch 使用同一个 tranc_id, 作为一个事务
+ * 写入 WAL 一次, 再一次性插入 memtable. 与 memtable 一致, 删除以空值表示
+ */
+class WriteBatch {
+public:
+  void put(const std::string &key, const std::string &value) {
+    kvs_.emplace_back(key, value);
+  }
+
+  void remove(const std::string &key) { kvs_.emplace_back(key, ""); }
+
+  void clear() { kvs_.clear(); }
+
+  size_t size() const { return kvs_.size(); }
+
+  bool empty() const { return kvs_.empty(); }
+
+  // 按加入顺序排列的操作, 同一个 key 后加入的操作覆盖之前的操作
+  const std::vector<std::pair<std::string, std::string>> &kvs() const {
+    return kvs_;
+  }
+
+private:
+  std::vector<std::pair<std::string, std::string>> kvs_;
+};
+
+struct WriteOptions {
+  // 返回前 fdatasync WAL; 为 false 时只写入操作系统, 进程崩溃不会丢失数据
+  bool sync = true;
+  // 不写 WAL, 未 flush 的数据在重启后丢失
+  bool disable_wal = false;
+  // memtable 已满, 写入需要等待 flush 时直接返回 false
+  bool no_slowdown = false;
+};
+} // namespace tiny_lsm
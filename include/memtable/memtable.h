@@ -2,6 +2,7 @@
 
 #include "../iterator/iterator.h"
 #include "../skiplist/skiplist.h"
+#include <atomic>
 #include <cstddef>
 #include <functional>
 #include <iostream>
@@ -13,14 +14,56 @@
 #include <string>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 namespace tiny_lsm {
 
 class BlockCache;
+class RowCache;
 class SST;
 class SSTBuilder;
 class TranContext;
 
+// 单个跳表的惰性迭代器, 每个 key 只输出对 max_tranc_id 可见的最新版本,
+// 删除标记会被保留. 迭代器持有跳表的引用, 但不持有 memtable 的锁,
+// 迭代期间活跃表可以被并发写入
+class MemTableIterator : public BaseIterator {
+public:
+  MemTableIterator() = default;
+  MemTableIterator(std::shared_ptr<SkipList> table, uint64_t max_tranc_id);
+
+  // 移动到第一个不小于 key 的条目
+  void seek(const std::string &key);
+
+  virtual BaseIterator &operator++() override;
+  virtual bool operator==(const BaseIterator &other) const override;
+  virtual bool operator!=(const BaseIterator &other) const override;
+  virtual value_type operator*() const override;
+  virtual std::string_view key() const override;
+  virtual std::string_view value() const override;
+  virtual IteratorType get_type() const override;
+  // 返回当前条目的事务id
+  virtual uint64_t get_tranc_id() const override;
+  virtual bool is_end() const override;
+  virtual bool is_valid() const override;
+
+private:
+  // 跳过对 max_tranc_id_ 不可见的版本
+  void skip_by_tranc_id();
+
+  std::shared_ptr<SkipList> table_;
+  SkipListIterator it_;
+  uint64_t max_tranc_id_ = 0;
+};
+
+// 活跃表和冻结表的不可变快照, 冻结或移除冻结表时发布新的快照.
+// 跳表支持并发读写, 读取者持有快照即可访问其中的表, 不需要 memtable 的锁
+struct MemTableView {
+  std::shared_ptr<SkipList> current;
+  // 从新到旧排列
+  std::vector<std::shared_ptr<SkipList>> frozen;
+};
+
 class MemTable {
   friend class TranContext;
   friend class HeapIterator;
@@ -37,6 +80,11 @@ private:
 
   void remove_(const std::string &key, uint64_t tranc_id);
   void frozen_cur_table_(); // _ 表示不需要锁的版本
+  // 活跃表超过大小限制时将其冻结, 需要在不持有 cur_mtx 时调用
+  void frozen_cur_table_if_full_();
+  // 发布当前表的快照, 调用者需要持有 frozen_mtx 的写锁,
+  // 活跃表只会在同时持有两个写锁时被替换, 因此不需要 cur_mtx
+  void publish_view_();
 
 public:
   MemTable();
@@ -54,13 +102,24 @@ public:
   void remove_batch(const std::vector<std::string> &keys, uint64_t tranc_id);
 
   void clear();
+  // 设置需要在写入时失效的行缓存
+  void set_row_cache(std::shared_ptr<RowCache> row_cache);
   std::shared_ptr<SST> flush_last(SSTBuilder &builder, std::string &sst_path,
                                   size_t sst_id,
                                   std::shared_ptr<BlockCache> block_cache);
+  // 移除 flush_last 已经写入 SST 的最老的冻结表
+  void remove_last_frozen();
+  // 冻结活跃表, 活跃表为空时不做任何事
   void frozen_cur_table();
+  // 当前冻结表的数量
+  size_t get_frozen_count();
+  // 累计冻结过的表的数量, 只增不减, 用于判断某一时刻之前冻结的表是否都已刷盘
+  uint64_t get_frozen_total();
   size_t get_cur_size();
   size_t get_frozen_size();
   size_t get_total_size();
+  // 获取当前表的快照, 只需要一次原子读取
+  std::shared_ptr<const MemTableView> get_view() const;
   HeapIterator begin(uint64_t tranc_id);
   HeapIterator iters_preffix(const std::string &preffix, uint64_t tranc_id);
 
@@ -74,7 +133,10 @@ private:
   std::shared_ptr<SkipList> current_table;
   std::list<std::shared_ptr<SkipList>> frozen_tables;
   size_t frozen_bytes;
+  uint64_t frozen_total_ = 0;
   std::shared_mutex frozen_mtx; // 冻结表的锁
   std::shared_mutex cur_mtx;    // 活跃表的锁
+  std::atomic<std::shared_ptr<const MemTableView>> view_;
+  std::shared_ptr<RowCache> row_cache_;
 };
 } // namespace tiny_lsm
\ No newline at end of file
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace tiny_lsm {
+
+/**
+ * 跳表使用的内存池, 每个跳表独占一个
+ *
+ * 内存按块向系统申请, 分配时只移动块内的指针, 不支持单独释放;
+ * 整个内存池在析构时一次性释放. 分配可以被多个线程并发调用:
+ * 块内分配只需要对当前块的偏移做一次原子加法, 只有换块时才加锁
+ */
+class Arena {
+public:
+  explicit Arena(size_t block_size = 4096);
+  ~Arena() = default;
+
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  // 分配 bytes 字节, 返回的地址按 8 字节对齐
+  char *allocate(size_t bytes);
+
+  // 向系统申请的总内存大小
+  size_t memory_usage() const;
+
+private:
+  struct Block {
+    std::unique_ptr<char[]> data;
+    size_t size;
+    // 已分配的偏移, 超过 size 时说明块已满
+    std::atomic<size_t> used{0};
+  };
+
+  // 申请新块, 需要持有 mutex_
+  Block *allocate_new_block(size_t block_bytes);
+
+  size_t block_size_;
+  // 只保护 blocks_ 和换块
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<Block>> blocks_;
+  // 小对象从当前块中分配
+  std::atomic<Block *> current_{nullptr};
+  std::atomic<size_t> memory_usage_{0};
+};
+} // namespace tiny_lsm
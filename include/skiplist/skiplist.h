@@ -1,7 +1,10 @@
 #pragma once
 #include "../iterator/iterator.h"
+#include "arena.h"
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <functional>
 #include <memory>
 #include <mutex>
@@ -9,6 +12,7 @@
 #include <random>
 #include <shared_mutex>
 #include <string>
+#include <string_view>
 #include <sys/types.h>
 #include <tuple>
 #include <utility>
@@ -17,42 +21,54 @@
 namespace tiny_lsm {
 
 // ************************ SkipListNode ************************
+// 节点在 Arena 中存放为一条连续的记录:
+// | SkipListNode | forward_[1, height_) | key | value 记录 |
+// value 记录为 | 长度(32) | 数据 |. 同一 (key, tranc_id) 被重复写入时
+// 在 Arena 中追加新的 value 记录并原子地替换指针, 旧的记录仍保留给
+// 正在读取的线程, 随 Arena 一起释放
 struct SkipListNode {
-  std::string key_;   // 节点存储的键
-  std::string value_; // 节点存储的值
-  uint64_t tranc_id_; // 事务 id
-  std::vector<std::shared_ptr<SkipListNode>>
-      forward_; // 指向不同层级的下一个节点的指针数组
-  std::vector<std::weak_ptr<SkipListNode>>
-      backward_; // 指向不同层级的上一个节点的指针数组
-  SkipListNode(const std::string &k, const std::string &v, int level,
-               uint64_t tranc_id)
-      : key_(k), value_(v), forward_(level, nullptr),
-        backward_(level, std::weak_ptr<SkipListNode>()), tranc_id_(tranc_id) {}
-  void set_backward(int level, std::shared_ptr<SkipListNode> node) {
-    backward_[level] = std::weak_ptr<SkipListNode>(node);
+  uint64_t tranc_id_;                // 事务 id
+  std::atomic<const char *> value_;  // 最新的 value 记录
+  uint32_t key_size_;                // key 的长度
+  int32_t height_;                   // 节点的层数
+  // 指向不同层级的下一个节点的指针数组, 实际长度为 height_, 通过 CAS 链接
+  std::atomic<SkipListNode *> forward_[1];
+
+  // 在 arena 中创建节点, 可以被多个线程并发调用
+  static SkipListNode *create(Arena &arena, std::string_view key,
+                              std::string_view value, int level,
+                              uint64_t tranc_id);
+  // 在 arena 中创建 value 记录
+  static const char *create_value(Arena &arena, std::string_view value);
+
+  std::string_view key() const {
+    return {reinterpret_cast<const char *>(forward_ + height_), key_size_};
   }
-
-  bool operator==(const SkipListNode &other) const {
-    return key_ == other.key_ && value_ == other.value_ &&
-           tranc_id_ == other.tranc_id_;
+  std::string_view value() const {
+    auto record = value_.load(std::memory_order_acquire);
+    uint32_t size;
+    std::memcpy(&size, record, sizeof(uint32_t));
+    return {record + sizeof(uint32_t), size};
   }
 
-  bool operator!=(const SkipListNode &other) const { return !(*this == other); }
-
-  bool operator<(const SkipListNode &other) const {
-    if (key_ == other.key_) {
-      // key 相等时，trans_id 更大的优先级更高
-      return tranc_id_ > other.tranc_id_;
-    }
-    return key_ < other.key_;
+  SkipListNode *next(int level) const {
+    return forward_[level].load(std::memory_order_acquire);
+  }
+  void set_next(int level, SkipListNode *node) {
+    forward_[level].store(node, std::memory_order_release);
   }
-  bool operator>(const SkipListNode &other) const {
-    if (key_ == other.key_) {
-      // key 相等时，trans_id 更大的优先级更高
-      return tranc_id_ < other.tranc_id_;
+  bool cas_next(int level, SkipListNode *expected, SkipListNode *node) {
+    return forward_[level].compare_exchange_strong(expected, node,
+                                                   std::memory_order_acq_rel);
+  }
+
+  // 排序规则: 按 key 升序, key 相等时 tranc_id 更大的优先级更高
+  bool less(std::string_view key, uint64_t tranc_id) const {
+    auto cmp = this->key().compare(key);
+    if (cmp == 0) {
+      return tranc_id_ > tranc_id;
     }
-    return key_ > other.key_;
+    return cmp < 0;
   }
 };
 
@@ -66,8 +82,9 @@ public:
   //     : current(node),
   //       lock(std::make_shared<std::shared_lock<std::shared_mutex>>(mutex)) {}
 
-  // 构造函数
-  SkipListIterator(std::shared_ptr<SkipListNode> node) : current(node) {}
+  // 构造函数, arena 保证迭代期间节点不会被释放
+  SkipListIterator(SkipListNode *node, std::shared_ptr<Arena> arena)
+      : current(node), arena_(std::move(arena)) {}
 
   // 空迭代器构造函数
   SkipListIterator() : current(nullptr), lock(nullptr) {}
@@ -76,6 +93,8 @@ public:
   virtual bool operator==(const BaseIterator &other) const override;
   virtual bool operator!=(const BaseIterator &other) const override;
   virtual value_type operator*() const override;
+  virtual std::string_view key() const override;
+  virtual std::string_view value() const override;
   virtual IteratorType get_type() const override;
   virtual bool is_end() const override;
   virtual bool is_valid() const override;
@@ -84,38 +103,40 @@ public:
   uint64_t get_tranc_id() const override;
 
 private:
-  std::shared_ptr<SkipListNode> current;
+  SkipListNode *current;
+  std::shared_ptr<Arena> arena_;
   std::shared_ptr<std::shared_lock<std::shared_mutex>>
       lock; // 持有读锁, 整个迭代器有效期间都持有读锁
 };
 
 // ************************ SkipList ************************
 
+// put 和所有读取操作可以被多个线程并发调用, 读取不需要加锁;
+// remove 和 clear 会修改已发布的节点, 调用者需要保证没有其他线程访问
 class SkipList {
 private:
-  std::shared_ptr<SkipListNode>
-      head; // 跳表的头节点，不存储实际数据，用于遍历跳表
-  int max_level;     // 跳表的最大层级数，限制跳表的高度
-  int current_level; // 跳表当前的实际层级数，动态变化
-  size_t size_bytes = 0; // 跳表当前占用的内存大小（字节数），用于跟踪内存使用
-  // std::shared_mutex rw_mutex; // ! 目前看起来这个锁是冗余的, 在上层控制即可,
-  // 后续考虑是否需要细粒度的锁
-
-  std::uniform_int_distribution<> dis_01;
-  std::uniform_int_distribution<> dis_level;
-  std::mt19937 gen;
+  // 所有节点所在的内存池, 由跳表和其迭代器共享, 最后一个持有者析构时释放
+  std::shared_ptr<Arena> arena_;
+  // 头节点单独分配, 不计入跳表的内存大小, 空跳表的大小为 0
+  Arena head_arena_;
+  SkipListNode *head; // 跳表的头节点，不存储实际数据，用于遍历跳表
+  int max_level;      // 跳表的最大层级数，限制跳表的高度
+  std::atomic<int> current_level; // 跳表当前的实际层级数，动态变化
 
 private:
   int random_level(); // 生成新节点的随机层级数
 
+  // 在 level 层从 before 开始向后查找 (key, tranc_id) 的插入位置,
+  // 返回 prev < (key, tranc_id) <= next
+  void find_splice_for_level(const std::string &key, uint64_t tranc_id,
+                             SkipListNode *before, int level,
+                             SkipListNode *&prev, SkipListNode *&next) const;
+
 public:
   SkipList(int max_lvl = 16); // 构造函数，初始化跳表
 
-  // 析构函数需要确保没有其他线程访问
-  ~SkipList() {
-    // std::unique_lock<std::shared_mutex> lock(rw_mutex);
-    // ... 清理资源
-  }
+  SkipList(const SkipList &) = delete;
+  SkipList &operator=(const SkipList &) = delete;
 
   // 插入或更新键值对
   // 这里不对 tranc_id 进行检查，由上层保证 tranc_id 的合法性
@@ -137,12 +158,15 @@ public:
   // value 为 真实 value 和 tranc_id 的二元组
   std::vector<std::tuple<std::string, std::string, uint64_t>> flush();
 
+  // 跳表占用的内存大小, 即内存池向系统申请的内存
   size_t get_size();
 
   void clear(); // 清空跳表，释放内存
 
   SkipListIterator begin();
   SkipListIterator begin_preffix(const std::string &preffix);
+  // 返回第一个 key 不小于 key 的节点
+  SkipListIterator lower_bound(const std::string &key);
 
   SkipListIterator end();
   SkipListIterator end_preffix(const std::string &preffix);
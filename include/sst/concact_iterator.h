@@ -15,9 +15,15 @@ private:
 
 public:
   ConcactIterator(std::vector<std::shared_ptr<SST>> ssts, uint64_t tranc_id);
+  // ssts 需要按 key 有序且互不重叠, 迭代器定位到第一个不小于 lower 的条目
+  ConcactIterator(std::vector<std::shared_ptr<SST>> ssts, uint64_t tranc_id,
+                  const std::string &lower);
 
-  std::string key();
-  std::string value();
+  // 显式指定预读窗口, 对之后遍历的所有 sst 生效, 见 SstIterator::set_readahead
+  void set_readahead(size_t blocks, bool fill_cache);
+
+  virtual std::string_view key() const override;
+  virtual std::string_view value() const override;
 
   virtual BaseIterator &operator++() override;
   virtual bool operator==(const BaseIterator &other) const override;
@@ -3,8 +3,11 @@
 #include "../block/block.h"
 #include "../block/block_cache.h"
 #include "../block/blockmeta.h"
+#include "../block/fence_index.h"
 #include "../utils/bloom_filter.h"
 #include "../utils/files.h"
+#include "../utils/prefix_extractor.h"
+#include "sst_partition.h"
 #include <cstddef>
 #include <cstdint>
 #include <memory>
@@ -37,8 +40,30 @@ class SstIterator;
  * ---------------------------------------------------------------
  * 其中, num_entries 表示 metadata 数组的长度, Hash 是 metadata
  数组的哈希值(只包括数组部分, 不包括 num_entries ), 用于校验 metadata 的完整性
+
+ * 分区格式 (见 sst_partition.h) 的文件结构如下:
+ * ---------------------------------------------------------------------------
+ * | Block Section | Index Partitions | Filter Partitions | Partition Index |
+ * ---------------------------------------------------------------------------
+ * | meta_offset (32) | bloom_offset (32) | min_tranc_id (64) |
+ * | max_tranc_id (64) | SST_PARTITIONED_MAGIC (64) |
+ * ---------------------------------------------------------------------------
+ * 其中 meta_offset 指向第一个索引分区 (即 Block Section 的结尾),
+ * bloom_offset 指向顶层的 Partition Index
+
+ * 两种格式都可以在 footer 之前附加前缀过滤器 (见 prefix_extractor.h):
+ * ---------------------------------------------------------------------------
+ * | prefix bloom | stride (32) | max_len (32) | prefix bloom size (32) |
+ * | SST_PREFIX_FILTER_MAGIC (64) |
+ * ---------------------------------------------------------------------------
+ * 没有魔数时表示该 sst 没有前缀过滤器
  */
 
+// 分区格式 sst 的 footer 末尾的魔数
+constexpr uint64_t SST_PARTITIONED_MAGIC = 0x5844495054524150ULL;
+// 前缀过滤器末尾的魔数
+constexpr uint64_t SST_PREFIX_FILTER_MAGIC = 0x5846455250545353ULL;
+
 class SST : public std::enable_shared_from_this<SST> {
   friend class SSTBuilder;
   friend std::optional<std::pair<SstIterator, SstIterator>>
@@ -48,7 +73,12 @@ class SST : public std::enable_shared_from_this<SST> {
 
 private:
   FileObj file;
+  // 完整的 block 元数据只在无法构建栅栏索引时常驻, 否则为空,
+  // 需要首尾 key 时通过 load_meta_entries 按需加载
   std::vector<BlockMeta> meta_entries;
+  FenceIndex fence_index; // 点查定位 block 使用的栅栏索引
+  // 每个 block 在文件中的偏移, 非分区格式下常驻
+  std::vector<uint32_t> block_offsets_;
   uint32_t bloom_offset;
   uint32_t meta_block_offset;
   size_t sst_id;
@@ -59,6 +89,33 @@ private:
   uint64_t min_tranc_id_ = UINT64_MAX;
   uint64_t max_tranc_id_ = 0;
 
+  // 前缀过滤器, 为空表示没有前缀过滤器
+  std::shared_ptr<BloomFilter> prefix_bloom_;
+  PrefixExtractor prefix_extractor_;
+
+  // 读取 [bloom_offset, sections_end) 末尾的前缀过滤器,
+  // 返回去掉前缀过滤器后的结束位置
+  size_t read_prefix_filter(size_t sections_end);
+
+  // 分区格式下 meta_entries 和 bloom_filter 为空, 只常驻顶层索引
+  bool partitioned_ = false;
+  size_t num_blocks_ = 0;
+  std::vector<PartitionHandle> partitions_;
+
+  // 返回可能包含 key 的分区, 不存在时返回 -1
+  size_t find_partition_by_key(const std::string &key) const;
+  // 返回包含 block_idx 的分区
+  size_t find_partition_by_block(size_t block_idx) const;
+  // 通过 BlockCache 按需加载分区
+  std::shared_ptr<IndexPartition> load_index_partition(size_t part_idx);
+  std::shared_ptr<FilterPartition> load_filter_partition(size_t part_idx);
+  // 返回 block 在文件中的偏移和大小
+  std::pair<size_t, size_t> block_location(size_t block_idx);
+  // 根据完整的元数据构建常驻的索引, 能构建栅栏索引时不保留 metas
+  void init_index(std::vector<BlockMeta> metas);
+  // 通过 BlockCache 按需加载非分区格式的完整元数据
+  std::shared_ptr<IndexPartition> load_meta_entries();
+
 public:
   // 从文件中打开sst
   static std::shared_ptr<SST> open(size_t sst_id, FileObj file,
@@ -71,20 +128,57 @@ public:
   // 根据索引读取block
   std::shared_ptr<Block> read_block(size_t block_idx);
 
+  // 批量读取 block, 缓存未命中的 block 并发读取后放入 BlockCache
+  // 返回的 block 与 block_idxs 一一对应
+  // fill_cache 为 false 时只读取, 不放入缓存
+  std::vector<std::shared_ptr<Block>>
+  read_blocks(const std::vector<size_t> &block_idxs, bool fill_cache = true);
+
   // 找到key所在的block的idx
   size_t find_block_idx(const std::string &key);
 
+  // 返回第一个可能包含不小于 key 的条目的 block 的idx, 不存在时返回 block 数量
+  size_t lower_bound_block_idx(const std::string &key);
+
+  // 根据布隆过滤器判断key是否可能存在, 没有布隆过滤器时总是返回true
+  bool may_contain(const std::string &key);
+
+  // 根据前缀过滤器判断是否可能存在以 prefix 开头的 key,
+  // 没有前缀过滤器或前缀过短时总是返回true
+  bool may_contain_prefix(const std::string &prefix) const;
+
+  // 返回指定 block 的元数据
+  BlockMeta get_block_meta(size_t block_idx);
+
+  // 是否为分区格式
+  bool is_partitioned() const;
+
   // 根据key返回迭代器
   SstIterator get(const std::string &key, uint64_t tranc_id);
 
+  // 与 get 相同, 但不检查布隆过滤器, 供已经检查过过滤器的调用者使用.
+  // key_exists 不为空时报告是否存在 key 的任意版本, 不可见的版本不算误判
+  SstIterator find(const std::string &key, uint64_t tranc_id,
+                   bool *key_exists = nullptr);
+
+  // 批量点查, keys 需要按升序排列, 不检查布隆过滤器
+  // 所需的 block 通过 read_blocks 一次性读取, 删除标记以空 value 返回.
+  // key_exists 不为空时与 keys 一一对应, 报告是否存在 key 的任意版本
+  std::vector<std::optional<std::pair<std::string, uint64_t>>>
+  get_batch(const std::vector<std::string> &keys, uint64_t tranc_id,
+            std::vector<bool> *key_exists = nullptr);
+
+  // 返回指向第一个不小于 key 的条目的迭代器
+  SstIterator lower_bound(const std::string &key, uint64_t tranc_id);
+
   // 返回sst中block的数量
   size_t num_blocks() const;
 
   // 返回sst的首key
-  std::string get_first_key() const;
+  const std::string &get_first_key() const;
 
   // 返回sst的尾key
-  std::string get_last_key() const;
+  const std::string &get_last_key() const;
 
   // 返回sst的大小
   size_t sst_size() const;
@@ -121,9 +215,35 @@ private:
   uint64_t min_tranc_id_ = UINT64_MAX;
   uint64_t max_tranc_id_ = 0;
 
+  // 分区格式相关, partition_blocks_ 为 0 表示不分区
+  bool has_bloom_;
+  size_t partition_blocks_;
+  size_t partition_start_ = 0; // 当前分区第一个 block 的索引
+  std::vector<std::string> partition_keys_;
+  std::vector<PartitionHandle> partitions_;
+  std::vector<uint8_t> index_data_;
+  std::vector<uint8_t> filter_data_;
+
+  // 前缀过滤器相关, 在 key 变化时添加新出现的前缀
+  PrefixExtractor prefix_extractor_;
+  std::shared_ptr<BloomFilter> prefix_bloom_;
+  std::string prefix_last_key_;
+  std::vector<std::string_view> prefix_buf_;
+
+  // 将前缀过滤器追加到 file_content 末尾
+  void append_prefix_filter(std::vector<uint8_t> &file_content);
+
+  // 完成当前分区的构建, 将其索引和过滤器编码到 index_data_ 和 filter_data_
+  void finish_partition();
+  std::shared_ptr<SST> build_partitioned(size_t sst_id, const std::string &path,
+                                         std::shared_ptr<BlockCache> block_cache);
+
 public:
   // 创建一个sst构建器, 指定目标block的大小
-  SSTBuilder(size_t block_size, bool has_bloom); // 添加一个key-value对
+  // partition_blocks 不为 0 时使用分区格式, 每个分区包含 partition_blocks 个
+  // block
+  SSTBuilder(size_t block_size, bool has_bloom, size_t partition_blocks = 0);
+  // 添加一个key-value对
   void add(const std::string &key, const std::string &value, uint64_t tranc_id);
   // 估计sst的大小
   size_t estimated_size() const;
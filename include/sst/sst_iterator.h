@@ -1,6 +1,7 @@
 #pragma once
 #include "../block/block_iterator.h"
 #include <cstddef>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <optional>
@@ -31,10 +32,26 @@ private:
   std::shared_ptr<BlockIterator> m_block_it;
   mutable std::optional<value_type> cached_value; // 缓存当前值
 
+  // 预读相关, 顺序读取 block 时一次读取后续的多个 block
+  size_t readahead_max_;         // 自适应预读窗口的上限, 0 表示不预读
+  size_t readahead_window_ = 0;  // 当前的预读窗口 (block 数)
+  size_t sequential_reads_ = 0;  // 连续顺序读取 block 的次数
+  bool readahead_fixed_ = false; // 是否显式指定了预读窗口
+  bool readahead_fill_cache_ = true;
+  // 已预读的 block, 依次为 m_block_idx 之后的 block
+  std::deque<std::shared_ptr<Block>> readahead_blocks_;
+
   void update_current() const;
   void set_block_idx(size_t idx);
   void set_block_it(std::shared_ptr<BlockIterator> it);
 
+  // 随机定位后清空预读状态
+  void reset_readahead();
+  // 顺序读取 m_block_idx 对应的 block, 必要时预读后续的 block
+  std::shared_ptr<Block> next_block();
+  // 从 m_block_idx 开始顺序查找第一个有可见记录的 block, 找不到时置为 end
+  void skip_to_visible_block();
+
 public:
   // 创建迭代器, 并移动到第一个key
   SstIterator(std::shared_ptr<SST> sst, uint64_t tranc_id);
@@ -49,8 +66,17 @@ public:
 
   void seek_first();
   void seek(const std::string &key);
-  std::string key();
-  std::string value();
+  // 移动到另一个 sst 的第一个可见条目, 沿用当前的预读状态,
+  // 用于顺序遍历多个 sst
+  void continue_with(std::shared_ptr<SST> sst);
+
+  // 显式指定每次预读 blocks 个 block, 不再自适应调整
+  // fill_cache 为 false 时预读的 block 不放入 BlockCache, 用于 compaction
+  void set_readahead(size_t blocks, bool fill_cache);
+  // 移动到第一个不小于 key 的条目, 与 seek 不同, key 不需要存在
+  void lower_bound(const std::string &key);
+  virtual std::string_view key() const override;
+  virtual std::string_view value() const override;
 
   virtual BaseIterator &operator++() override;
   virtual bool operator==(const BaseIterator &other) const override;
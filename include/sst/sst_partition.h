@@ -0,0 +1,65 @@
+#pragma once
+
+#include "../block/block_cache.h"
+#include "../block/blockmeta.h"
+#include "../block/fence_index.h"
+#include "../utils/bloom_filter.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace tiny_lsm {
+
+/**
+ * 分区格式的 sst 将索引(BlockMeta 数组)和布隆过滤器按连续的 block
+ * 切分为多个分区, 打开 sst 时只读取很小的顶层索引, 分区在查询时按需通过
+ * BlockCache 以高优先级加载
+ *
+ * 顶层索引的结构如下:
+ * ---------------------------------------------------------------------------
+ * | num_blocks (32) | num_partitions (32) | Handle | ... | Handle | Hash (32) |
+ * ---------------------------------------------------------------------------
+ * 每个 Handle 的结构如下:
+ * ---------------------------------------------------------------------------
+ * | first_block_idx (32) | data_offset (32) | index_offset (32) |
+ * | index_size (32) | filter_offset (32) | filter_size (32) |
+ * | first_key_len (16) | first_key | last_key_len (16) | last_key |
+ * ---------------------------------------------------------------------------
+ * index 分区的内容与非分区格式的 Meta Section 相同, filter 分区是一个编码后的
+ * BloomFilter, filter_size 为 0 表示没有过滤器
+ */
+struct PartitionHandle {
+  uint32_t first_block_idx = 0; // 分区内第一个 block 在 sst 中的索引
+  uint32_t data_offset = 0;     // 分区内第一个 block 在文件中的偏移
+  uint32_t index_offset = 0;
+  uint32_t index_size = 0;
+  uint32_t filter_offset = 0;
+  uint32_t filter_size = 0;
+  std::string first_key;
+  std::string last_key;
+
+  static void encode_partitions(const std::vector<PartitionHandle> &handles,
+                                uint32_t num_blocks,
+                                std::vector<uint8_t> &out);
+  static std::vector<PartitionHandle>
+  decode_partitions(const std::vector<uint8_t> &data, uint32_t &num_blocks);
+};
+
+// 缓存中的索引分区
+class IndexPartition : public CacheEntry {
+public:
+  std::vector<BlockMeta> metas;
+  FenceIndex fence_index;
+
+  explicit IndexPartition(std::vector<BlockMeta> metas);
+};
+
+// 缓存中的过滤器分区
+class FilterPartition : public CacheEntry {
+public:
+  BloomFilter bloom_filter;
+
+  explicit FilterPartition(BloomFilter bloom_filter);
+};
+} // namespace tiny_lsm
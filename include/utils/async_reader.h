@@ -0,0 +1,54 @@
+#pragma once
+
+#include "files.h"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tiny_lsm {
+
+// 一次读取请求, 完成后 data 中为读取的数据, 失败时 error 记录异常
+struct ReadRequest {
+  FileObj *file;
+  size_t offset;
+  size_t length;
+  std::vector<uint8_t> data;
+  std::exception_ptr error;
+};
+
+/**
+ * 并发读取器, 由固定数量的后台线程执行 pread
+ *
+ * read_all 将一批请求分发给后台线程, 调用线程也参与执行, 因此同一时刻
+ * 最多有 queue_depth + 1 个读取在进行. queue_depth 为 0 时所有请求在调用线程
+ * 中顺序执行
+ */
+class AsyncReader {
+public:
+  explicit AsyncReader(size_t queue_depth);
+  ~AsyncReader();
+
+  AsyncReader(const AsyncReader &) = delete;
+  AsyncReader &operator=(const AsyncReader &) = delete;
+
+  size_t queue_depth() const;
+
+  // 并发执行一批读取请求, 所有请求完成后返回
+  void read_all(std::vector<ReadRequest> &requests);
+
+private:
+  void worker_loop();
+
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<std::function<void()>> tasks_;
+  bool stop_ = false;
+};
+} // namespace tiny_lsm
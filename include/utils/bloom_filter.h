@@ -53,5 +53,8 @@ private:
   size_t hash2(const std::string &key) const;
 
   size_t hash(const std::string &key, size_t idx) const;
+
+  // 由两个基础哈希值组合出第 idx 个哈希值
+  size_t combine_hash(size_t h1, size_t h2, size_t idx) const;
 };
 } // namespace tiny_lsm
\ No newline at end of file
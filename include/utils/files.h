@@ -14,6 +14,8 @@ class FileObj {
 private:
   std::unique_ptr<StdFile> m_file;
   size_t m_size;
+  // 只读映射, 存在时读取操作直接从映射中获取数据
+  std::shared_ptr<MmapFile> m_mmap;
 
 public:
   FileObj();
@@ -44,9 +46,25 @@ public:
   // 打开文件对象
   static FileObj open(const std::string &path, bool create);
 
+  // 打开文件对象并建立只读映射, 用于不再修改的文件 (如 sst)
+  static FileObj open_mmap(const std::string &path);
+
+  // 返回映射中的一段内存, 返回的指针同时持有映射的所有权,
+  // 没有映射时返回 nullptr
+  std::shared_ptr<const uint8_t> mapped_slice(size_t offset, size_t length);
+
   // 读取并返回切片
   std::vector<uint8_t> read_to_slice(size_t offset, size_t length);
 
+  // 与 read_to_slice 相同, 但可以被多个线程并发调用
+  std::vector<uint8_t> pread_to_slice(size_t offset, size_t length);
+
+  // 是否建立了只读映射
+  bool is_mapped() const;
+
+  // 提示内核预读映射中的一段数据, 没有映射时不做任何事
+  void advise_willneed(size_t offset, size_t length);
+
   // 读取 uint8_t
   uint8_t read_uint8(size_t offset);
 
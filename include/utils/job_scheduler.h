@@ -0,0 +1,82 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tiny_lsm {
+
+enum class JobPriority {
+  // 影响写入的任务, 如 memtable 刷盘
+  HIGH,
+  // 可以延后的任务, 如 compaction, WAL 清理, 删除文件
+  LOW,
+};
+
+/**
+ * 后台任务调度器, 不同优先级的任务由各自的线程池执行
+ *
+ * 低优先级线程会降低自身的调度优先级 (nice), 避免占用前台请求的 CPU.
+ * shutdown 后不再接受新任务, 尚未开始的任务被丢弃, 正在执行的任务
+ * 可以通过 is_shutting_down 提前结束
+ */
+class JobScheduler {
+public:
+  JobScheduler(size_t high_threads, size_t low_threads);
+  ~JobScheduler();
+
+  JobScheduler(const JobScheduler &) = delete;
+  JobScheduler &operator=(const JobScheduler &) = delete;
+
+  // 提交任务, 调度器已关闭时返回 false
+  bool schedule(JobPriority priority, std::function<void()> job);
+
+  // 等待 delay 之后再提交任务, 等待期间不占用线程, 用于失败后的重试
+  bool schedule_after(JobPriority priority, std::chrono::milliseconds delay,
+                      std::function<void()> job);
+
+  // 停止接受新任务, 丢弃排队的任务并等待正在执行的任务结束,
+  // 返回被丢弃的任务数量 (包括尚未到期的延迟任务)
+  size_t shutdown();
+
+  bool is_shutting_down();
+
+  // 等待直到所有线程池都没有排队, 延迟和正在执行的任务
+  void wait_for_idle();
+
+  // 排队中尚未开始的任务数量
+  size_t pending(JobPriority priority);
+
+private:
+  struct Pool {
+    std::deque<std::function<void()>> jobs;
+    std::vector<std::thread> threads;
+    size_t running = 0;
+  };
+
+  struct DelayedJob {
+    std::chrono::steady_clock::time_point due;
+    JobPriority priority;
+    std::function<void()> job;
+  };
+
+  Pool &pool_(JobPriority priority);
+  void worker_loop_(JobPriority priority);
+  bool idle_() const;
+  // 将到期的延迟任务移入对应的线程池, 需要持有 mutex_
+  void promote_due_jobs_();
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::condition_variable idle_cv_;
+  Pool high_;
+  Pool low_;
+  std::vector<DelayedJob> delayed_;
+  bool stop_ = false;
+};
+} // namespace tiny_lsm
@@ -30,6 +30,14 @@ public:
   // 打开文件并映射到内存
   bool open(const std::string &filename, bool create = false);
 
+  // 以只读方式打开文件并映射到内存, 映射后的内容可以被多个线程并发读取
+  bool open_readonly(const std::string &filename);
+
+  // 返回映射内存中 offset 处的指针, 只读映射时不能通过它写入
+  const uint8_t *data_at(size_t offset) const {
+    return static_cast<const uint8_t *>(mapped_data_) + offset;
+  }
+
   // 创建文件
   bool create(const std::string &filename, std::vector<uint8_t> &buf);
 
@@ -39,6 +47,9 @@ public:
   // 获取文件大小
   size_t size() const { return file_size_; }
 
+  // 提示内核异步预读 [offset, offset + length) 所在的页
+  void advise_willneed(size_t offset, size_t length) const;
+
   // 写入数据
   bool write(size_t offset, const void *data, size_t size);
 
@@ -48,6 +59,9 @@ public:
   // 同步到磁盘
   bool sync();
 
+  // 删除文件
+  bool remove();
+
 private:
   // 禁止拷贝
   MmapFile(const MmapFile &) = delete;
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace tiny_lsm {
+
+/**
+ * 前缀提取器, 为前缀过滤器提供 key 的前缀
+ *
+ * 每个 key 提取长度为 stride, 2 * stride, ... (不超过 max_len 和 key 的长度)
+ * 的前缀. 查询前缀 p 时使用长度不超过 |p| 的最长一档前缀, 所有以 p 开头的
+ * key 都提取过这一前缀, 因此过滤器判断不存在时可以跳过整个 sst
+ *
+ * Redis 的 key 由较长的类型前缀加上用户 key 组成, 多档长度使得不同长度的
+ * 用户 key 都能落在某一档上
+ */
+class PrefixExtractor {
+public:
+  // stride 为 0 表示不提取前缀
+  PrefixExtractor(size_t stride = 0, size_t max_len = 0);
+
+  bool enabled() const;
+  size_t stride() const;
+  size_t max_len() const;
+
+  // 对于有序写入的 key, 返回 key 相对上一个 key prev 新出现的前缀
+  // 与 prev 共享的前缀已经添加过, 不再重复返回
+  void new_prefixes(std::string_view prev, std::string_view key,
+                    std::vector<std::string_view> &out) const;
+
+  // 返回查询前缀 prefix 时应使用的过滤器前缀长度, 0 表示无法使用过滤器
+  size_t query_len(size_t prefix_len) const;
+
+private:
+  size_t stride_;
+  size_t max_len_;
+};
+} // namespace tiny_lsm
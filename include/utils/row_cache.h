@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace tiny_lsm {
+
+/**
+ * 行缓存, 缓存 key 的最新版本的查询结果 (包括删除标记和不存在的负结果)
+ *
+ * 缓存项记录最新版本的 tranc_id, 对于快照 tranc_id 为 S 的查询,
+ * 当 S == 0 或最新版本的 tranc_id <= S 时, 缓存的结果即为该快照下的可见结果
+ *
+ * 写入 memtable 后需要调用 invalidate 使对应 key 失效. 为了避免
+ * "读取旧结果 -> 写入并失效 -> 插入旧结果" 的竞争, 查询前先通过 generation
+ * 获取分片的版本号, insert 时若分片已经发生过失效则放弃插入
+ */
+class RowCache {
+public:
+  // capacity_bytes: 缓存占用内存的上限
+  RowCache(size_t capacity_bytes, size_t num_shards = 16);
+  ~RowCache();
+
+  // 查询 key 在快照 tranc_id 下的结果, 未命中或缓存结果对该快照不可见时返回
+  // false; 命中时 value 的含义与 insert 的 version 相同
+  bool lookup(const std::string &key, uint64_t tranc_id,
+              std::optional<std::pair<std::string, uint64_t>> &value);
+
+  // 返回 key 所在分片的版本号, 需要在查询 lsm 之前调用
+  uint64_t generation(const std::string &key);
+
+  // 插入 key 的最新版本, value 为空字符串表示删除标记, nullopt 表示不存在
+  void insert(const std::string &key,
+              const std::optional<std::pair<std::string, uint64_t>> &version,
+              uint64_t generation);
+
+  void invalidate(const std::string &key);
+  void clear();
+
+  size_t size_bytes() const;
+  double hit_rate() const;
+
+private:
+  struct Item {
+    std::string key;
+    std::string value;
+    uint64_t tranc_id; // 最新版本的事务id, 不存在时为 0
+    bool found;        // false 表示 key 不存在
+    size_t charge;     // 占用的内存
+  };
+
+  using ItemMap = std::unordered_map<std::string, std::list<Item>::iterator>;
+
+  struct Shard {
+    std::mutex mutex;
+    std::list<Item> lru_list; // 头部为最近访问
+    ItemMap map;
+    size_t usage = 0;
+    uint64_t generation = 0;
+  };
+
+  Shard &get_shard(const std::string &key);
+  // 需持有分片的锁
+  void erase_(Shard &shard, ItemMap::iterator it);
+
+  size_t shard_capacity_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+
+  // 记录请求数和命中数
+  std::atomic<uint64_t> total_requests_{0};
+  std::atomic<uint64_t> hit_requests_{0};
+};
+} // namespace tiny_lsm
@@ -12,6 +12,8 @@ class StdFile {
 private:
   std::fstream file_;
   std::filesystem::path filename_;
+  // 只读描述符, 用于可以并发执行的 pread
+  int read_fd_ = -1;
 
 public:
   StdFile() {}
@@ -39,6 +41,9 @@ public:
   // 读取数据
   std::vector<uint8_t> read(size_t offset, size_t length);
 
+  // 使用 pread 读取数据, 不移动 fstream 的读写位置, 可以被多个线程并发调用
+  std::vector<uint8_t> pread(size_t offset, size_t length);
+
   // 同步到磁盘
   bool sync();
 
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace tiny_lsm {
+
+/**
+ * WAL 文件的追加写入器
+ *
+ * 记录先复制到用户态缓冲区, 缓冲区写满或 sync 时使用 pwrite 写到文件末尾,
+ * sync 再调用 fdatasync 落盘, 每次提交的开销只与写入的数据量有关.
+ * 文件以 FALLOC_FL_KEEP_SIZE 按块预分配空间, 追加时不需要分配新的磁盘块,
+ * 同时文件的逻辑大小不变, 恢复时不会读到预分配的空白区域
+ */
+class LogWriter {
+public:
+  LogWriter() = default;
+  ~LogWriter();
+
+  LogWriter(const LogWriter &) = delete;
+  LogWriter &operator=(const LogWriter &) = delete;
+
+  LogWriter(LogWriter &&other) noexcept;
+  LogWriter &operator=(LogWriter &&other) noexcept;
+
+  // 打开文件, 不存在时创建, 已有的内容会保留
+  static LogWriter open(const std::string &path,
+                        size_t preallocate_size = 1024 * 1024,
+                        size_t buffer_capacity = 64 * 1024);
+
+  // 文件大小, 包含缓冲区中尚未写入的数据
+  size_t size() const;
+
+  // 追加数据到缓冲区, 缓冲区写满时写入文件
+  void append(const uint8_t *data, size_t length);
+  void append(const std::vector<uint8_t> &buf);
+
+  // 将缓冲区写入文件, 不保证落盘
+  void flush();
+
+  // 写入缓冲区并 fdatasync
+  bool sync();
+
+  void close();
+
+private:
+  void write_(const uint8_t *data, size_t length);
+  void preallocate_(size_t end);
+
+  int fd_ = -1;
+  std::string path_;
+  // 已写入文件的大小
+  size_t file_size_ = 0;
+  // 已预分配的文件范围
+  size_t allocated_ = 0;
+  size_t preallocate_size_ = 0;
+  std::vector<uint8_t> buffer_;
+  size_t buffer_capacity_ = 0;
+};
+} // namespace tiny_lsm
@@ -2,6 +2,7 @@
 
 #include <cstdint>
 #include <iostream>
+#include <optional>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -37,11 +38,17 @@ public:
   // 解码记录
   static std::vector<Record> decode(const std::vector<uint8_t> &data);
 
+  // 从 data 开始解码一条记录, 剩余 size 字节不足一条完整记录时返回空,
+  // 记录格式错误时抛出异常
+  static std::optional<Record> decode_one(const uint8_t *data, size_t size);
+
   // 获取记录的各个部分
   uint64_t getTrancId() const { return tranc_id_; }
   OperationType getOperationType() const { return operation_type_; }
   std::string getKey() const { return key_; }
   std::string getValue() const { return value_; }
+  // 编码后的长度
+  uint16_t getRecordLen() const { return record_len_; }
 
   // 打印记录（用于调试）
   void print() const;
@@ -2,19 +2,33 @@
 
 #pragma once
 
-#include "../utils/files.h"
+#include "../utils/job_scheduler.h"
+#include "log_writer.h"
 #include "record.h"
 #include <atomic>
 #include <condition_variable>
 #include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
 #include <thread>
 #include <vector>
 
 namespace tiny_lsm {
 
+/**
+ * 预写日志
+ *
+ * 日志由编号递增的段文件 wal.<seq>.log 组成, 当前段超过 file_size_limit
+ * 后切换到新的段. 每个段记录其中最大的 tranc_id, 已经全部 flush 到 sst
+ * (max tranc_id <= max_flushed_tranc_id) 的段由清理线程 (或设置的调度器中的
+ * 低优先级任务) 删除, 恢复时只需要读取剩余的段
+ */
 class WAL {
 public:
   WAL(const std::string &log_dir, size_t buffer_size,
@@ -22,21 +36,75 @@ public:
       uint64_t file_size_limit);
   ~WAL();
 
+  // 已提交事务的回调, records 为该事务的全部记录 (包含 COMMIT)
+  using ReplayCallback =
+      std::function<void(uint64_t tranc_id, std::vector<Record> &records)>;
+
+  // 返回需要重放的已提交事务, 基于 replay 实现
   static std::map<uint64_t, std::vector<Record>>
   recover(const std::string &log_dir, uint64_t max_finished_tranc_id);
 
-  // 将记录添加到缓冲区
-  void log(const std::vector<Record> &records, bool force_flush = false);
+  // 流式重放日志: 按块读取每个段并在一遍扫描中跟踪 COMMIT 标记,
+  // 对 tranc_id > max_flushed_tranc_id 的已提交事务调用 callback.
+  // 一个事务的记录总是位于同一个段中, 不同的段由最多 threads 个线程并行
+  // 解码, callback 只在调用线程中按段的顺序, 段内按 tranc_id 的顺序调用
+  static void replay(const std::string &log_dir, uint64_t max_flushed_tranc_id,
+                     const ReplayCallback &callback, size_t threads = 1);
+
+  // 更新已持久化到 sst 的最大事务 id, 清理线程据此删除段.
+  // 设置了调度器时立即提交一个低优先级的清理任务
+  void set_max_flushed_tranc_id(uint64_t tranc_id);
+
+  // 改为在调度器中清理段并停止清理线程, 需要在开始写入前调用
+  void set_scheduler(std::shared_ptr<JobScheduler> scheduler);
+
+  // 删除已经全部 flush 的非活跃段, 由清理线程周期性调用
+  void clean_flushed_segments();
+
+  // 当前的段数量, 包含活跃段
+  size_t segment_count();
+
+  // 将记录添加到缓冲区, 缓冲区写满时连同缓冲区一起写入文件
+  // force_flush 时以组提交的方式写入: 并发的提交者排队, 队首的 leader
+  // 将一组提交的记录合并后只写入并 sync 一次, 再唤醒组内的 follower.
+  // sync 为 false 时只写入操作系统, 组内有任意写入者要求 sync 时才会 sync
+  void log(const std::vector<Record> &records, bool force_flush = false,
+           bool sync = true);
 
   // 写入 WAL 文件
   void flush();
 
 private:
+  // 等待组提交的写入者, 位于调用者的栈上
+  struct Writer {
+    const std::vector<Record> *records;
+    bool sync;
+    bool done = false;
+    std::exception_ptr error;
+    std::condition_variable cv;
+  };
+
+  // 排队并等待所在的组写入完成, 需要持有 mutex_
+  void group_commit_(std::unique_lock<std::mutex> &lock,
+                     const std::vector<Record> &records, bool sync);
   void cleaner();
 
+  // 关闭当前段并打开新的段, 只由 leader 调用
+  void roll_segment_();
+
+  // 目录中已有的段, seq -> 路径
+  static std::map<uint64_t, std::string>
+  list_segments_(const std::string &log_dir);
+  static std::string segment_path_(const std::string &log_dir, uint64_t seq);
+
+  // 按块读取一个段并依次解码其中的记录, 末尾不完整的记录 (写入时崩溃)
+  // 会被忽略
+  static void scan_segment_(const std::string &path,
+                            const std::function<void(Record &)> &fn);
+
 protected:
   std::string active_log_path_;
-  FileObj log_file_;
+  LogWriter log_file_;
   size_t file_size_limit_;
   std::mutex mutex_;
   std::vector<Record> log_buffer_;
@@ -45,5 +113,36 @@ protected:
   uint64_t max_finished_tranc_id_;
   uint64_t clean_interval_;
   std::atomic<bool> stop_cleaner_;
+
+private:
+  // 不再写入的段, max_tranc_id 未知时 (上次运行留下的段) 由清理线程读取计算
+  struct Segment {
+    std::string path;
+    std::optional<uint64_t> max_tranc_id;
+  };
+
+  std::string log_dir_;
+  // 活跃段的编号和其中最大的 tranc_id, 只由 leader 修改
+  uint64_t active_seq_ = 0;
+  uint64_t active_max_tranc_id_ = 0;
+  std::mutex segments_mtx_;
+  std::map<uint64_t, Segment> sealed_segments_;
+  std::atomic<uint64_t> max_flushed_tranc_id_{0};
+  std::mutex cleaner_mtx_;
+  std::condition_variable cleaner_cv_;
+
+  // 清理任务通过 CleanState 访问 WAL, 析构时将 wal 置空,
+  // 之后才执行的任务直接返回
+  struct CleanState {
+    std::mutex mutex;
+    WAL *wal;
+  };
+  std::shared_ptr<JobScheduler> scheduler_;
+  std::shared_ptr<CleanState> clean_state_;
+  std::atomic<bool> clean_scheduled_{false};
+
+  std::deque<Writer *> writers_;
+  size_t group_commit_max_size_;
+  uint64_t group_commit_max_wait_us_;
 };
 } // namespace tiny_lsm
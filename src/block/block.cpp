@@ -1,5 +1,6 @@
 #include "../../include/block/block.h"
 #include "../../include/block/block_iterator.h"
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
@@ -14,11 +15,24 @@
 namespace tiny_lsm {
 Block::Block(size_t capacity) : capacity(capacity) {}
 
-std::vector<uint8_t> Block::encode() {
+std::vector<uint8_t> Block::encode(bool with_hash_index) {
   // TODO Lab 3.1 编码单个类实例形成一段字节数组
+  if (is_view_) {
+    throw std::runtime_error("Cannot encode a block view");
+  }
+  // 元素个数的最高位用于标记哈希索引, 元素过多时不构建索引
+  std::vector<uint16_t> buckets;
+  if (with_hash_index && !offsets.empty() && offsets.size() < HASH_INDEX_FLAG) {
+    buckets = build_hash_buckets();
+  }
+
   // 计算总大小：数据段 + 偏移数组(每个偏移2字节) + 元素个数(2字节)
   size_t total_bytes = data.size() * sizeof(uint8_t) +
                        offsets.size() * sizeof(uint16_t) + sizeof(uint16_t);
+  if (!buckets.empty()) {
+    // 桶数组 + 桶数量(2字节)
+    total_bytes += buckets.size() * sizeof(uint16_t) + sizeof(uint16_t);
+  }
   std::vector<uint8_t> encoded(total_bytes, 0);
 
   // 1. 复制数据段
@@ -31,89 +45,179 @@ std::vector<uint8_t> Block::encode() {
          offsets.size() * sizeof(uint16_t) // 总字节数
   );
 
-  // 3. 写入元素个数
+  // 3. 写入哈希索引
   size_t num_pos =
       data.size() * sizeof(uint8_t) + offsets.size() * sizeof(uint16_t);
   uint16_t num_elements = offsets.size();
+  if (!buckets.empty()) {
+    memcpy(encoded.data() + num_pos, buckets.data(),
+           buckets.size() * sizeof(uint16_t));
+    num_pos += buckets.size() * sizeof(uint16_t);
+    uint16_t num_buckets = buckets.size();
+    memcpy(encoded.data() + num_pos, &num_buckets, sizeof(uint16_t));
+    num_pos += sizeof(uint16_t);
+    num_elements |= HASH_INDEX_FLAG;
+  }
+
+  // 4. 写入元素个数
   memcpy(encoded.data() + num_pos, &num_elements, sizeof(uint16_t));
   return encoded;
 }
 
-std::shared_ptr<Block> Block::decode(const std::vector<uint8_t> &encoded,
-                                     bool with_hash) {
-  // TODO Lab 3.1 解码字节数组形成类实例
-  // 使用 make_shared 创建对象
-  auto block = std::make_shared<Block>();
+std::vector<uint16_t> Block::build_hash_buckets() const {
+  // 统计不同 key 的数量, 相同 key 的多个版本是连续存放的
+  size_t num_keys = 0;
+  for (size_t i = 0; i < num_offsets(); ++i) {
+    if (i == 0 || get_key_view_at(offset_at(i)) !=
+                      get_key_view_at(offset_at(i - 1))) {
+      num_keys++;
+    }
+  }
+
+  size_t num_buckets = static_cast<size_t>(num_keys / HASH_INDEX_UTIL_RATIO);
+  num_buckets = std::max<size_t>(1, std::min<size_t>(num_buckets, UINT16_MAX));
+
+  std::vector<uint16_t> buckets(num_buckets, HASH_BUCKET_EMPTY);
+  for (size_t i = 0; i < num_offsets(); ++i) {
+    auto key = get_key_view_at(offset_at(i));
+    if (i > 0 && key == get_key_view_at(offset_at(i - 1))) {
+      // 只记录每个 key 的第一个版本
+      continue;
+    }
+    auto &bucket = buckets[std::hash<std::string_view>{}(key) % num_buckets];
+    if (bucket == HASH_BUCKET_EMPTY) {
+      bucket = static_cast<uint16_t>(i);
+    } else if (bucket != HASH_BUCKET_COLLISION &&
+               get_key_view_at(offset_at(bucket)) != key) {
+      bucket = HASH_BUCKET_COLLISION;
+    }
+  }
+  return buckets;
+}
 
+Block::Layout Block::parse_layout(const uint8_t *encoded, size_t size,
+                                  bool with_hash) {
   // 1. 安全性检查
-  if (with_hash && encoded.size() <= sizeof(uint16_t) + sizeof(uint32_t)) {
+  if (with_hash && size <= sizeof(uint16_t) + sizeof(uint32_t)) {
     throw std::runtime_error("Encoded data too small");
   }
 
-  if (encoded.size() <= 16) {
+  if (size <= 16) {
     throw std::runtime_error("Encoded data too small");
   }
 
   // 2. 读取元素个数
   uint16_t num_elements;
-  size_t num_elements_pos = encoded.size() - sizeof(uint16_t);
+  size_t num_elements_pos = size - sizeof(uint16_t);
   if (with_hash) {
     num_elements_pos -= sizeof(uint32_t);
-    auto hash_pos = encoded.size() - sizeof(uint32_t);
+    auto hash_pos = size - sizeof(uint32_t);
     uint32_t hash_value;
-    memcpy(&hash_value, encoded.data() + hash_pos, sizeof(uint32_t));
+    memcpy(&hash_value, encoded + hash_pos, sizeof(uint32_t));
 
-    uint32_t compute_hash = std::hash<std::string_view>{}(
-        std::string_view(reinterpret_cast<const char *>(encoded.data()),
-                         encoded.size() - sizeof(uint32_t)));
+    uint32_t compute_hash = std::hash<std::string_view>{}(std::string_view(
+        reinterpret_cast<const char *>(encoded), size - sizeof(uint32_t)));
     if (hash_value != compute_hash) {
       throw std::runtime_error("Block hash verification failed");
     }
   }
-  memcpy(&num_elements, encoded.data() + num_elements_pos, sizeof(uint16_t));
+  memcpy(&num_elements, encoded + num_elements_pos, sizeof(uint16_t));
+
+  // 3. 读取哈希索引 (如果有)
+  Layout layout{};
+  size_t index_end = num_elements_pos;
+  if (num_elements & HASH_INDEX_FLAG) {
+    num_elements &= ~HASH_INDEX_FLAG;
+    uint16_t num_buckets;
+    if (index_end < sizeof(uint16_t)) {
+      throw std::runtime_error("Invalid encoded data size");
+    }
+    index_end -= sizeof(uint16_t);
+    memcpy(&num_buckets, encoded + index_end, sizeof(uint16_t));
+    if (num_buckets == 0 || index_end < num_buckets * sizeof(uint16_t)) {
+      throw std::runtime_error("Invalid encoded data size");
+    }
+    index_end -= num_buckets * sizeof(uint16_t);
+    layout.buckets_pos = index_end;
+    layout.num_buckets = num_buckets;
+  }
 
-  // 3. 验证数据大小
-  size_t required_size = sizeof(uint16_t) + num_elements * sizeof(uint16_t);
-  if (encoded.size() < required_size) {
+  // 4. 验证数据大小
+  size_t required_size = num_elements * sizeof(uint16_t);
+  if (index_end < required_size) {
     throw std::runtime_error("Invalid encoded data size");
   }
 
-  // 4. 计算各段位置
-  size_t offsets_section_start =
-      num_elements_pos - num_elements * sizeof(uint16_t);
+  // 5. 计算各段位置, 偏移数组紧跟在数据段之后
+  layout.data_size = index_end - num_elements * sizeof(uint16_t);
+  layout.num_offsets = num_elements;
+  return layout;
+}
+
+std::shared_ptr<Block> Block::decode(const std::vector<uint8_t> &encoded,
+                                     bool with_hash) {
+  // TODO Lab 3.1 解码字节数组形成类实例
+  // 使用 make_shared 创建对象
+  auto block = std::make_shared<Block>();
+  auto layout = parse_layout(encoded.data(), encoded.size(), with_hash);
+
+  // 读取哈希索引
+  if (layout.num_buckets > 0) {
+    block->hash_buckets.resize(layout.num_buckets);
+    memcpy(block->hash_buckets.data(), encoded.data() + layout.buckets_pos,
+           layout.num_buckets * sizeof(uint16_t));
+  }
+
+  // 读取偏移数组
+  block->offsets.resize(layout.num_offsets);
+  memcpy(block->offsets.data(), encoded.data() + layout.data_size,
+         layout.num_offsets * sizeof(uint16_t));
 
-  // 5. 读取偏移数组
-  block->offsets.resize(num_elements);
-  memcpy(block->offsets.data(), encoded.data() + offsets_section_start,
-         num_elements * sizeof(uint16_t));
+  // 复制数据段
+  block->data.assign(encoded.begin(), encoded.begin() + layout.data_size);
 
-  // 6. 复制数据段
-  block->data.reserve(offsets_section_start); // 优化内存分配
-  block->data.assign(encoded.begin(), encoded.begin() + offsets_section_start);
+  return block;
+}
 
+std::shared_ptr<Block>
+Block::decode_view(std::shared_ptr<const uint8_t> encoded, size_t size,
+                   bool with_hash) {
+  auto block = std::make_shared<Block>();
+  auto layout = parse_layout(encoded.get(), size, with_hash);
+
+  block->is_view_ = true;
+  block->view_data_ = encoded.get();
+  block->view_data_size_ = layout.data_size;
+  block->view_offsets_ = encoded.get() + layout.data_size;
+  block->view_num_offsets_ = layout.num_offsets;
+  if (layout.num_buckets > 0) {
+    block->view_buckets_ = encoded.get() + layout.buckets_pos;
+    block->view_num_buckets_ = layout.num_buckets;
+  }
+  block->pin_ = std::move(encoded);
   return block;
 }
 
 std::string Block::get_first_key() {
-  if (data.empty() || offsets.empty()) {
+  if (data_size() == 0 || num_offsets() == 0) {
     return "";
   }
 
   // 读取第一个key的长度（前2字节）
   uint16_t key_len;
-  memcpy(&key_len, data.data(), sizeof(uint16_t));
+  memcpy(&key_len, data_ptr(), sizeof(uint16_t));
 
   // 读取key
-  std::string key(reinterpret_cast<char *>(data.data() + sizeof(uint16_t)),
+  std::string key(reinterpret_cast<const char *>(data_ptr() + sizeof(uint16_t)),
                   key_len);
   return key;
 }
 
 size_t Block::get_offset_at(size_t idx) const {
-  if (idx >= offsets.size()) { // 原来是 >
+  if (idx >= num_offsets()) { // 原来是 >
     throw std::runtime_error("idx out of offsets range");
   }
-  return offsets[idx];
+  return offset_at(idx);
 }
 
 bool Block::add_entry(const std::string &key, const std::string &value,
@@ -122,6 +226,9 @@ bool Block::add_entry(const std::string &key, const std::string &value,
   // ? 返回值说明：
   // ? true: 成功添加
   // ? false: block已满, 拒绝此次添加
+  if (is_view_) {
+    throw std::runtime_error("Cannot add entry to a block view");
+  }
   if (!force_write &&
       (cur_size() + key.size() + value.size() + 3 * sizeof(uint16_t) +
            sizeof(uint64_t) >
@@ -165,9 +272,17 @@ bool Block::add_entry(const std::string &key, const std::string &value,
 std::string Block::get_key_at(size_t offset) const {
   // TODO Lab 3.1 从指定偏移量获取entry的key
   uint16_t key_len;
-  memcpy(&key_len, data.data() + offset, sizeof(uint16_t));
+  memcpy(&key_len, data_ptr() + offset, sizeof(uint16_t));
   return std::string(
-      reinterpret_cast<const char *>(data.data() + offset + sizeof(uint16_t)),
+      reinterpret_cast<const char *>(data_ptr() + offset + sizeof(uint16_t)),
+      key_len);
+}
+
+std::string_view Block::get_key_view_at(size_t offset) const {
+  uint16_t key_len;
+  memcpy(&key_len, data_ptr() + offset, sizeof(uint16_t));
+  return std::string_view(
+      reinterpret_cast<const char *>(data_ptr() + offset + sizeof(uint16_t)),
       key_len);
 }
 
@@ -176,41 +291,51 @@ std::string Block::get_value_at(size_t offset) const {
   // TODO Lab 3.1 从指定偏移量获取entry的value
   // 先获取key长度
   uint16_t key_len;
-  memcpy(&key_len, data.data() + offset, sizeof(uint16_t));
+  memcpy(&key_len, data_ptr() + offset, sizeof(uint16_t));
 
   // 计算value长度的位置
   size_t value_len_pos = offset + sizeof(uint16_t) + key_len;
   uint16_t value_len;
-  memcpy(&value_len, data.data() + value_len_pos, sizeof(uint16_t));
+  memcpy(&value_len, data_ptr() + value_len_pos, sizeof(uint16_t));
 
   // 返回value
   return std::string(reinterpret_cast<const char *>(
-                         data.data() + value_len_pos + sizeof(uint16_t)),
+                         data_ptr() + value_len_pos + sizeof(uint16_t)),
                      value_len);
 }
 
+std::string_view Block::get_value_view_at(size_t offset) const {
+  uint16_t key_len;
+  memcpy(&key_len, data_ptr() + offset, sizeof(uint16_t));
+  size_t value_len_pos = offset + sizeof(uint16_t) + key_len;
+  uint16_t value_len;
+  memcpy(&value_len, data_ptr() + value_len_pos, sizeof(uint16_t));
+  return std::string_view(reinterpret_cast<const char *>(
+                              data_ptr() + value_len_pos + sizeof(uint16_t)),
+                          value_len);
+}
+
 uint64_t Block::get_tranc_id_at(size_t offset) const {
   // TODO Lab 3.1 从指定偏移量获取entry的tranc_id
   // ? 你不需要理解tranc_id的具体含义, 直接返回即可
   uint16_t key_len;
-  memcpy(&key_len, data.data() + offset, sizeof(uint16_t));
+  memcpy(&key_len, data_ptr() + offset, sizeof(uint16_t));
 
   // 计算value长度的位置
   size_t value_len_pos = offset + sizeof(uint16_t) + key_len;
   uint16_t value_len;
-  memcpy(&value_len, data.data() + value_len_pos, sizeof(uint16_t));
+  memcpy(&value_len, data_ptr() + value_len_pos, sizeof(uint16_t));
 
   // 计算事务id的位置
   size_t tranc_id_pos = value_len_pos + sizeof(uint16_t) + value_len;
   uint64_t tranc_id;
-  memcpy(&tranc_id, data.data() + tranc_id_pos, sizeof(uint64_t));
+  memcpy(&tranc_id, data_ptr() + tranc_id_pos, sizeof(uint64_t));
   return tranc_id;
 }
 
 // 比较指定偏移量处的key与目标key
 int Block::compare_key_at(size_t offset, const std::string &target) const {
-  std::string key = get_key_at(offset);
-  return key.compare(target);
+  return get_key_view_at(offset).compare(target);
 }
 
 // 相同的key连续分布, 且相同的key的事务id从大到小排布
@@ -218,21 +343,21 @@ int Block::compare_key_at(size_t offset, const std::string &target) const {
 int Block::adjust_idx_by_tranc_id(size_t idx, uint64_t tranc_id) {
   // TODO Lab3.1 不需要在Lab3.1中实现, 只是进行标记,
   // ? 后续实现事务后需要更新这里的实现
-  if (idx >= offsets.size()) {
+  if (idx >= num_offsets()) {
     return -1; // 索引超出范围
   }
 
-  auto target_key = get_key_at(offsets[idx]);
+  auto target_key = get_key_view_at(offset_at(idx));
 
   if (tranc_id != 0) {
-    auto cur_tranc_id = get_tranc_id_at(offsets[idx]);
+    auto cur_tranc_id = get_tranc_id_at(offset_at(idx));
 
     if (cur_tranc_id <= tranc_id) {
       // 当前记录可见，向前查找更接近的目标
       size_t prev_idx = idx;
       while (prev_idx > 0 && is_same_key(prev_idx - 1, target_key)) {
         prev_idx--;
-        auto new_tranc_id = get_tranc_id_at(offsets[prev_idx]);
+        auto new_tranc_id = get_tranc_id_at(offset_at(prev_idx));
         if (new_tranc_id > tranc_id) {
           return prev_idx + 1; // 更新的记录不可见
         }
@@ -241,8 +366,8 @@ int Block::adjust_idx_by_tranc_id(size_t idx, uint64_t tranc_id) {
     } else {
       // 当前记录不可见，向后查找
       size_t next_idx = idx + 1;
-      while (next_idx < offsets.size() && is_same_key(next_idx, target_key)) {
-        auto new_tranc_id = get_tranc_id_at(offsets[next_idx]);
+      while (next_idx < num_offsets() && is_same_key(next_idx, target_key)) {
+        auto new_tranc_id = get_tranc_id_at(offset_at(next_idx));
         if (new_tranc_id <= tranc_id) {
           return next_idx; // 找到可见记录
         }
@@ -260,11 +385,11 @@ int Block::adjust_idx_by_tranc_id(size_t idx, uint64_t tranc_id) {
   }
 }
 
-bool Block::is_same_key(size_t idx, const std::string &target_key) const {
-  if (idx >= offsets.size()) {
+bool Block::is_same_key(size_t idx, std::string_view target_key) const {
+  if (idx >= num_offsets()) {
     return false; // 索引超出范围
   }
-  return get_key_at(offsets[idx]) == target_key;
+  return get_key_view_at(offset_at(idx)) == target_key;
 }
 
 // 使用二分查找获取value
@@ -276,28 +401,32 @@ std::optional<std::string> Block::get_value_binary(const std::string &key,
     return std::nullopt;
   }
 
-  return get_value_at(offsets[*idx]);
+  return get_value_at(offset_at(*idx));
 }
 
 std::optional<size_t> Block::get_idx_binary(const std::string &key,
-                                            uint64_t tranc_id) {
+                                            uint64_t tranc_id,
+                                            bool *key_exists) {
   // TODO Lab 3.1 使用二分查找获取key对应的索引
-  if (offsets.empty()) {
+  if (num_offsets() == 0) {
     return std::nullopt;
   }
   // 二分查找
   int left = 0;
-  int right = offsets.size() - 1;
+  int right = num_offsets() - 1;
 
   while (left <= right) {
     int mid = left + (right - left) / 2;
-    size_t mid_offset = offsets[mid];
+    size_t mid_offset = offset_at(mid);
 
     int cmp = compare_key_at(mid_offset, key);
 
     if (cmp == 0) {
       // 找到key，返回对应的value
       // 还需要判断事务id可见性
+      if (key_exists != nullptr) {
+        *key_exists = true;
+      }
       auto new_mid = adjust_idx_by_tranc_id(mid, tranc_id);
       if (new_mid == -1) {
         return std::nullopt;
@@ -315,6 +444,66 @@ std::optional<size_t> Block::get_idx_binary(const std::string &key,
   return std::nullopt;
 }
 
+size_t Block::lower_bound(std::string_view key) const {
+  size_t left = 0;
+  size_t right = num_offsets();
+  while (left < right) {
+    size_t mid = left + (right - left) / 2;
+    if (get_key_view_at(offset_at(mid)) < key) {
+      left = mid + 1;
+    } else {
+      right = mid;
+    }
+  }
+  return left;
+}
+
+std::optional<size_t> Block::get_idx_hash(const std::string &key,
+                                          uint64_t tranc_id, bool &fallback,
+                                          bool *key_exists) {
+  fallback = false;
+  auto bucket =
+      bucket_at(std::hash<std::string_view>{}(key) % num_buckets());
+  if (bucket == HASH_BUCKET_EMPTY) {
+    // 所有 key 都建立了索引, 空桶说明 key 不存在
+    return std::nullopt;
+  }
+  if (bucket == HASH_BUCKET_COLLISION) {
+    fallback = true;
+    return std::nullopt;
+  }
+  if (bucket >= num_offsets() || get_key_view_at(offset_at(bucket)) != key) {
+    // 该桶只对应一个 key, 不相等说明 key 不存在
+    return std::nullopt;
+  }
+  if (key_exists != nullptr) {
+    *key_exists = true;
+  }
+
+  auto idx = adjust_idx_by_tranc_id(bucket, tranc_id);
+  if (idx == -1) {
+    return std::nullopt;
+  }
+  return idx;
+}
+
+std::optional<size_t> Block::get_idx(const std::string &key,
+                                     uint64_t tranc_id, bool *key_exists) {
+  if (key_exists != nullptr) {
+    *key_exists = false;
+  }
+  if (num_buckets() > 0) {
+    bool fallback = false;
+    auto idx = get_idx_hash(key, tranc_id, fallback, key_exists);
+    if (!fallback) {
+      return idx;
+    }
+  }
+  return get_idx_binary(key, tranc_id, key_exists);
+}
+
+bool Block::has_hash_index() const { return num_buckets() > 0; }
+
 std::optional<
     std::pair<std::shared_ptr<BlockIterator>, std::shared_ptr<BlockIterator>>>
 Block::iters_preffix(uint64_t tranc_id, const std::string &preffix) {
@@ -351,16 +540,16 @@ std::optional<
 Block::get_monotony_predicate_iters(
     uint64_t tranc_id, std::function<int(const std::string &)> predicate) {
   // TODO: Lab 3.3 使用二分查找获取满足谓词的区间迭代器
-  if (offsets.empty()) {
+  if (num_offsets() == 0) {
     return std::nullopt;
   }
-  int64_t l = 0, r = static_cast<int64_t>(offsets.size()) - 1;
+  int64_t l = 0, r = static_cast<int64_t>(num_offsets()) - 1;
   int64_t first = -1;
 
   // 寻找第一个匹配项（左边界）
   while (l <= r) {
     int64_t m = l + (r - l) / 2;
-    int cmp = predicate(get_key_at(offsets[m]));
+    int cmp = predicate(get_key_at(offset_at(m)));
     if (cmp == 0) {
       first = m;
       r = m - 1;
@@ -376,10 +565,10 @@ Block::get_monotony_predicate_iters(
   // 寻找最后一个匹配项（右边界的前一个）
   int64_t last = first;
   l = first;
-  r = static_cast<int64_t>(offsets.size()) - 1;
+  r = static_cast<int64_t>(num_offsets()) - 1;
   while (l <= r) {
     int64_t m = l + (r - l) / 2;
-    int cmp = predicate(get_key_at(offsets[m]));
+    int cmp = predicate(get_key_at(offset_at(m)));
     if (cmp == 0) {
       last = m;
       l = m + 1;
@@ -418,13 +607,13 @@ Block::Entry Block::get_entry_at(size_t offset) const {
   return entry;
 }
 
-size_t Block::size() const { return offsets.size(); }
+size_t Block::size() const { return num_offsets(); }
 
 size_t Block::cur_size() const {
-  return data.size() + offsets.size() * sizeof(uint16_t) + sizeof(uint16_t);
+  return data_size() + num_offsets() * sizeof(uint16_t) + sizeof(uint16_t);
 }
 
-bool Block::is_empty() const { return offsets.empty(); }
+bool Block::is_empty() const { return num_offsets() == 0; }
 
 BlockIterator Block::begin(uint64_t tranc_id) {
   // TODO Lab 3.2 获取begin迭代器
@@ -433,6 +622,6 @@ BlockIterator Block::begin(uint64_t tranc_id) {
 
 BlockIterator Block::end() {
   // TODO Lab 3.2 获取end迭代器
-  return BlockIterator(shared_from_this(), offsets.size(), 0);
+  return BlockIterator(shared_from_this(), num_offsets(), 0);
 }
 } // namespace tiny_lsm
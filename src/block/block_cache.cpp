@@ -1,5 +1,6 @@
 #include "../../include/block/block_cache.h"
 #include "../../include/block/block.h"
+#include <algorithm>
 #include <chrono>
 #include <list>
 #include <memory>
@@ -36,25 +37,75 @@ void BlockCache::put(int sst_id, int block_id, std::shared_ptr<Block> block) {
     it->second->cache_block = block;
     update_access_count(it->second);
   } else {
-    if (cache_map_.size() >= capacity_) {
-      // 优先淘汰 less_k 中最久未访问的（LRU）
-      if (!cache_list_less_k.empty()) {
-        cache_map_.erase(std::make_pair(cache_list_less_k.back().sst_id,
-                                        cache_list_less_k.back().block_id));
-        cache_list_less_k.pop_back();
-      }
-      // 若 less_k 为空，淘汰 greater_k 尾部（最久未访问的高频项）
-      else {
-        cache_map_.erase(std::make_pair(cache_list_greater_k.back().sst_id,
-                                        cache_list_greater_k.back().block_id));
-        cache_list_greater_k.pop_back();
-      }
-    }
+    evict_for(CachePriority::LOW);
     cache_list_less_k.push_front({sst_id, block_id, block, 1});
     cache_map_[key] = cache_list_less_k.begin();
   }
 }
 
+std::shared_ptr<CacheEntry> BlockCache::get_meta(int sst_id, int meta_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++total_requests_;
+  auto it = cache_map_.find(std::make_pair(sst_id, meta_key(meta_id)));
+  if (it == cache_map_.end()) {
+    return nullptr;
+  }
+  ++hit_requests_;
+  cache_list_high_pri.splice(cache_list_high_pri.begin(), cache_list_high_pri,
+                             it->second);
+  return it->second->cache_entry;
+}
+
+void BlockCache::put_meta(int sst_id, int meta_id,
+                          std::shared_ptr<CacheEntry> entry) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto key = std::make_pair(sst_id, meta_key(meta_id));
+  auto it = cache_map_.find(key);
+  if (it != cache_map_.end()) {
+    it->second->cache_entry = entry;
+    cache_list_high_pri.splice(cache_list_high_pri.begin(),
+                               cache_list_high_pri, it->second);
+    return;
+  }
+  evict_for(CachePriority::HIGH);
+  cache_list_high_pri.push_front(
+      {sst_id, key.second, nullptr, 1, entry, CachePriority::HIGH});
+  cache_map_[key] = cache_list_high_pri.begin();
+}
+
+void BlockCache::evict_for(CachePriority priority) {
+  if (cache_map_.size() < capacity_) {
+    return;
+  }
+  // 高优先级池已满时, 新的高优先级项只能替换高优先级项
+  size_t high_pri_capacity =
+      std::max<size_t>(1, static_cast<size_t>(capacity_ * HIGH_PRI_POOL_RATIO));
+  if (priority == CachePriority::HIGH &&
+      cache_list_high_pri.size() >= high_pri_capacity) {
+    evict_tail(cache_list_high_pri);
+    return;
+  }
+
+  // 优先淘汰 less_k 中最久未访问的（LRU）
+  if (!cache_list_less_k.empty()) {
+    evict_tail(cache_list_less_k);
+  }
+  // 若 less_k 为空，淘汰 greater_k 尾部（最久未访问的高频项）
+  else if (!cache_list_greater_k.empty()) {
+    evict_tail(cache_list_greater_k);
+  } else {
+    evict_tail(cache_list_high_pri);
+  }
+}
+
+void BlockCache::evict_tail(std::list<CacheItem> &list) {
+  if (list.empty()) {
+    return;
+  }
+  cache_map_.erase(std::make_pair(list.back().sst_id, list.back().block_id));
+  list.pop_back();
+}
+
 double BlockCache::hit_rate() const {
   std::lock_guard<std::mutex> lock(mutex_);
   return total_requests_ == 0
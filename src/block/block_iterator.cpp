@@ -17,15 +17,18 @@ BlockIterator::BlockIterator(std::shared_ptr<Block> b, size_t index,
 }
 
 BlockIterator::BlockIterator(std::shared_ptr<Block> b, const std::string &key,
-                             uint64_t tranc_id)
+                             uint64_t tranc_id, bool *key_exists)
     : block(b), tranc_id_(tranc_id), cached_value(std::nullopt) {
   // TODO: Lab3.2 创建迭代器时直接移动到指定的key位置
   // ? 你需要借助之前实现的 Block 类的成员函数
   if (block) {
-    auto idx_opt = block->get_idx_binary(key, tranc_id);
+    auto idx_opt = block->get_idx(key, tranc_id, key_exists);
     current_index = idx_opt ? *idx_opt : block->size();
   } else {
     current_index = 0;
+    if (key_exists != nullptr) {
+      *key_exists = false;
+    }
   }
 }
 
@@ -77,6 +80,27 @@ bool BlockIterator::is_end() const {
   return current_index >= block->size();
 }
 
+std::string_view BlockIterator::key() const {
+  if (is_end()) {
+    return {};
+  }
+  return block->get_key_view_at(block->get_offset_at(current_index));
+}
+
+std::string_view BlockIterator::value() const {
+  if (is_end()) {
+    return {};
+  }
+  return block->get_value_view_at(block->get_offset_at(current_index));
+}
+
+uint64_t BlockIterator::current_tranc_id() const {
+  if (is_end()) {
+    return 0;
+  }
+  return block->get_tranc_id_at(block->get_offset_at(current_index));
+}
+
 void BlockIterator::update_current() const {
   // TODO: Lab3.2 更新当前指针
   if (is_end()) {
@@ -98,9 +122,9 @@ void BlockIterator::skip_by_tranc_id() {
   if (!block)
     return;
 
-  auto get_key_at_index = [&](size_t idx) -> std::string {
+  auto get_key_at_index = [&](size_t idx) -> std::string_view {
     size_t off = block->get_offset_at(idx);
-    return block->get_key_at(off);
+    return block->get_key_view_at(off);
   };
   auto get_tid_at_index = [&](size_t idx) -> uint64_t {
     size_t off = block->get_offset_at(idx);
@@ -111,8 +135,8 @@ void BlockIterator::skip_by_tranc_id() {
     if (tranc_id_ == 0) {
       // 未开启事务：对相邻相同 key 去重，只保留每组第一个（最大 tranc_id）
       if (current_index > 0) {
-        std::string prev_key = get_key_at_index(current_index - 1);
-        std::string cur_key = get_key_at_index(current_index);
+        auto prev_key = get_key_at_index(current_index - 1);
+        auto cur_key = get_key_at_index(current_index);
         if (cur_key == prev_key) {
           // 跳过这一组剩余的重复 key
           while (current_index < block->size() &&
@@ -128,8 +152,8 @@ void BlockIterator::skip_by_tranc_id() {
       // 视图的版本；若整组不可见，跳过整组 若当前落在组内（与前一个 key
       // 相同），先跳到下一组起点
       if (current_index > 0) {
-        std::string prev_key = get_key_at_index(current_index - 1);
-        std::string cur_key = get_key_at_index(current_index);
+        auto prev_key = get_key_at_index(current_index - 1);
+        auto cur_key = get_key_at_index(current_index);
         if (cur_key == prev_key) {
           while (current_index < block->size() &&
                  get_key_at_index(current_index) == prev_key) {
@@ -140,7 +164,7 @@ void BlockIterator::skip_by_tranc_id() {
       }
 
       // 现在在某组的起点，扫描该组找第一个可见版本
-      std::string group_key = get_key_at_index(current_index);
+      auto group_key = get_key_at_index(current_index);
       size_t idx = current_index;
       bool found = false;
       while (idx < block->size() && get_key_at_index(idx) == group_key) {
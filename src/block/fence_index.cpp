@@ -0,0 +1,89 @@
+#include "../../include/block/fence_index.h"
+#include <algorithm>
+
+namespace tiny_lsm {
+
+FenceIndex::FenceIndex(const std::vector<BlockMeta> &meta_entries) {
+  if (meta_entries.empty()) {
+    return;
+  }
+  // 只有 block 间严格有序时栅栏才有意义, 否则保持为空由调用方回退到线性查找
+  for (size_t i = 0; i < meta_entries.size(); ++i) {
+    if (meta_entries[i].first_key > meta_entries[i].last_key) {
+      return;
+    }
+    if (i > 0 && meta_entries[i - 1].last_key >= meta_entries[i].first_key) {
+      return;
+    }
+  }
+
+  std::vector<std::string> fences;
+  fences.reserve(meta_entries.size());
+  size_t total_len = 0;
+  for (size_t i = 0; i < meta_entries.size(); ++i) {
+    if (i == 0) {
+      fences.push_back(meta_entries[i].first_key);
+    } else {
+      fences.push_back(shortest_separator(meta_entries[i - 1].last_key,
+                                          meta_entries[i].first_key));
+    }
+    total_len += fences.back().size();
+  }
+
+  keys_.reserve(total_len);
+  offsets_.reserve(fences.size() + 1);
+  for (const auto &fence : fences) {
+    offsets_.push_back(static_cast<uint32_t>(keys_.size()));
+    keys_.append(fence);
+  }
+  offsets_.push_back(static_cast<uint32_t>(keys_.size()));
+}
+
+std::string FenceIndex::shortest_separator(std::string_view prev,
+                                           std::string_view next) {
+  // 取 next 与 prev 的公共前缀再多一个字符, 该前缀一定大于 prev 且不大于 next
+  size_t common = 0;
+  size_t limit = std::min(prev.size(), next.size());
+  while (common < limit && prev[common] == next[common]) {
+    common++;
+  }
+  if (common >= next.size()) {
+    // next 是 prev 的前缀 (不应出现), 只能使用完整的 next
+    return std::string(next);
+  }
+  return std::string(next.substr(0, common + 1));
+}
+
+std::string_view FenceIndex::fence_at(size_t idx) const {
+  return std::string_view(keys_).substr(offsets_[idx],
+                                        offsets_[idx + 1] - offsets_[idx]);
+}
+
+size_t FenceIndex::find(std::string_view key) const {
+  size_t n = size();
+  if (n == 0 || key < fence_at(0)) {
+    return static_cast<size_t>(-1);
+  }
+
+  // 找到第一个 fence > key 的位置, 其前一个即为目标 block
+  size_t left = 1;
+  size_t right = n;
+  while (left < right) {
+    size_t mid = left + (right - left) / 2;
+    if (fence_at(mid) <= key) {
+      left = mid + 1;
+    } else {
+      right = mid;
+    }
+  }
+  return left - 1;
+}
+
+size_t FenceIndex::size() const {
+  return offsets_.empty() ? 0 : offsets_.size() - 1;
+}
+
+size_t FenceIndex::memory_usage() const {
+  return keys_.capacity() + offsets_.capacity() * sizeof(uint32_t);
+}
+} // namespace tiny_lsm
@@ -12,10 +12,25 @@ void TomlConfig::setDefaultValues() {
   lsm_per_mem_size_limit_ = 4194304;  // Default: 4 * 1024 * 1024
   lsm_block_size_ = 32768;            // Default: 32 * 1024
   lsm_sst_level_ratio_ = 4;           // Default: 4
+  lsm_block_hash_index_ = true;       // Default: true
+  lsm_sst_index_partition_blocks_ = 0; // Default: 0 (不分区)
+  lsm_sst_mmap_read_ = true;           // Default: true
+  lsm_sst_read_queue_depth_ = 8;       // Default: 8
+  lsm_sst_readahead_max_blocks_ = 16;  // Default: 16
+  lsm_compaction_readahead_blocks_ = 64; // Default: 64
+  lsm_wal_group_commit_max_size_ = 32;   // Default: 32
+  lsm_wal_group_commit_max_wait_us_ = 0; // Default: 0 (不等待)
+  lsm_wal_segment_size_ = 1048576;       // Default: 1MB
+  lsm_wal_recovery_threads_ = 4;         // Default: 4
+  lsm_max_immutable_memtables_ = 4;      // Default: 4
+  lsm_high_priority_threads_ = 1;        // Default: 1
+  lsm_low_priority_threads_ = 2;         // Default: 2
+  lsm_max_subcompactions_ = 4;           // Default: 4
 
   // --- LSM Cache ---
   lsm_block_cache_capacity_ = 1024; // Default: 1024
   lsm_block_cache_k_ = 8;           // Default: 8
+  lsm_row_cache_capacity_ = 8388608; // Default: 8 * 1024 * 1024
 
   // --- Redis Headers/Separators ---
   redis_expire_header_ = "REDIS_EXPIRE_";
@@ -30,6 +45,8 @@ void TomlConfig::setDefaultValues() {
   // --- Bloom Filter ---
   bloom_filter_expected_size_ = 65536;
   bloom_filter_expected_error_rate_ = 0.1;
+  bloom_filter_prefix_stride_ = 4;   // Default: 4 (0 表示不构建前缀过滤器)
+  bloom_filter_prefix_max_len_ = 32; // Default: 32
 }
 
 // Constructor implementation
@@ -69,6 +86,31 @@ bool TomlConfig::loadFromFile(const std::string &filePath) {
         core_config.at("LSM_PER_MEM_SIZE_LIMIT").as_integer();
     lsm_block_size_ = core_config.at("LSM_BLOCK_SIZE").as_integer();
     lsm_sst_level_ratio_ = core_config.at("LSM_SST_LEVEL_RATIO").as_integer();
+    lsm_block_hash_index_ = core_config.at("LSM_BLOCK_HASH_INDEX").as_boolean();
+    lsm_sst_index_partition_blocks_ =
+        core_config.at("LSM_SST_INDEX_PARTITION_BLOCKS").as_integer();
+    lsm_sst_mmap_read_ = core_config.at("LSM_SST_MMAP_READ").as_boolean();
+    lsm_sst_read_queue_depth_ =
+        core_config.at("LSM_SST_READ_QUEUE_DEPTH").as_integer();
+    lsm_sst_readahead_max_blocks_ =
+        core_config.at("LSM_SST_READAHEAD_MAX_BLOCKS").as_integer();
+    lsm_compaction_readahead_blocks_ =
+        core_config.at("LSM_COMPACTION_READAHEAD_BLOCKS").as_integer();
+    lsm_wal_group_commit_max_size_ =
+        core_config.at("LSM_WAL_GROUP_COMMIT_MAX_SIZE").as_integer();
+    lsm_wal_group_commit_max_wait_us_ =
+        core_config.at("LSM_WAL_GROUP_COMMIT_MAX_WAIT_US").as_integer();
+    lsm_wal_segment_size_ = core_config.at("LSM_WAL_SEGMENT_SIZE").as_integer();
+    lsm_wal_recovery_threads_ =
+        core_config.at("LSM_WAL_RECOVERY_THREADS").as_integer();
+    lsm_max_immutable_memtables_ =
+        core_config.at("LSM_MAX_IMMUTABLE_MEMTABLES").as_integer();
+    lsm_high_priority_threads_ =
+        core_config.at("LSM_HIGH_PRIORITY_THREADS").as_integer();
+    lsm_low_priority_threads_ =
+        core_config.at("LSM_LOW_PRIORITY_THREADS").as_integer();
+    lsm_max_subcompactions_ =
+        core_config.at("LSM_MAX_SUBCOMPACTIONS").as_integer();
 
     // --- Load LSM Cache ---
     auto cache_config = config["lsm"]["cache"];
@@ -76,6 +118,8 @@ bool TomlConfig::loadFromFile(const std::string &filePath) {
     lsm_block_cache_capacity_ =
         cache_config.at("LSM_BLOCK_CACHE_CAPACITY").as_integer();
     lsm_block_cache_k_ = cache_config.at("LSM_BLOCK_CACHE_K").as_integer();
+    lsm_row_cache_capacity_ =
+        cache_config.at("LSM_ROW_CACHE_CAPACITY").as_integer();
 
     // --- Load Redis Headers/Separators ---
     auto redis_config = config["redis"];
@@ -108,6 +152,12 @@ bool TomlConfig::loadFromFile(const std::string &filePath) {
     bloom_filter_expected_error_rate_ =
         bloom_config.at("BLOOM_FILTER_EXPECTED_ERROR_RATE").as_floating();
 
+    bloom_filter_prefix_stride_ =
+        bloom_config.at("BLOOM_FILTER_PREFIX_STRIDE").as_integer();
+
+    bloom_filter_prefix_max_len_ =
+        bloom_config.at("BLOOM_FILTER_PREFIX_MAX_LEN").as_integer();
+
     spdlog::info("Configuration loaded successfully from {}", filePath);
     return true;
 
@@ -131,11 +181,50 @@ long long TomlConfig::getLsmPerMemSizeLimit() const {
 }
 int TomlConfig::getLsmBlockSize() const { return lsm_block_size_; }
 int TomlConfig::getLsmSstLevelRatio() const { return lsm_sst_level_ratio_; }
+bool TomlConfig::getLsmBlockHashIndex() const { return lsm_block_hash_index_; }
+int TomlConfig::getLsmSstIndexPartitionBlocks() const {
+  return lsm_sst_index_partition_blocks_;
+}
+bool TomlConfig::getLsmSstMmapRead() const { return lsm_sst_mmap_read_; }
+int TomlConfig::getLsmSstReadQueueDepth() const {
+  return lsm_sst_read_queue_depth_;
+}
+int TomlConfig::getLsmSstReadaheadMaxBlocks() const {
+  return lsm_sst_readahead_max_blocks_;
+}
+int TomlConfig::getLsmCompactionReadaheadBlocks() const {
+  return lsm_compaction_readahead_blocks_;
+}
+int TomlConfig::getLsmWalGroupCommitMaxSize() const {
+  return lsm_wal_group_commit_max_size_;
+}
+int TomlConfig::getLsmWalGroupCommitMaxWaitUs() const {
+  return lsm_wal_group_commit_max_wait_us_;
+}
+int TomlConfig::getLsmWalSegmentSize() const { return lsm_wal_segment_size_; }
+int TomlConfig::getLsmWalRecoveryThreads() const {
+  return lsm_wal_recovery_threads_;
+}
+int TomlConfig::getLsmMaxImmutableMemtables() const {
+  return lsm_max_immutable_memtables_;
+}
+int TomlConfig::getLsmHighPriorityThreads() const {
+  return lsm_high_priority_threads_;
+}
+int TomlConfig::getLsmLowPriorityThreads() const {
+  return lsm_low_priority_threads_;
+}
+int TomlConfig::getLsmMaxSubcompactions() const {
+  return lsm_max_subcompactions_;
+}
 
 int TomlConfig::getLsmBlockCacheCapacity() const {
   return lsm_block_cache_capacity_;
 }
 int TomlConfig::getLsmBlockCacheK() const { return lsm_block_cache_k_; }
+long long TomlConfig::getLsmRowCacheCapacity() const {
+  return lsm_row_cache_capacity_;
+}
 
 const std::string &TomlConfig::getRedisExpireHeader() const {
   return redis_expire_header_;
@@ -166,6 +255,12 @@ int TomlConfig::getBloomFilterExpectedSize() const {
 double TomlConfig::getBloomFilterExpectedErrorRate() const {
   return bloom_filter_expected_error_rate_;
 }
+int TomlConfig::getBloomFilterPrefixStride() const {
+  return bloom_filter_prefix_stride_;
+}
+int TomlConfig::getBloomFilterPrefixMaxLen() const {
+  return bloom_filter_prefix_max_len_;
+}
 
 const TomlConfig &TomlConfig::getInstance(const std::string &config_path) {
   // 静态实例确保只创建一次
@@ -204,11 +299,36 @@ bool TomlConfig::saveToFile(const std::string &filePath) {
     config["lsm"]["core"]["LSM_PER_MEM_SIZE_LIMIT"] = lsm_per_mem_size_limit_;
     config["lsm"]["core"]["LSM_BLOCK_SIZE"] = lsm_block_size_;
     config["lsm"]["core"]["LSM_SST_LEVEL_RATIO"] = lsm_sst_level_ratio_;
+    config["lsm"]["core"]["LSM_BLOCK_HASH_INDEX"] = lsm_block_hash_index_;
+    config["lsm"]["core"]["LSM_SST_INDEX_PARTITION_BLOCKS"] =
+        lsm_sst_index_partition_blocks_;
+    config["lsm"]["core"]["LSM_SST_MMAP_READ"] = lsm_sst_mmap_read_;
+    config["lsm"]["core"]["LSM_SST_READ_QUEUE_DEPTH"] =
+        lsm_sst_read_queue_depth_;
+    config["lsm"]["core"]["LSM_SST_READAHEAD_MAX_BLOCKS"] =
+        lsm_sst_readahead_max_blocks_;
+    config["lsm"]["core"]["LSM_COMPACTION_READAHEAD_BLOCKS"] =
+        lsm_compaction_readahead_blocks_;
+    config["lsm"]["core"]["LSM_WAL_GROUP_COMMIT_MAX_SIZE"] =
+        lsm_wal_group_commit_max_size_;
+    config["lsm"]["core"]["LSM_WAL_GROUP_COMMIT_MAX_WAIT_US"] =
+        lsm_wal_group_commit_max_wait_us_;
+    config["lsm"]["core"]["LSM_WAL_SEGMENT_SIZE"] = lsm_wal_segment_size_;
+    config["lsm"]["core"]["LSM_WAL_RECOVERY_THREADS"] =
+        lsm_wal_recovery_threads_;
+    config["lsm"]["core"]["LSM_MAX_IMMUTABLE_MEMTABLES"] =
+        lsm_max_immutable_memtables_;
+    config["lsm"]["core"]["LSM_HIGH_PRIORITY_THREADS"] =
+        lsm_high_priority_threads_;
+    config["lsm"]["core"]["LSM_LOW_PRIORITY_THREADS"] =
+        lsm_low_priority_threads_;
+    config["lsm"]["core"]["LSM_MAX_SUBCOMPACTIONS"] = lsm_max_subcompactions_;
 
     // --- LSM Cache ---
     config["lsm"]["cache"]["LSM_BLOCK_CACHE_CAPACITY"] =
         lsm_block_cache_capacity_;
     config["lsm"]["cache"]["LSM_BLOCK_CACHE_K"] = lsm_block_cache_k_;
+    config["lsm"]["cache"]["LSM_ROW_CACHE_CAPACITY"] = lsm_row_cache_capacity_;
 
     // --- Redis Headers/Separators ---
     config["redis"]["REDIS_EXPIRE_HEADER"] = redis_expire_header_;
@@ -227,6 +347,10 @@ bool TomlConfig::saveToFile(const std::string &filePath) {
         bloom_filter_expected_size_;
     config["bloom_filter"]["BLOOM_FILTER_EXPECTED_ERROR_RATE"] =
         bloom_filter_expected_error_rate_;
+    config["bloom_filter"]["BLOOM_FILTER_PREFIX_STRIDE"] =
+        bloom_filter_prefix_stride_;
+    config["bloom_filter"]["BLOOM_FILTER_PREFIX_MAX_LEN"] =
+        bloom_filter_prefix_max_len_;
 
     // 写入到文件
     std::ofstream outFile(filePath);
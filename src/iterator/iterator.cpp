@@ -57,6 +57,20 @@ HeapIterator::value_type HeapIterator::operator*() const {
   return cached_value_.value();
 }
 
+std::string_view HeapIterator::key() const {
+  if (!current_item_.has_value()) {
+    return {};
+  }
+  return current_item_->key_;
+}
+
+std::string_view HeapIterator::value() const {
+  if (!current_item_.has_value()) {
+    return {};
+  }
+  return current_item_->value_;
+}
+
 BaseIterator &HeapIterator::operator++() {
   skip_by_tranc_id();
   return *this;
@@ -120,10 +134,9 @@ bool HeapIterator::advance_to_next() {
 
     SearchItem top = items.top();
     items.pop();
-    std::string current_key = top.key_;
     group.emplace_back(std::move(top));
 
-    while (!items.empty() && items.top().key_ == current_key) {
+    while (!items.empty() && items.top().key_ == group.front().key_) {
       group.emplace_back(items.top());
       items.pop();
     }
@@ -133,7 +146,7 @@ bool HeapIterator::advance_to_next() {
       continue;
     }
 
-    current_item_.emplace(selected.value());
+    current_item_.emplace(std::move(selected.value()));
     return true;
   }
   return false;
@@ -0,0 +1,168 @@
+#include "../../include/iterator/merge_iterator.h"
+#include <utility>
+
+namespace tiny_lsm {
+
+// *************************** MergeIterator ***************************
+MergeIterator::MergeIterator(
+    std::vector<std::shared_ptr<BaseIterator>> children, uint64_t max_tranc_id,
+    bool filter_empty)
+    : children_(std::move(children)), max_tranc_id_(max_tranc_id),
+      filter_empty_(filter_empty) {
+  if (children_.empty()) {
+    return;
+  }
+  // 叶子节点 i 位于 k + i, 内部节点 n 的子节点为 2n 和 2n + 1
+  tree_.assign(children_.size(), 0);
+  tree_[0] = build(1);
+  seek_valid();
+}
+
+bool MergeIterator::less(size_t a, size_t b) const {
+  bool valid_a = children_[a]->is_valid();
+  bool valid_b = children_[b]->is_valid();
+  if (!valid_a || !valid_b) {
+    return valid_a;
+  }
+  int cmp = children_[a]->key().compare(children_[b]->key());
+  if (cmp != 0) {
+    return cmp < 0;
+  }
+  // key 相同时, 事务id 更大的版本更新
+  uint64_t tranc_a = children_[a]->get_tranc_id();
+  uint64_t tranc_b = children_[b]->get_tranc_id();
+  if (tranc_a != tranc_b) {
+    return tranc_a > tranc_b;
+  }
+  // 事务id 也相同时, 下标小的数据源更新
+  return a < b;
+}
+
+size_t MergeIterator::build(size_t node) {
+  size_t k = children_.size();
+  if (node >= k) {
+    return node - k;
+  }
+  size_t left = build(2 * node);
+  size_t right = build(2 * node + 1);
+  if (less(left, right)) {
+    tree_[node] = right;
+    return left;
+  }
+  tree_[node] = left;
+  return right;
+}
+
+void MergeIterator::replay(size_t idx) {
+  size_t winner = idx;
+  for (size_t node = (children_.size() + idx) / 2; node > 0; node /= 2) {
+    if (less(tree_[node], winner)) {
+      std::swap(tree_[node], winner);
+    }
+  }
+  tree_[0] = winner;
+}
+
+void MergeIterator::skip_key(std::string_view key) {
+  while (is_valid() && children_[tree_[0]]->key() == key) {
+    size_t idx = tree_[0];
+    ++(*children_[idx]);
+    replay(idx);
+  }
+}
+
+void MergeIterator::seek_valid() {
+  cached_value_.reset();
+  while (is_valid()) {
+    size_t idx = tree_[0];
+    auto &child = children_[idx];
+    if (max_tranc_id_ != 0 && child->get_tranc_id() > max_tranc_id_) {
+      // 只跳过不可见的版本, 同一 key 的旧版本可能可见
+      ++(*child);
+      replay(idx);
+      continue;
+    }
+    if (filter_empty_ && child->value().empty()) {
+      // 可见的删除标记意味着整个 key 被移除
+      skip_buf_.assign(child->key());
+      skip_key(skip_buf_);
+      continue;
+    }
+    break;
+  }
+}
+
+BaseIterator &MergeIterator::operator++() {
+  if (!is_valid()) {
+    return *this;
+  }
+  skip_buf_.assign(key());
+  skip_key(skip_buf_);
+  seek_valid();
+  return *this;
+}
+
+bool MergeIterator::operator==(const BaseIterator &other) const {
+  if (other.get_type() != IteratorType::MergeIterator) {
+    return false;
+  }
+  auto &other2 = dynamic_cast<const MergeIterator &>(other);
+  if (is_end() || other2.is_end()) {
+    return is_end() && other2.is_end();
+  }
+  return children_ == other2.children_ && tree_[0] == other2.tree_[0] &&
+         key() == other2.key();
+}
+
+bool MergeIterator::operator!=(const BaseIterator &other) const {
+  return !(*this == other);
+}
+
+MergeIterator::value_type MergeIterator::operator*() const {
+  if (!is_valid()) {
+    return value_type{};
+  }
+  return value_type{std::string(key()), std::string(value())};
+}
+
+MergeIterator::pointer MergeIterator::operator->() const {
+  if (!is_valid()) {
+    return nullptr;
+  }
+  if (!cached_value_.has_value()) {
+    cached_value_.emplace(key(), value());
+  }
+  return &cached_value_.value();
+}
+
+std::string_view MergeIterator::key() const {
+  if (!is_valid()) {
+    return {};
+  }
+  return children_[tree_[0]]->key();
+}
+
+std::string_view MergeIterator::value() const {
+  if (!is_valid()) {
+    return {};
+  }
+  return children_[tree_[0]]->value();
+}
+
+IteratorType MergeIterator::get_type() const {
+  return IteratorType::MergeIterator;
+}
+
+uint64_t MergeIterator::get_tranc_id() const {
+  if (!is_valid()) {
+    return 0;
+  }
+  return children_[tree_[0]]->get_tranc_id();
+}
+
+bool MergeIterator::is_end() const { return !is_valid(); }
+
+bool MergeIterator::is_valid() const {
+  return !tree_.empty() && children_[tree_[0]]->is_valid();
+}
+} // namespace tiny_lsm
@@ -1,6 +1,7 @@
 #include "../../include/lsm/engine.h"
 #include "../../include/config/config.h"
 #include "../../include/consts.h"
+#include "../../include/iterator/merge_iterator.h"
 #include "../../include/logger/logger.h"
 #include "../../include/lsm/level_iterator.h"
 #include "../../include/sst/concact_iterator.h"
@@ -11,8 +12,10 @@
 #include <cstddef>
 #include <cstdint>
 #include <deque>
+#include <exception>
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <optional>
@@ -32,6 +35,12 @@ LSMEngine::LSMEngine(std::string path) : data_dir(path) {
   block_cache = std::make_shared<BlockCache>(
       TomlConfig::getInstance().getLsmBlockCacheCapacity(),
       TomlConfig::getInstance().getLsmBlockCacheK());
+  // 初始化行缓存, memtable 写入时负责使其失效
+  if (TomlConfig::getInstance().getLsmRowCacheCapacity() > 0) {
+    row_cache = std::make_shared<RowCache>(
+        TomlConfig::getInstance().getLsmRowCacheCapacity());
+    memtable.set_row_cache(row_cache);
+  }
 
   // 创建数据目录
   if (!std::filesystem::exists(path)) {
@@ -80,9 +89,13 @@ LSMEngine::LSMEngine(std::string path) : data_dir(path) {
       std::unique_lock<std::shared_mutex> lock(ssts_mtx); // 写锁
 
       next_sst_id = std::max(sst_id, next_sst_id); // 记录目前最大的 sst_id
-      cur_max_level = std::max(level, cur_max_level); // 记录目前最大的 level
+      // 记录目前最大的 level
+      cur_max_level = std::max(level, cur_max_level.load());
       std::string sst_path = get_sst_path(sst_id, level);
-      auto sst = SST::open(sst_id, FileObj::open(sst_path, false), block_cache);
+      auto sst_file = TomlConfig::getInstance().getLsmSstMmapRead()
+                          ? FileObj::open_mmap(sst_path)
+                          : FileObj::open(sst_path, false);
+      auto sst = SST::open(sst_id, std::move(sst_file), block_cache);
       spdlog::info("LSMEngine--"
                    "Loaded SST: {} successfully!",
                    sst_path);
@@ -112,20 +125,124 @@ LSMEngine::LSMEngine(std::string path) : data_dir(path) {
     next_sst_id++; // 现有的最大 sst_id 自增后才是下一个分配的 sst_id
 
     for (auto &[level, sst_id_list] : level_sst_ids) {
-      std::sort(sst_id_list.begin(), sst_id_list.end());
       if (level == 0) {
-        // 其他 level 的 sst 都是没有重叠的, 且 id 小的表示 key
-        // 排序在前面的部分, 不需要 reverse
-        std::reverse(sst_id_list.begin(), sst_id_list.end());
+        // l0 按 id 从新到旧排列
+        std::sort(sst_id_list.begin(), sst_id_list.end(),
+                  std::greater<size_t>());
+      } else {
+        // 其他 level 的 sst 都是没有重叠的, 按 key 排序.
+        // 并行的 subcompaction 分配的 id 与 key 的顺序无关
+        std::sort(sst_id_list.begin(), sst_id_list.end(),
+                  [this](size_t lhs, size_t rhs) {
+                    return ssts[lhs]->get_first_key() <
+                           ssts[rhs]->get_first_key();
+                  });
       }
     }
   }
+
+  {
+    std::unique_lock<std::shared_mutex> lock(ssts_mtx);
+    install_version_();
+  }
+  auto &config = TomlConfig::getInstance();
+  scheduler_ = std::make_shared<JobScheduler>(
+      static_cast<size_t>(std::max(1, config.getLsmHighPriorityThreads())),
+      static_cast<size_t>(std::max(1, config.getLsmLowPriorityThreads())));
+  // 上次运行留下的 l0 可能已经达到上限
+  schedule_compaction_();
+}
+
+LSMEngine::~LSMEngine() {
+  {
+    // 先将冻结表全部刷盘, 关闭调度器时排队的刷盘任务会被丢弃.
+    // 刷盘持续失败时放弃, 剩余冻结表的数据仍在 WAL 中
+    // (WAL 只清理已经刷盘的事务), 下次启动时重放
+    std::unique_lock<std::mutex> lock(flush_mtx_);
+    schedule_flush_locked_();
+    stall_cv_.wait(lock, [this]() { return !flush_scheduled_; });
+    stop_flush_ = true;
+  }
+  stall_cv_.notify_all();
+  auto unflushed = memtable.get_frozen_count();
+  if (unflushed > 0) {
+    spdlog::warn("LSMEngine--~LSMEngine(): {} frozen memtables are not "
+                 "flushed before shutdown",
+                 unflushed);
+  }
+  // 丢弃排队的任务并等待正在执行的任务结束, 之后不会再有任务访问引擎
+  auto dropped = scheduler_->shutdown();
+  if (dropped > 0) {
+    spdlog::info("LSMEngine--~LSMEngine(): dropped {} queued background jobs",
+                 dropped);
+  }
+  {
+    // 停止时仍在等待的请求无法完成
+    std::lock_guard<std::mutex> lock(flush_mtx_);
+    for (auto &request : flush_requests_) {
+      request.promise.set_exception(std::make_exception_ptr(
+          std::runtime_error("LSMEngine--flush cancelled by shutdown")));
+    }
+    flush_requests_.clear();
+  }
+  // 被取消的删除任务在这里完成, 否则旧的 sst 会在下次启动时被重新加载
+  delete_obsolete_ssts_();
+}
+
+std::shared_ptr<JobScheduler> LSMEngine::get_scheduler() const {
+  return scheduler_;
+}
+
+void LSMEngine::wait_for_background_jobs() { scheduler_->wait_for_idle(); }
+
+std::shared_ptr<const Version> LSMEngine::get_version() const {
+  return version_.load(std::memory_order_acquire);
+}
+
+void LSMEngine::install_version_() {
+  auto version = std::make_shared<Version>();
+  version->levels.resize(1);
+  for (auto &[level, sst_ids] : level_sst_ids) {
+    if (version->levels.size() <= level) {
+      version->levels.resize(level + 1);
+    }
+    auto &l_ssts = version->levels[level];
+    l_ssts.reserve(sst_ids.size());
+    for (auto sst_id : sst_ids) {
+      l_ssts.push_back(ssts[sst_id]);
+    }
+  }
+  version_.store(std::move(version), std::memory_order_release);
 }
-LSMEngine::~LSMEngine() = default;
 
 std::optional<std::pair<std::string, uint64_t>>
 LSMEngine::get(const std::string &key, uint64_t tranc_id) {
   // TODO: Lab 4.2 查询
+  std::optional<std::pair<std::string, uint64_t>> res;
+  if (row_cache == nullptr) {
+    res = get_(key, tranc_id);
+  } else if (row_cache->lookup(key, tranc_id, res)) {
+    spdlog::trace("LSMEngine--get({},{}): returning from row cache", key,
+                  tranc_id);
+  } else {
+    // 行缓存只缓存最新版本, 最新版本对快照不可见时再按快照查询
+    auto generation = row_cache->generation(key);
+    res = get_(key, 0);
+    row_cache->insert(key, res, generation);
+    if (tranc_id != 0 && res.has_value() && res->second > tranc_id) {
+      res = get_(key, tranc_id);
+    }
+  }
+
+  if (res.has_value() && res->first.empty()) {
+    // 空值表示被删除了
+    return std::nullopt;
+  }
+  return res;
+}
+
+std::optional<std::pair<std::string, uint64_t>>
+LSMEngine::get_(const std::string &key, uint64_t tranc_id) {
   // 1. 先查找 memtable
   auto mem_res = memtable.get(key, tranc_id);
   if (mem_res.is_valid()) {
@@ -143,88 +260,61 @@ LSMEngine::get(const std::string &key, uint64_t tranc_id) {
                     "get({},{}): key is deleted, returning "
                     "from memtable",
                     key, tranc_id);
-      return std::nullopt;
-    }
-  }
-
-  // 2. l0 sst中查询
-  std::shared_lock<std::shared_mutex> rlock(ssts_mtx); // 读锁
-
-  for (auto &sst_id : level_sst_ids[0]) {
-    //  中的 sst_id 是按从大到小的顺序排列,
-    // sst_id 越大, 表示是越晚刷入的, 优先查询
-    auto &sst = ssts[sst_id];
-    auto sst_iterator = sst->get(key, tranc_id);
-    if (sst_iterator != sst->end()) {
-      if ((sst_iterator)->second.size() > 0) {
-        // 值存在且不为空（没有被删除）
-        spdlog::trace("LSMEngine--"
-                      "get({},{}): value = {}, tranc_id = {} "
-                      "returning from l0 sst{}",
-                      key, tranc_id, sst_iterator->second,
-                      sst_iterator.get_tranc_id(), sst_id);
-        return std::pair<std::string, uint64_t>{sst_iterator->second,
-                                                sst_iterator.get_tranc_id()};
-      } else {
-        // 空值表示被删除了
-        spdlog::trace("LSMEngine--"
-                      "get({},{}): key is deleted or do not "
-                      "exist , returning "
-                      "from l0 sst{}",
-                      key, tranc_id, sst_id);
-        return std::nullopt;
-      }
+      return std::pair<std::string, uint64_t>{"", mem_res.get_tranc_id()};
     }
   }
 
-  // 3. 其他level的sst中查询
-  for (size_t level = 1; level <= cur_max_level; level++) {
-    std::deque<size_t> l_sst_ids = level_sst_ids[level];
-    // 二分查询
-    size_t left = 0;
-    size_t right = l_sst_ids.size();
-    while (left < right) {
-      size_t mid = left + (right - left) / 2;
-      auto &sst = ssts[l_sst_ids[mid]];
-      if (sst->get_first_key() <= key && key <= sst->get_last_key()) {
-        // 如果sst_id在中, 则在sst中查询
-        auto sst_iterator = sst->get(key, tranc_id);
-        if (sst_iterator.is_valid()) {
-          if ((sst_iterator)->second.size() > 0) {
-            // 值存在且不为空（没有被删除）
-            spdlog::trace("LSMEngine--"
-                          "get({},{}): value = {}, tranc_id = {} "
-                          "returning from l{} sst{}",
-                          key, tranc_id, sst_iterator->second,
-                          sst_iterator.get_tranc_id(), level, l_sst_ids[mid]);
-
-            return std::pair<std::string, uint64_t>{
-                sst_iterator->second, sst_iterator.get_tranc_id()};
-          } else {
-            // 空值表示被删除了
-            spdlog::trace("LSMEngine--"
-                          "get({},{}): key is deleted or do not exist "
-                          "returning from l{} sst{}",
-                          key, tranc_id, level, l_sst_ids[mid]);
-
-            return std::nullopt;
-          }
-        } else {
-          break;
-        }
-      } else if (sst->get_last_key() < key) {
-        left = mid + 1;
-      } else {
-        right = mid;
-      }
-    }
+  // 2. 在当前 sst 布局快照中查询, 不需要持有 ssts_mtx
+  auto res = version_get_(*get_version(), key, tranc_id);
+  if (!res.has_value()) {
+    spdlog::trace("LSMEngine--"
+                  "get({},{}): key is not exist, returning "
+                  "after checking all ssts",
+                  key, tranc_id);
   }
+  return res;
+}
 
-  spdlog::trace("LSMEngine--"
-                "get({},{}): key is not exist, returning "
-                "after checking all ssts",
-                key, tranc_id);
+std::optional<std::pair<std::string, uint64_t>>
+LSMEngine::version_get_(const Version &version, const std::string &key,
+                        uint64_t tranc_id) {
+  // 1. l0 sst中查询, 越晚刷入的 sst 越靠前, 优先查询
+  for (auto &sst : version.levels[0]) {
+    auto sst_iterator = sst_point_get_(sst, key, tranc_id, 0);
+    if (sst_iterator.is_valid()) {
+      // 删除标记以空 value 返回
+      spdlog::trace("LSMEngine--"
+                    "get({},{}): value = {}, tranc_id = {} "
+                    "returning from l0 sst{}",
+                    key, tranc_id, sst_iterator->second,
+                    sst_iterator.get_tranc_id(), sst->get_sst_id());
+      return std::pair<std::string, uint64_t>{sst_iterator->second,
+                                              sst_iterator.get_tranc_id()};
+    }
+  }
 
+  // 2. 其他level的sst中查询, 每层二分找到唯一可能包含 key 的 sst
+  for (size_t level = 1; level < version.levels.size(); level++) {
+    auto &l_ssts = version.levels[level];
+    auto it = std::partition_point(
+        l_ssts.begin(), l_ssts.end(),
+        [&](const std::shared_ptr<SST> &sst) {
+          return sst->get_last_key() < key;
+        });
+    if (it == l_ssts.end() || (*it)->get_first_key() > key) {
+      continue;
+    }
+    auto sst_iterator = sst_point_get_(*it, key, tranc_id, level);
+    if (sst_iterator.is_valid()) {
+      spdlog::trace("LSMEngine--"
+                    "get({},{}): value = {}, tranc_id = {} "
+                    "returning from l{} sst{}",
+                    key, tranc_id, sst_iterator->second,
+                    sst_iterator.get_tranc_id(), level, (*it)->get_sst_id());
+      return std::pair<std::string, uint64_t>{sst_iterator->second,
+                                              sst_iterator.get_tranc_id()};
+    }
+  }
   return std::nullopt;
 }
 
@@ -232,6 +322,50 @@ std::vector<
     std::pair<std::string, std::optional<std::pair<std::string, uint64_t>>>>
 LSMEngine::get_batch(const std::vector<std::string> &keys, uint64_t tranc_id) {
   // TODO: Lab 4.2 批量查询
+  if (row_cache == nullptr) {
+    return get_batch_(keys, tranc_id);
+  }
+
+  // 1. 先查行缓存, 未命中的 key 再批量查询最新版本
+  std::vector<
+      std::pair<std::string, std::optional<std::pair<std::string, uint64_t>>>>
+      results;
+  results.reserve(keys.size());
+  std::vector<std::string> miss_keys;
+  std::vector<size_t> miss_idxs;
+  std::vector<uint64_t> generations;
+  for (size_t idx = 0; idx < keys.size(); idx++) {
+    std::optional<std::pair<std::string, uint64_t>> value;
+    if (!row_cache->lookup(keys[idx], tranc_id, value)) {
+      miss_keys.push_back(keys[idx]);
+      miss_idxs.push_back(idx);
+      generations.push_back(row_cache->generation(keys[idx]));
+    }
+    results.emplace_back(keys[idx], std::move(value));
+  }
+
+  if (miss_keys.empty()) {
+    return results;
+  }
+
+  // 2. 回填行缓存, 最新版本对快照不可见的 key 再按快照单独查询
+  auto miss_results = get_batch_(miss_keys, 0);
+  for (size_t i = 0; i < miss_results.size(); i++) {
+    auto &[key, value] = miss_results[i];
+    row_cache->insert(key, value, generations[i]);
+    if (tranc_id != 0 && value.has_value() && value->second > tranc_id) {
+      value = get_(key, tranc_id);
+    }
+    results[miss_idxs[i]].second = std::move(value);
+  }
+
+  return results;
+}
+
+std::vector<
+    std::pair<std::string, std::optional<std::pair<std::string, uint64_t>>>>
+LSMEngine::get_batch_(const std::vector<std::string> &keys,
+                      uint64_t tranc_id) {
   auto results = memtable.get_batch(keys, tranc_id);
 
   // 2. 如果所有键都在memtable 中找到，直接返回
@@ -248,226 +382,309 @@ LSMEngine::get_batch(const std::vector<std::string> &keys, uint64_t tranc_id) {
     return results; // 不需要查sst
   }
 
-  // 2. 从 L0 层 SST 文件中批量查找未命中的键
-  std::shared_lock<std::shared_mutex> rlock(ssts_mtx); // 加读锁
-  for (auto &[key, value] : results) {
-    for (auto &sst_id : level_sst_ids[0]) {
-      auto &sst = ssts[sst_id];
-      auto sst_iterator = sst->get(key, tranc_id);
-      if (sst_iterator != sst->end()) {
-        if (sst_iterator->second.size() > 0) {
-          // 值存在且不为空
-          value =
-              std::make_pair(sst_iterator->second, sst_iterator.get_tranc_id());
-        } else {
-          // 空值表示被删除
-          value = std::nullopt;
-        }
-        break; // 停止继续查找
-      }
+  // 3. 未命中的 key 按 key 排序, 之后逐层用同一个有序游标查找
+  std::vector<size_t> order;
+  for (size_t idx = 0; idx < results.size(); idx++) {
+    if (!results[idx].second.has_value()) {
+      order.push_back(idx);
     }
   }
+  std::sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+    return results[lhs].first < results[rhs].first;
+  });
+  // 去掉已经找到的 key, 保持剩余 key 的顺序
+  auto remove_found = [&]() {
+    order.erase(std::remove_if(order.begin(), order.end(),
+                               [&](size_t idx) {
+                                 return results[idx].second.has_value();
+                               }),
+                order.end());
+  };
+
+  // 持有 sst 布局快照, 不需要持有 ssts_mtx
+  auto version = get_version();
+
+  // 4. 从 L0 层 SST 文件中批量查找, 较新的 SST 在前
+  // 删除标记同样保留, 避免继续在更深的层中查到旧版本
+  for (auto &sst : version->levels[0]) {
+    if (order.empty()) {
+      return results;
+    }
+    sst_get_batch_(sst, results, order, 0, order.size(), tranc_id, 0);
+    remove_found();
+  }
 
-  // 3. 从其他层级 SST 文件中批量查找未命中的键
-  for (size_t level = 1; level <= cur_max_level; level++) {
-    std::deque<size_t> l_sst_ids = level_sst_ids[level];
-
-    for (auto &[key, value] : results) {
-      if (value.has_value()) // 已找到，跳过
-      {
-        continue;
+  // 5. 从其他层级 SST 文件中批量查找
+  // 每层的 SST 有序且不重叠, 有序的 key 落在同一 SST 中的是连续的一段
+  for (size_t level = 1; level < version->levels.size() && !order.empty();
+       level++) {
+    const auto &l_ssts = version->levels[level];
+    auto sst_it = l_ssts.begin();
+    size_t pos = 0;
+    while (pos < order.size()) {
+      // 跳过 last_key 小于当前 key 的 SST
+      const auto &key = results[order[pos]].first;
+      sst_it = std::partition_point(
+          sst_it, l_ssts.end(), [&](const std::shared_ptr<SST> &sst) {
+            return sst->get_last_key() < key;
+          });
+      if (sst_it == l_ssts.end()) {
+        break;
       }
-
-      // 二分查找确定键可能所在的 SST 文件
-      size_t left = 0;
-      size_t right = l_sst_ids.size();
-      while (left < right) {
-        size_t mid = left + (right - left) / 2;
-        auto &sst = ssts[l_sst_ids[mid]];
-
-        if (sst->get_first_key() <= key && key <= sst->get_last_key()) {
-          // 如果键在当前 SST 文件范围内，则在 SST 中查找
-          auto sst_iterator = sst->get(key, tranc_id);
-          if (sst_iterator.is_valid()) {
-            if (sst_iterator->second.size() > 0) {
-              // 值存在且不为空
-              value = std::make_pair(sst_iterator->second,
-                                     sst_iterator.get_tranc_id());
-            } else {
-              // 空值表示被删除
-              value = std::nullopt;
-            }
-          }
-          break; // 停止继续查找
-        } else if (sst->get_last_key() < key) {
-          left = mid + 1;
-        } else {
-          right = mid;
-        }
+      auto &sst = *sst_it;
+      size_t end = pos;
+      while (end < order.size() &&
+             results[order[end]].first <= sst->get_last_key()) {
+        end++;
       }
+      // 小于 first_key 的 key 落在两个 SST 之间的空隙中, 本层不存在
+      size_t begin = pos;
+      while (begin < end && results[order[begin]].first < sst->get_first_key()) {
+        begin++;
+      }
+      if (begin < end) {
+        sst_get_batch_(sst, results, order, begin, end, tranc_id, level);
+      }
+      pos = end;
     }
+    remove_found();
   }
 
   return results;
 }
 
-std::optional<std::pair<std::string, uint64_t>>
-LSMEngine::sst_get_(const std::string &key, uint64_t tranc_id) {
-  // TODO: Lab 4.2 sst 内部查询
-  // 1. l0 sst中查询
-  for (auto &sst_id : level_sst_ids[0]) {
-    //  中的 sst_id 是按从大到小的顺序排列,
-    // sst_id 越大, 表示是越晚刷入的, 优先查询
-    auto sst = ssts[sst_id];
-    auto sst_iterator = sst->get(key, tranc_id);
-    if (sst_iterator != sst->end()) {
-      if ((sst_iterator)->second.size() > 0) {
-        // 值存在且不为空（没有被删除）
-        // L0 SST 查询命中
-        spdlog::trace("LSMEngine--"
-                      "sst_get({}{}): found in l0 sst{}",
-                      key, tranc_id, sst_id);
-
-        return std::pair<std::string, uint64_t>{sst_iterator->second,
-                                                sst_iterator.get_tranc_id()};
-      } else {
-        // 空值表示被删除了
-        return std::nullopt;
-      }
+void LSMEngine::sst_get_batch_(
+    const std::shared_ptr<SST> &sst,
+    std::vector<
+        std::pair<std::string, std::optional<std::pair<std::string, uint64_t>>>>
+        &results,
+    const std::vector<size_t> &order, size_t begin, size_t end,
+    uint64_t tranc_id, size_t level) {
+  auto &counter = bloom_counters_[std::min(level, BLOOM_STATS_MAX_LEVEL - 1)];
+
+  // 1. 检查 key 范围和布隆过滤器, 只保留可能存在的 key
+  std::vector<std::string> probe_keys;
+  std::vector<size_t> probe_idxs;
+  for (size_t i = begin; i < end; i++) {
+    const auto &key = results[order[i]].first;
+    if (key < sst->get_first_key() || key > sst->get_last_key()) {
+      continue;
     }
+    if (!sst->may_contain(key)) {
+      counter.useful.fetch_add(1, std::memory_order_relaxed);
+      continue;
+    }
+    probe_keys.push_back(key);
+    probe_idxs.push_back(order[i]);
+  }
+  if (probe_keys.empty()) {
+    return;
   }
 
-  // 2. 其他level的sst中查询
-  for (size_t level = 1; level <= cur_max_level; level++) {
-    std::deque<size_t> l_sst_ids = level_sst_ids[level];
-    // 二分查询
-    size_t left = 0;
-    size_t right = l_sst_ids.size();
-    while (left < right) {
-      size_t mid = left + (right - left) / 2;
-      auto sst = ssts[l_sst_ids[mid]];
-      if (sst->get_first_key() <= key && key <= sst->get_last_key()) {
-        // 如果sst_id在中, 则在sst中查询
-        auto sst_iterator = sst->get(key, tranc_id);
-        if (sst_iterator.is_valid()) {
-          if ((sst_iterator)->second.size() > 0) {
-            // 值存在且不为空（没有被删除）
-            // 其他 Level SST 查询命中
-            spdlog::trace("LSMEngine--"
-                          "sst_get({}{}): found in l{} sst{}",
-                          key, tranc_id, level, sst_iterator.get_tranc_id());
-
-            return std::pair<std::string, uint64_t>{
-                sst_iterator->second, sst_iterator.get_tranc_id()};
-          } else {
-            // 空值表示被删除了
-            return std::nullopt;
-          }
-        } else {
-          break;
-        }
-      } else if (sst->get_last_key() < key) {
-        left = mid + 1;
+  // 2. 按 block 分组读取, 每个 block 只读取一次.
+  // 未命中的 key 存在不可见的版本时不计为误判
+  std::vector<bool> key_exists;
+  auto values = sst->get_batch(probe_keys, tranc_id, &key_exists);
+  uint64_t invisible = 0;
+  uint64_t false_positive = 0;
+  for (size_t i = 0; i < values.size(); i++) {
+    if (!values[i].has_value()) {
+      if (key_exists[i]) {
+        invisible++;
       } else {
-        right = mid;
+        false_positive++;
       }
+      continue;
     }
+    results[probe_idxs[i]].second = std::move(values[i]);
   }
+  counter.invisible.fetch_add(invisible, std::memory_order_relaxed);
+  counter.false_positive.fetch_add(false_positive, std::memory_order_relaxed);
+}
 
-  spdlog::trace("LSMEngine--"
-                "sst_get({}{}): key is not exist, returning "
-                "after checking all ssts",
-                key, tranc_id);
+std::optional<std::pair<std::string, uint64_t>>
+LSMEngine::sst_get_(const std::string &key, uint64_t tranc_id) {
+  // TODO: Lab 4.2 sst 内部查询
+  auto res = version_get_(*get_version(), key, tranc_id);
+  if (res.has_value() && res->first.empty()) {
+    // 空值表示被删除了
+    return std::nullopt;
+  }
+  return res;
+}
 
-  return std::nullopt;
+SstIterator LSMEngine::sst_point_get_(const std::shared_ptr<SST> &sst,
+                                      const std::string &key,
+                                      uint64_t tranc_id, size_t level) {
+  if (key < sst->get_first_key() || key > sst->get_last_key()) {
+    return sst->end();
+  }
+
+  auto &counter = bloom_counters_[std::min(level, BLOOM_STATS_MAX_LEVEL - 1)];
+  if (!sst->may_contain(key)) {
+    // 布隆过滤器判定不存在, 省去了 block 的读取
+    counter.useful.fetch_add(1, std::memory_order_relaxed);
+    return sst->end();
+  }
+
+  // 已经检查过布隆过滤器, 直接读取 block
+  bool key_exists = false;
+  auto sst_iterator = sst->find(key, tranc_id, &key_exists);
+  if (!sst_iterator.is_valid()) {
+    // 指定事务时未找到的 key 可能只是版本不可见, 不计为误判
+    if (key_exists) {
+      counter.invisible.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      counter.false_positive.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  return sst_iterator;
 }
 
-uint64_t LSMEngine::put(const std::string &key, const std::string &value,
-                        uint64_t tranc_id) {
+std::vector<BloomFilterStats> LSMEngine::get_bloom_filter_stats() const {
+  size_t levels = std::min(cur_max_level.load(std::memory_order_relaxed) + 1,
+                           BLOOM_STATS_MAX_LEVEL);
+  std::vector<BloomFilterStats> stats(levels);
+  for (size_t level = 0; level < levels; level++) {
+    stats[level].useful =
+        bloom_counters_[level].useful.load(std::memory_order_relaxed);
+    stats[level].false_positive =
+        bloom_counters_[level].false_positive.load(std::memory_order_relaxed);
+    stats[level].invisible =
+        bloom_counters_[level].invisible.load(std::memory_order_relaxed);
+  }
+  return stats;
+}
+
+void LSMEngine::put(const std::string &key, const std::string &value,
+                    uint64_t tranc_id) {
   // TODO: Lab 4.1 插入
-  // ? 由于 put 操作可能触发 flush
-  // ? 如果触发了 flush 则返回新刷盘的 sst 的 id
-  // ? 在没有实现  flush 的情况下，你返回 0即可
+  wait_for_flush_room_();
   memtable.put(key, value, tranc_id);
   spdlog::trace("LSMEngine--"
                 "put({}, {}, {})"
                 "inserted into memtable",
                 key, value, tranc_id);
-
-  // 如果 memtable 太大，需要刷新到磁盘
-  if (memtable.get_total_size() >=
-      TomlConfig::getInstance().getLsmTolMemSizeLimit()) {
-    return flush();
-  }
-  return 0;
+  schedule_flush_();
 }
 
-uint64_t LSMEngine::put_batch(
+void LSMEngine::put_batch(
     const std::vector<std::pair<std::string, std::string>> &kvs,
     uint64_t tranc_id) {
   // TODO: Lab 4.1 批量插入
-  // ? 由于 put 操作可能触发 flush
-  // ? 如果触发了 flush 则返回新刷盘的 sst 的 id
-  // ? 在没有实现  flush 的情况下，你返回 0即可
+  wait_for_flush_room_();
   memtable.put_batch(kvs, tranc_id);
 
   spdlog::trace("LSMEngine--"
                 "put_batch with {} keys inserted into memtable",
                 kvs.size());
-
-  // 如果 memtable 太大，需要刷新到磁盘
-  if (memtable.get_total_size() >=
-      TomlConfig::getInstance().getLsmTolMemSizeLimit()) {
-    return flush();
-  }
-  return 0;
+  schedule_flush_();
 }
-uint64_t LSMEngine::remove(const std::string &key, uint64_t tranc_id) {
+
+void LSMEngine::remove(const std::string &key, uint64_t tranc_id) {
   // TODO: Lab 4.1 删除
   // ? 在 LSM 中，删除实际上是插入一个空值
-  // ? 由于 put 操作可能触发 flush
-  // ? 如果触发了 flush 则返回新刷盘的 sst 的 id
-  // ? 在没有实现  flush 的情况下，你返回 0即可
+  wait_for_flush_room_();
   memtable.remove(key, tranc_id);
 
   spdlog::trace("LSMEngine--"
                 "remove({}, {}) marked as "
                 "deleted in memtable",
                 key, tranc_id);
-
-  // 如果 memtable 太大，需要刷新到磁盘
-  if (memtable.get_total_size() >=
-      TomlConfig::getInstance().getLsmTolMemSizeLimit()) {
-    return flush();
-  }
-  return 0;
+  schedule_flush_();
 }
 
-uint64_t LSMEngine::remove_batch(const std::vector<std::string> &keys,
-                                 uint64_t tranc_id) {
+void LSMEngine::remove_batch(const std::vector<std::string> &keys,
+                             uint64_t tranc_id) {
   // TODO: Lab 4.1 批量删除
   // ? 在 LSM 中，删除实际上是插入一个空值
-  // ? 由于 put 操作可能触发 flush
-  // ? 如果触发了 flush 则返回新刷盘的 sst 的 id
-  // ? 在没有实现  flush 的情况下，你返回 0即可
+  wait_for_flush_room_();
   memtable.remove_batch(keys, tranc_id);
 
   spdlog::trace("LSMEngine--"
                 "remove_batch with {} keys tagged into memtable",
                 keys.size());
+  schedule_flush_();
+}
+
+bool LSMEngine::write_stalled() {
+  auto frozen_count = memtable.get_frozen_count();
+  if (frozen_count == 0) {
+    return false;
+  }
+  return frozen_count >= static_cast<size_t>(
+                             TomlConfig::getInstance()
+                                 .getLsmMaxImmutableMemtables()) ||
+         memtable.get_total_size() >=
+             static_cast<size_t>(
+                 TomlConfig::getInstance().getLsmTolMemSizeLimit());
+}
+
+void LSMEngine::wait_for_flush_room_() {
+  if (!write_stalled()) {
+    return;
+  }
+  spdlog::debug("LSMEngine--Write stalled, waiting for background flush");
+  std::unique_lock<std::mutex> lock(flush_mtx_);
+  schedule_flush_locked_();
+  // 刷盘放弃重试后不会再腾出空间, 不能一直等待
+  auto gave_up = [this]() {
+    return !flush_scheduled_ && flush_failures_ > MAX_FLUSH_RETRIES;
+  };
+  stall_cv_.wait(lock, [&]() {
+    return stop_flush_ || gave_up() || !write_stalled();
+  });
+  if (!stop_flush_ && gave_up() && write_stalled()) {
+    throw std::runtime_error(
+        "LSMEngine--write stalled: background flush keeps failing");
+  }
+}
 
-  // 如果 memtable 太大，需要刷新到磁盘
-  if (memtable.get_total_size() >=
-      TomlConfig::getInstance().getLsmTolMemSizeLimit()) {
-    return flush();
+void LSMEngine::schedule_flush_() {
+  if (memtable.get_frozen_count() == 0) {
+    return;
   }
-  return 0;
+  std::lock_guard<std::mutex> lock(flush_mtx_);
+  schedule_flush_locked_();
+}
+
+void LSMEngine::schedule_flush_locked_() {
+  if (stop_flush_ || flush_scheduled_ || memtable.get_frozen_count() == 0) {
+    return;
+  }
+  flush_scheduled_ =
+      scheduler_->schedule(JobPriority::HIGH, [this]() { flush_job_(); });
+}
+
+void LSMEngine::set_flush_listener(std::function<void(uint64_t)> listener) {
+  std::lock_guard<std::mutex> lock(flush_mtx_);
+  flush_listener_ = std::move(listener);
 }
 
 void LSMEngine::clear() {
+  // 等待正在进行的 compaction 和刷盘, 它们在持有 ssts_mtx 之前完成了归并
+  std::lock_guard<std::mutex> compaction_lock(compaction_mtx_);
+  std::lock_guard<std::mutex> flush_lock(flush_oldest_mtx_);
+  std::unique_lock<std::shared_mutex> lock(ssts_mtx); // 写锁
   memtable.clear();
   level_sst_ids.clear();
   ssts.clear();
+  install_version_();
+  {
+    // 目录中的文件会全部删除
+    std::lock_guard<std::mutex> obsolete_lock(obsolete_mtx_);
+    obsolete_ssts_.clear();
+  }
+  {
+    // 被清除的冻结表视为已经刷盘, 等待它们的请求直接完成
+    std::lock_guard<std::mutex> flush_lock(flush_mtx_);
+    flushed_total_ = std::max(flushed_total_, memtable.get_frozen_total());
+    complete_flush_requests_();
+  }
+  stall_cv_.notify_all();
+  if (row_cache != nullptr) {
+    row_cache->clear();
+  }
   // 清空当前文件夹的所有内容
   try {
     for (const auto &entry : std::filesystem::directory_iterator(data_dir)) {
@@ -486,37 +703,174 @@ void LSMEngine::clear() {
   }
 }
 
-uint64_t LSMEngine::flush() {
-  // TODO: Lab 4.1 刷盘形成sst文件
-  if (memtable.get_total_size() == 0) {
-    return 0;
+std::shared_future<uint64_t> LSMEngine::flush() {
+  // 冻结活跃表, 之后由后台线程按从旧到新的顺序刷盘
+  memtable.frozen_cur_table();
+
+  std::lock_guard<std::mutex> lock(flush_mtx_);
+  FlushRequest request{memtable.get_frozen_total(), std::promise<uint64_t>()};
+  auto future = request.promise.get_future().share();
+  flush_requests_.push_back(std::move(request));
+  complete_flush_requests_();
+  schedule_flush_locked_();
+  return future;
+}
+
+void LSMEngine::complete_flush_requests_() {
+  bool completed = false;
+  for (auto it = flush_requests_.begin(); it != flush_requests_.end();) {
+    if (it->target <= flushed_total_) {
+      it->promise.set_value(max_flushed_tranc_id_);
+      it = flush_requests_.erase(it);
+      completed = true;
+    } else {
+      ++it;
+    }
+  }
+  if (completed) {
+    stall_cv_.notify_all();
   }
+}
 
-  std::unique_lock<std::shared_mutex> lock(ssts_mtx); // 写锁
+void LSMEngine::flush_job_() {
+  std::optional<uint64_t> flushed_tranc_id;
+  uint64_t removed = 0;
+  std::exception_ptr error;
+  try {
+    flushed_tranc_id = flush_oldest_();
+    // 冻结表按从旧到新的顺序移除, 累计冻结的数量减去仍然存在的数量
+    // 即为已经移除的数量. 先读取累计数量, 并发的冻结只会使结果偏小
+    auto frozen_total = memtable.get_frozen_total();
+    removed = frozen_total - memtable.get_frozen_count();
+  } catch (const std::exception &e) {
+    spdlog::error("LSMEngine--flush_job_(): flush failed: {}", e.what());
+    error = std::current_exception();
+  }
+
+  std::unique_lock<std::mutex> lock(flush_mtx_);
+  if (error) {
+    for (auto &request : flush_requests_) {
+      request.promise.set_exception(error);
+    }
+    flush_requests_.clear();
+    // 冻结表仍然保留, 延迟一段时间后重试. 等待期间不占用高优先级线程,
+    // flush_scheduled_ 保持为 true, 其他写入不会提前提交刷盘任务
+    flush_failures_++;
+    flush_scheduled_ =
+        !stop_flush_ && flush_failures_ <= MAX_FLUSH_RETRIES &&
+        scheduler_->schedule_after(JobPriority::HIGH, std::chrono::seconds(1),
+                                   [this]() { flush_job_(); });
+    if (!flush_scheduled_ && !stop_flush_) {
+      // 不再占用调度器, wait_for_idle 可以返回, 等待空间的写入者会收到错误
+      spdlog::error("LSMEngine--flush_job_(): giving up after {} consecutive "
+                    "failures, {} frozen memtables remain",
+                    flush_failures_, memtable.get_frozen_count());
+    }
+    stall_cv_.notify_all();
+    return;
+  }
+  flush_failures_ = 0;
+  if (flushed_tranc_id.has_value()) {
+    max_flushed_tranc_id_ =
+        std::max(max_flushed_tranc_id_, flushed_tranc_id.value());
+    stall_cv_.notify_all();
+    // 先通知 listener 再完成请求, 等待者返回时事务状态已经更新
+    if (flush_listener_) {
+      auto listener = flush_listener_;
+      auto max_flushed_tranc_id = max_flushed_tranc_id_;
+      lock.unlock();
+      listener(max_flushed_tranc_id);
+      lock.lock();
+    }
+    flushed_total_ = std::max(flushed_total_, removed);
+    complete_flush_requests_();
+  }
+  flush_scheduled_ = false;
+  schedule_flush_locked_();
+  if (!flush_scheduled_) {
+    // 析构时等待刷盘任务全部结束
+    stall_cv_.notify_all();
+  }
+  lock.unlock();
 
-  // 1. 先判断 l0 sst 是否数量超限需要concat到 l1
-  if (level_sst_ids.find(0) != level_sst_ids.end() &&
-      level_sst_ids[0].size() >=
-          TomlConfig::getInstance().getLsmSstLevelRatio()) {
-    full_compact(0);
+  if (flushed_tranc_id.has_value()) {
+    schedule_compaction_();
+  }
+}
+
+void LSMEngine::schedule_compaction_() {
+  if (compaction_scheduled_.exchange(true)) {
+    return;
+  }
+  if (!scheduler_->schedule(JobPriority::LOW,
+                            [this]() { compaction_job_(); })) {
+    compaction_scheduled_ = false;
+  }
+}
+
+void LSMEngine::compaction_job_() {
+  try {
+    std::lock_guard<std::mutex> compaction_lock(compaction_mtx_);
+    // 读取 l0 的数量之前清除标记, 之后的刷盘会重新提交任务
+    compaction_scheduled_ = false;
+    if (scheduler_->is_shutting_down()) {
+      return;
+    }
+    size_t l0_count = 0;
+    {
+      std::shared_lock<std::shared_mutex> lock(ssts_mtx); // 读锁
+      auto it = level_sst_ids.find(0);
+      if (it != level_sst_ids.end()) {
+        l0_count = it->second.size();
+      }
+    }
+    if (l0_count >= static_cast<size_t>(
+                        TomlConfig::getInstance().getLsmSstLevelRatio())) {
+      full_compact(0);
+    }
+  } catch (const std::exception &e) {
+    // 输入的 sst 保持不变, 下次刷盘后重试
+    spdlog::error("LSMEngine--compaction_job_(): compaction failed: {}",
+                  e.what());
+  }
+}
+
+void LSMEngine::delete_obsolete_ssts_() {
+  std::vector<std::shared_ptr<SST>> obsolete;
+  {
+    std::lock_guard<std::mutex> lock(obsolete_mtx_);
+    obsolete.swap(obsolete_ssts_);
+  }
+  for (auto &sst : obsolete) {
+    // 仍被版本快照引用的 sst 已经打开, 删除文件不影响读取
+    sst->del_sst();
+    spdlog::debug("LSMEngine--Deleted obsolete SST {}", sst->get_sst_id());
+  }
+}
+
+std::optional<uint64_t> LSMEngine::flush_oldest_() {
+  // TODO: Lab 4.1 刷盘形成sst文件
+  // 构建 sst 期间不持有 ssts_mtx, 不会等待正在归并的 compaction
+  std::lock_guard<std::mutex> flush_lock(flush_oldest_mtx_);
+  if (memtable.get_frozen_count() == 0) {
+    return std::nullopt;
   }
 
+  // 1. l0 sst 数量超限时由刷盘之后的 compaction 任务 concat 到 l1
+
   // 2. 创建新的 SST ID
-  size_t new_sst_id = next_sst_id++;
+  size_t new_sst_id = allocate_sst_id_();
 
   // 3. 准备 SSTBuilder
-  SSTBuilder builder(TomlConfig::getInstance().getLsmBlockSize(),
-                     true); // 4KB block size
+  SSTBuilder builder(
+      TomlConfig::getInstance().getLsmBlockSize(), true,
+      TomlConfig::getInstance().getLsmSstIndexPartitionBlocks()); // 4KB block size
 
-  // 4. 将 memtable 中最旧的表写入 SST
-  std::vector<uint64_t> flushed_tranc_ids;
+  // 4. 将 memtable 中最旧的冻结表写入 SST
   auto sst_path = get_sst_path(new_sst_id, 0);
   auto new_sst =
       memtable.flush_last(builder, sst_path, new_sst_id, block_cache);
 
-  // 5. 更新内存索引
-  ssts[new_sst_id] = new_sst;
-
   // Export the newly created SST for debugging (only if LSM_EXPORT_SST env var
   // is set)
   if (std::getenv("LSM_EXPORT_SST")) {
@@ -533,8 +887,15 @@ uint64_t LSMEngine::flush() {
     }
   }
 
-  // 6. 更新 sst_ids
-  level_sst_ids[0].push_front(new_sst_id);
+  // 5. 更新内存索引并发布新版本, 之后才能从 memtable 中移除已刷盘的表,
+  // 保证读取者总能在 memtable 或版本中看到这部分数据
+  {
+    std::unique_lock<std::shared_mutex> lock(ssts_mtx); // 写锁
+    ssts[new_sst_id] = new_sst;
+    level_sst_ids[0].push_front(new_sst_id);
+    install_version_();
+    memtable.remove_last_frozen();
+  }
 
   // 返回新刷入的 sst 的最大的 tranc_id
   spdlog::info("LSMEngine--"
@@ -562,9 +923,10 @@ LSMEngine::lsm_iters_monotony_predicate(
   // 2) 再从各层 SST 中提取满足谓词范围内的键值，汇总到一个 HeapIterator
   // 的底料上
   std::vector<SearchItem> item_vec;
-  for (auto &[sst_level, sst_ids] : level_sst_ids) {
-    for (auto &sst_id : sst_ids) {
-      auto sst = ssts[sst_id];
+  auto version = get_version();
+  for (size_t sst_level = 0; sst_level < version->levels.size(); sst_level++) {
+    for (auto &sst : version->levels[sst_level]) {
+      auto sst_id = sst->get_sst_id();
       auto result = sst_iters_monotony_predicate(sst, tranc_id, predicate);
       if (!result.has_value()) {
         continue;
@@ -581,7 +943,7 @@ LSMEngine::lsm_iters_monotony_predicate(
       for (auto it = it_begin; it.is_valid() && !it.is_end(); ++it) {
         // 注意：L0层SST文件键范围重叠，返回的迭代器范围可能比实际谓词匹配范围更宽
         // 因此需要在此进行精确过滤
-        if (predicate(it.key()) != 0) {
+        if (predicate(std::string(it.key())) != 0) {
           break;
         }
         if (tranc_id != 0 && it_begin.get_tranc_id() > tranc_id) {
@@ -593,8 +955,9 @@ LSMEngine::lsm_iters_monotony_predicate(
           continue;
         }
         // idx 用 -sst_id 让 L0 中更新的 SST（更大的 id）在堆中优先
-        item_vec.emplace_back(it.key(), it.value(), -static_cast<int>(sst_id),
-                              sst_level, it.get_tranc_id());
+        item_vec.emplace_back(std::string(it.key()), std::string(it.value()),
+                              -static_cast<int>(sst_id), sst_level,
+                              it.get_tranc_id());
       }
     }
   }
@@ -628,6 +991,24 @@ Level_Iterator LSMEngine::begin(uint64_t tranc_id) {
   return Level_Iterator(shared_from_this(), tranc_id);
 }
 
+Level_Iterator LSMEngine::scan(const std::string &lower,
+                               const std::string &upper, uint64_t tranc_id) {
+  return Level_Iterator(shared_from_this(), tranc_id, lower, upper);
+}
+
+Level_Iterator LSMEngine::scan_prefix(const std::string &prefix,
+                                      uint64_t tranc_id) {
+  // 前缀的上界: 去掉末尾的 0xff 后将最后一个字节加一
+  std::string upper = prefix;
+  while (!upper.empty() && static_cast<uint8_t>(upper.back()) == 0xff) {
+    upper.pop_back();
+  }
+  if (!upper.empty()) {
+    upper.back() = static_cast<char>(static_cast<uint8_t>(upper.back()) + 1);
+  }
+  return Level_Iterator(shared_from_this(), tranc_id, prefix, upper, prefix);
+}
+
 Level_Iterator LSMEngine::end() {
   // TODO: Lab 4.7
   // 返回默认构造的 end 哨兵，避免在构造函数中访问空 engine 导致崩溃
@@ -638,10 +1019,20 @@ void LSMEngine::full_compact(size_t src_level) {
   // TODO: Lab 4.5 负责完成整个 full compact
   // ? 你可能需要控制`Compact`流程需要递归地进行
   // 将 src_level 的 sst 全体压缩到 src_level + 1
+  // 调用者需要持有 compaction_mtx_. 只在选取输入和安装输出时持有
+  // ssts_mtx, 归并期间刷盘可以继续向 l0 添加 sst
 
   // 递归地判断下一级 level 是否需要 full compact
-  if (level_sst_ids[src_level + 1].size() >=
-      TomlConfig::getInstance().getLsmSstLevelRatio()) {
+  size_t next_level_count = 0;
+  {
+    std::shared_lock<std::shared_mutex> lock(ssts_mtx); // 读锁
+    auto it = level_sst_ids.find(src_level + 1);
+    if (it != level_sst_ids.end()) {
+      next_level_count = it->second.size();
+    }
+  }
+  if (next_level_count >= static_cast<size_t>(
+                              TomlConfig::getInstance().getLsmSstLevelRatio())) {
     full_compact(src_level + 1);
   }
 
@@ -649,17 +1040,36 @@ void LSMEngine::full_compact(size_t src_level) {
                 "Compaction: Starting full compaction from level{} to level{}",
                 src_level, src_level + 1);
 
-  // 获取源level和目标level的 sst_id
-  auto old_level_id_x = level_sst_ids[src_level];
-  auto old_level_id_y = level_sst_ids[src_level + 1];
+  // 获取源level和目标level的 sst 快照, 其他 level 只会被 compaction 修改,
+  // l0 在归并期间可能增加新的 sst
+  std::vector<size_t> lx_ids;
+  std::vector<size_t> ly_ids;
+  SortedRun lx_ssts;
+  SortedRun ly_ssts;
+  {
+    std::shared_lock<std::shared_mutex> lock(ssts_mtx); // 读锁
+    auto lx_it = level_sst_ids.find(src_level);
+    if (lx_it != level_sst_ids.end()) {
+      lx_ids.assign(lx_it->second.begin(), lx_it->second.end());
+    }
+    auto ly_it = level_sst_ids.find(src_level + 1);
+    if (ly_it != level_sst_ids.end()) {
+      ly_ids.assign(ly_it->second.begin(), ly_it->second.end());
+    }
+    for (auto id : lx_ids) {
+      lx_ssts.push_back(ssts.at(id));
+    }
+    for (auto id : ly_ids) {
+      ly_ssts.push_back(ssts.at(id));
+    }
+  }
+
   std::vector<std::shared_ptr<SST>> new_ssts;
-  std::vector<size_t> lx_ids(old_level_id_x.begin(), old_level_id_x.end());
-  std::vector<size_t> ly_ids(old_level_id_y.begin(), old_level_id_y.end());
   if (src_level == 0) {
     // l0这一层不同sst的key有重叠, 需要额外处理
-    new_ssts = full_l0_l1_compact(lx_ids, ly_ids);
+    new_ssts = full_l0_l1_compact(lx_ssts, ly_ssts);
   } else {
-    new_ssts = full_common_compact(lx_ids, ly_ids, src_level + 1);
+    new_ssts = full_common_compact(lx_ssts, ly_ssts, src_level + 1);
   }
 
   // Export newly generated SSTs for debugging (only if LSM_EXPORT_SST env var
@@ -685,28 +1095,40 @@ void LSMEngine::full_compact(size_t src_level) {
     }
   }
 
-  // 完成 compact 后移除旧的sst记录
-  for (auto &old_sst_id : old_level_id_x) {
-    ssts[old_sst_id]->del_sst();
-    ssts.erase(old_sst_id);
-  }
-  for (auto &old_sst_id : old_level_id_y) {
-    ssts[old_sst_id]->del_sst();
-    ssts.erase(old_sst_id);
-  }
-  level_sst_ids[src_level].clear();
-  level_sst_ids[src_level + 1].clear();
-
-  cur_max_level = std::max(cur_max_level, src_level + 1);
-
-  // 添加新的sst
-  for (auto &new_sst : new_ssts) {
-    level_sst_ids[src_level + 1].push_back(new_sst->get_sst_id());
-    ssts[new_sst->get_sst_id()] = new_sst;
+  {
+    std::unique_lock<std::shared_mutex> lock(ssts_mtx); // 写锁
+    // 完成 compact 后移除旧的sst记录, 文件由低优先级任务删除
+    {
+      std::lock_guard<std::mutex> obsolete_lock(obsolete_mtx_);
+      for (auto &old_sst_id : lx_ids) {
+        obsolete_ssts_.push_back(ssts[old_sst_id]);
+        ssts.erase(old_sst_id);
+      }
+      for (auto &old_sst_id : ly_ids) {
+        obsolete_ssts_.push_back(ssts[old_sst_id]);
+        ssts.erase(old_sst_id);
+      }
+    }
+    // 只移除参与归并的 sst, 归并期间刷盘写入的 l0 sst 保留
+    auto &level_x = level_sst_ids[src_level];
+    level_x.erase(std::remove_if(level_x.begin(), level_x.end(),
+                                 [this](size_t sst_id) {
+                                   return ssts.find(sst_id) == ssts.end();
+                                 }),
+                  level_x.end());
+    level_sst_ids[src_level + 1].clear();
+
+    cur_max_level = std::max(cur_max_level.load(), src_level + 1);
+
+    // 添加新的sst, 输出已经按 key 排序
+    for (auto &new_sst : new_ssts) {
+      level_sst_ids[src_level + 1].push_back(new_sst->get_sst_id());
+      ssts[new_sst->get_sst_id()] = new_sst;
+    }
+    // 所有 subcompaction 的输出在同一个版本中发布
+    install_version_();
   }
-  // 此处没必要reverse了
-  std::sort(level_sst_ids[src_level + 1].begin(),
-            level_sst_ids[src_level + 1].end());
+  scheduler_->schedule(JobPriority::LOW, [this]() { delete_obsolete_ssts_(); });
 
   spdlog::debug("LSMEngine--"
                 "Compaction: Finished compaction. New SSTs added at level{}",
@@ -714,80 +1136,229 @@ void LSMEngine::full_compact(size_t src_level) {
 }
 
 std::vector<std::shared_ptr<SST>>
-LSMEngine::full_l0_l1_compact(std::vector<size_t> &l0_ids,
-                              std::vector<size_t> &l1_ids) {
+LSMEngine::full_l0_l1_compact(const SortedRun &l0_ssts,
+                              const SortedRun &l1_ssts) {
   // TODO: Lab 4.5 负责完成 l0 和 l1 的 full compact
-  std::vector<SstIterator> l0_iters;
-  std::vector<std::shared_ptr<SST>> l1_ssts;
-
-  for (auto id : l0_ids) {
-    auto sst_it = ssts[id]->begin(0);
-    l0_iters.push_back(sst_it);
+  // l0 的sst之间的key有重叠, 每个 sst 单独作为归并的数据源,
+  // 较新的 sst 在前, 最后是串联的 l1
+  SortedRun l0_sorted(l0_ssts.begin(), l0_ssts.end());
+  std::sort(l0_sorted.begin(), l0_sorted.end(),
+            [](const std::shared_ptr<SST> &lhs,
+               const std::shared_ptr<SST> &rhs) {
+              return lhs->get_sst_id() > rhs->get_sst_id();
+            });
+
+  std::vector<SortedRun> runs;
+  for (auto &sst : l0_sorted) {
+    runs.push_back({sst});
   }
-  for (auto id : l1_ids) {
-    l1_ssts.push_back(ssts[id]);
-  }
-  // l0 的sst之间的key有重叠, 需要合并
-  auto [l0_begin, l0_end] = SstIterator::merge_sst_iterator(l0_iters, 0);
-
-  std::shared_ptr<HeapIterator> l0_begin_ptr =
-      std::make_shared<HeapIterator>(std::move(l0_begin));
+  runs.push_back(l1_ssts);
 
-  std::shared_ptr<ConcactIterator> old_l1_begin_ptr =
-      std::make_shared<ConcactIterator>(l1_ssts, 0);
+  return compact_runs_(runs,
+                       TomlConfig::getInstance().getLsmPerMemSizeLimit() *
+                           TomlConfig::getInstance().getLsmSstLevelRatio(),
+                       1);
+}
 
-  TwoMergeIterator l0_l1_begin(l0_begin_ptr, old_l1_begin_ptr, 0);
+std::vector<std::shared_ptr<SST>>
+LSMEngine::full_common_compact(const SortedRun &lx_ssts,
+                               const SortedRun &ly_ssts, size_t level_y) {
+  // TODO: Lab 4.5 负责完成其他相邻 level 的 full compact
+  // TODO:如果目标 level 的下一级 level+1 不存在, 则为底层的level,
+  // 可以清理掉删除标记
 
-  return gen_sst_from_iter(l0_l1_begin,
-                           TomlConfig::getInstance().getLsmPerMemSizeLimit() *
-                               TomlConfig::getInstance().getLsmSstLevelRatio(),
-                           1);
+  return compact_runs_({lx_ssts, ly_ssts}, LSMEngine::get_sst_size(level_y),
+                       level_y);
 }
 
 std::vector<std::shared_ptr<SST>>
-LSMEngine::full_common_compact(std::vector<size_t> &lx_ids,
-                               std::vector<size_t> &ly_ids, size_t level_y) {
-  // TODO: Lab 4.5 负责完成其他相邻 level 的 full compact
-  std::vector<std::shared_ptr<SST>> lx_iters;
-  std::vector<std::shared_ptr<SST>> ly_iters;
+LSMEngine::compact_runs_(const std::vector<SortedRun> &runs,
+                         size_t target_sst_size, size_t target_level) {
+  // 每个子任务至少有约 target_sst_size 的输入, 避免生成过多的小 sst
+  size_t input_size = 0;
+  for (auto &run : runs) {
+    for (auto &sst : run) {
+      input_size += sst->sst_size();
+    }
+  }
+  size_t max_subcompactions = static_cast<size_t>(
+      std::max(1, TomlConfig::getInstance().getLsmMaxSubcompactions()));
+  size_t count = std::clamp<size_t>(input_size / std::max<size_t>(
+                                                     target_sst_size, 1),
+                                    1, max_subcompactions);
+
+  // 从输入 sst 的首 key 中均匀地选取范围的分界
+  std::vector<std::string> bounds;
+  if (count > 1) {
+    std::vector<std::string> keys;
+    for (auto &run : runs) {
+      for (auto &sst : run) {
+        keys.push_back(sst->get_first_key());
+      }
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    // 最小的首 key 之前没有数据, 不能作为分界
+    keys.erase(keys.begin());
+    count = std::min(count, keys.size() + 1);
+    for (size_t i = 1; i < count; i++) {
+      bounds.push_back(keys[i * keys.size() / count]);
+    }
+  }
+  count = bounds.size() + 1;
 
-  for (auto id : lx_ids) {
-    lx_iters.push_back(ssts[id]);
+  std::vector<std::vector<std::shared_ptr<SST>>> outputs(count);
+  std::vector<std::exception_ptr> errors(count);
+  auto run_range = [&](size_t i) {
+    try {
+      if (scheduler_->is_shutting_down()) {
+        throw std::runtime_error("LSMEngine--compaction cancelled by shutdown");
+      }
+      outputs[i] = compact_range_(runs, i == 0 ? "" : bounds[i - 1],
+                                  i + 1 < count ? bounds[i] : "",
+                                  target_sst_size, target_level);
+    } catch (...) {
+      errors[i] = std::current_exception();
+    }
+  };
+
+  // 其余范围提交到低优先级线程池, 当前线程执行第一个范围后认领尚未开始的
+  // 范围. 线程池只有一个线程或已经关闭时也不会死锁
+  struct Subcompactions {
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::vector<bool> claimed;
+    size_t running = 0;
+  };
+  auto state = std::make_shared<Subcompactions>();
+  state->claimed.assign(count, false);
+  for (size_t i = 1; i < count; i++) {
+    scheduler_->schedule(JobPriority::LOW, [state, i, &run_range]() {
+      {
+        std::lock_guard<std::mutex> lock(state->mtx);
+        if (state->claimed[i]) {
+          // 已由发起 compaction 的线程执行, 不能再访问它的局部变量
+          return;
+        }
+        state->claimed[i] = true;
+        state->running++;
+      }
+      run_range(i);
+      {
+        std::lock_guard<std::mutex> lock(state->mtx);
+        state->running--;
+      }
+      state->cv.notify_all();
+    });
+  }
+  run_range(0);
+  for (size_t i = 1; i < count; i++) {
+    {
+      std::lock_guard<std::mutex> lock(state->mtx);
+      if (state->claimed[i]) {
+        continue;
+      }
+      state->claimed[i] = true;
+    }
+    run_range(i);
   }
-  for (auto id : ly_ids) {
-    ly_iters.push_back(ssts[id]);
+  {
+    std::unique_lock<std::mutex> lock(state->mtx);
+    state->cv.wait(lock, [&state]() { return state->running == 0; });
   }
 
-  std::shared_ptr<ConcactIterator> old_lx_begin_ptr =
-      std::make_shared<ConcactIterator>(lx_iters, 0);
+  std::vector<std::shared_ptr<SST>> new_ssts;
+  for (auto &output : outputs) {
+    new_ssts.insert(new_ssts.end(), output.begin(), output.end());
+  }
+  for (auto &error : errors) {
+    if (error) {
+      // 输入保持不变, 已生成的输出没有被任何版本引用
+      for (auto &sst : new_ssts) {
+        sst->del_sst();
+      }
+      std::rethrow_exception(error);
+    }
+  }
 
-  std::shared_ptr<ConcactIterator> old_ly_begin_ptr =
-      std::make_shared<ConcactIterator>(ly_iters, 0);
+  if (count > 1) {
+    spdlog::debug("LSMEngine--"
+                  "Compaction: {} bytes to level{} split into {} "
+                  "subcompactions",
+                  input_size, target_level, count);
+  }
+  return new_ssts;
+}
 
-  TwoMergeIterator lx_ly_begin(old_lx_begin_ptr, old_ly_begin_ptr, 0);
+std::vector<std::shared_ptr<SST>>
+LSMEngine::compact_range_(const std::vector<SortedRun> &runs,
+                          const std::string &lower, const std::string &upper,
+                          size_t target_sst_size, size_t target_level) {
+  // compaction 的输入只会被顺序读取一次, 使用较大的预读且不污染缓存
+  size_t readahead = std::max(
+      0, TomlConfig::getInstance().getLsmCompactionReadaheadBlocks());
+  std::vector<std::shared_ptr<BaseIterator>> iters;
+  for (auto &run : runs) {
+    // 只读取与范围有重叠的 sst
+    SortedRun overlapping;
+    for (auto &sst : run) {
+      if (sst->get_last_key() >= lower &&
+          (upper.empty() || sst->get_first_key() < upper)) {
+        overlapping.push_back(sst);
+      }
+    }
+    if (overlapping.empty()) {
+      continue;
+    }
+    auto iter =
+        std::make_shared<ConcactIterator>(std::move(overlapping), 0, lower);
+    iter->set_readahead(readahead, false);
+    iters.push_back(std::move(iter));
+  }
+  if (iters.empty()) {
+    return {};
+  }
 
-  // TODO:如果目标 level 的下一级 level+1 不存在, 则为底层的level,
-  // 可以清理掉删除标记
+  // compaction 需要保留删除标记
+  MergeIterator merge_iter(std::move(iters), 0, false);
+  return gen_sst_from_iter(merge_iter, target_sst_size, target_level, upper);
+}
 
-  return gen_sst_from_iter(lx_ly_begin, LSMEngine::get_sst_size(level_y),
-                           level_y);
+size_t LSMEngine::allocate_sst_id_() {
+  std::lock_guard<std::mutex> lock(sst_id_mtx_);
+  return next_sst_id++;
 }
 
 std::vector<std::shared_ptr<SST>>
 LSMEngine::gen_sst_from_iter(BaseIterator &iter, size_t target_sst_size,
-                             size_t target_level) {
+                             size_t target_level, const std::string &upper) {
   // TODO: Lab 4.5 实现从迭代器构造新的 SST
   std::vector<std::shared_ptr<SST>> new_ssts;
   auto new_sst_builder =
-      SSTBuilder(TomlConfig::getInstance().getLsmBlockSize(), true);
+      SSTBuilder(TomlConfig::getInstance().getLsmBlockSize(), true,
+                 TomlConfig::getInstance().getLsmSstIndexPartitionBlocks());
 
+  // 复用缓冲区, 避免逐条构造键值对
+  std::string key_buf, value_buf;
   while (iter.is_valid() && !iter.is_end()) {
-    auto kv = *iter;
-    new_sst_builder.add(kv.first, kv.second, 0);
+    if (!upper.empty() && iter.key() >= upper) {
+      break;
+    }
+    key_buf.assign(iter.key());
+    value_buf.assign(iter.value());
+    new_sst_builder.add(key_buf, value_buf, 0);
     ++iter;
 
     if (new_sst_builder.estimated_size() >= target_sst_size) {
-      size_t sst_id = next_sst_id++; // TODO: 后续优化并发性
+      if (scheduler_->is_shutting_down()) {
+        // 输入保持不变, 删除已经生成的输出
+        for (auto &sst : new_ssts) {
+          sst->del_sst();
+        }
+        throw std::runtime_error(
+            "LSMEngine--compaction cancelled by shutdown");
+      }
+      size_t sst_id = allocate_sst_id_();
       std::string sst_path = get_sst_path(sst_id, target_level);
       auto new_sst = new_sst_builder.build(sst_id, sst_path, this->block_cache);
       new_ssts.push_back(new_sst);
@@ -797,14 +1368,15 @@ LSMEngine::gen_sst_from_iter(BaseIterator &iter, size_t target_sst_size,
                     "at level{}",
                     sst_id, target_level);
 
-      new_sst_builder = SSTBuilder(TomlConfig::getInstance().getLsmBlockSize(),
-                                   true); // 重置builder
+      new_sst_builder = SSTBuilder(
+          TomlConfig::getInstance().getLsmBlockSize(), true,
+          TomlConfig::getInstance().getLsmSstIndexPartitionBlocks()); // 重置builder
     }
   }
 
   // 构建剩余的 entries
   if (new_sst_builder.estimated_size() > 0) {
-    size_t sst_id = next_sst_id++; // TODO: 后续优化并发性
+    size_t sst_id = allocate_sst_id_();
     std::string sst_path = get_sst_path(sst_id, target_level);
     auto new_sst = new_sst_builder.build(sst_id, sst_path, this->block_cache);
     new_ssts.push_back(new_sst);
@@ -835,30 +1407,40 @@ LSM::LSM(std::string path)
   // TODO: Lab 5.5 控制WAL重放与组件的初始化
   // 设置 TranManager 的 engine 引用
   tran_manager_->set_engine(engine);
-  auto recover_map = tran_manager_->check_recover();
-  for (auto &[tran_id, records] : recover_map) {
-    bool has_commit = false;
-    for (auto &record : records) {
-      if (record.getOperationType() == OperationType::COMMIT) {
-        has_commit = true;
-        break;
-      }
-    }
-    if (has_commit) {
-      for (auto &record : records) {
-        if (record.getOperationType() == OperationType::PUT) {
-          engine->memtable.put(record.getKey(), record.getValue(),
-                               record.getTrancId());
-        } else if (record.getOperationType() == OperationType::DELETE) {
-          engine->memtable.remove(record.getKey(), record.getTrancId());
+  // 后台刷盘完成后更新持久化的事务状态, 之后对应的 WAL 段才能被清理
+  engine->set_flush_listener(
+      [weak_tran_manager = std::weak_ptr<TranManager>(tran_manager_)](
+          uint64_t max_flushed_tranc_id) {
+        if (auto tran_manager = weak_tran_manager.lock()) {
+          tran_manager->update_max_flushed_tranc_id(max_flushed_tranc_id);
         }
-      }
-    }
-  }
+      });
+  // 各个 WAL 段并行解码后按顺序重放, 重放期间冻结活跃表时新的值不会
+  // 落在旧的值之前. 每个已提交事务以一次 put_batch 写入 memtable,
+  // 删除以空值写入. 同一事务内相同 key 的后一条记录覆盖前一条
+  tran_manager_->replay_wal(
+      [this](uint64_t tranc_id, std::vector<Record> &records) {
+        std::vector<std::pair<std::string, std::string>> kvs;
+        for (auto &record : records) {
+          if (record.getOperationType() == OperationType::PUT) {
+            kvs.emplace_back(record.getKey(), record.getValue());
+          } else if (record.getOperationType() == OperationType::DELETE) {
+            kvs.emplace_back(record.getKey(), "");
+          }
+        }
+        if (!kvs.empty()) {
+          engine->memtable.put_batch(kvs, tranc_id);
+        }
+      });
 }
 
 LSM::~LSM() {
-  flush_all();
+  // 析构函数中不能抛出异常, 未刷盘的数据仍在 WAL 中, 下次启动时重放
+  try {
+    flush_all();
+  } catch (const std::exception &e) {
+    spdlog::error("LSMEngine--~LSM(): flush failed: {}", e.what());
+  }
   tran_manager_->write_tranc_id_file();
 }
 
@@ -914,15 +1496,41 @@ void LSM::remove_batch(const std::vector<std::string> &keys) {
   engine->remove_batch(keys, tranc_id);
 }
 
+bool LSM::write(const WriteBatch &batch, const WriteOptions &options) {
+  if (batch.empty()) {
+    return true;
+  }
+  if (options.no_slowdown && engine->write_stalled()) {
+    return false;
+  }
+
+  auto tranc_id = tran_manager_->getNextTransactionId();
+  if (!options.disable_wal) {
+    std::vector<Record> records;
+    records.reserve(batch.size() + 2);
+    records.push_back(Record::createRecord(tranc_id));
+    for (auto &[key, value] : batch.kvs()) {
+      if (value.empty()) {
+        records.push_back(Record::deleteRecord(tranc_id, key));
+      } else {
+        records.push_back(Record::putRecord(tranc_id, key, value));
+      }
+    }
+    records.push_back(Record::commitRecord(tranc_id));
+    tran_manager_->write_to_wal(records, options.sync);
+  }
+
+  engine->put_batch(batch.kvs(), tranc_id);
+  return true;
+}
+
 void LSM::clear() { engine->clear(); }
 
-void LSM::flush() { auto max_tranc_id = engine->flush(); }
+std::shared_future<uint64_t> LSM::flush() { return engine->flush(); }
 
 void LSM::flush_all() {
-  while (engine->memtable.get_total_size() > 0) {
-    auto max_tranc_id = engine->flush();
-    tran_manager_->update_max_flushed_tranc_id(max_tranc_id);
-  }
+  // 刷盘完成后由 flush listener 更新 max_flushed_tranc_id
+  engine->flush().get();
 }
 
 LSM::LSMIterator LSM::begin(uint64_t tranc_id) {
@@ -931,6 +1539,16 @@ LSM::LSMIterator LSM::begin(uint64_t tranc_id) {
 
 LSM::LSMIterator LSM::end() { return engine->end(); }
 
+LSM::LSMIterator LSM::scan(const std::string &lower, const std::string &upper,
+                           uint64_t tranc_id) {
+  return engine->scan(lower, upper, tranc_id);
+}
+
+LSM::LSMIterator LSM::scan_prefix(const std::string &prefix,
+                                  uint64_t tranc_id) {
+  return engine->scan_prefix(prefix, tranc_id);
+}
+
 std::optional<std::pair<TwoMergeIterator, TwoMergeIterator>>
 LSM::lsm_iters_monotony_predicate(
     uint64_t tranc_id, std::function<int(const std::string &)> predicate) {
@@ -3,151 +3,108 @@
 #include "../../include/sst/concact_iterator.h"
 #include "../../include/sst/sst.h"
 #include <memory>
-#include <shared_mutex>
 #include <string>
 
 // TODO: 需要进行单元测试
 namespace tiny_lsm {
 Level_Iterator::Level_Iterator(std::shared_ptr<LSMEngine> engine,
                                uint64_t max_tranc_id)
-    : engine_(engine), max_tranc_id_(max_tranc_id), rlock_(engine_->ssts_mtx) {
-  // 成员变量获取sst读锁
-
-  // 1. 获取内存部分迭代器
-  // TODO: 这里最好修改 memtable.begin 使其返回一个指针, 避免多余的内存拷贝
-  // auto mem_iter = engine_->memtable.begin(max_tranc_id_);
-  // std::shared_ptr<HeapIterator> mem_iter_ptr =
-  // std::make_shared<HeapIterator>(); *mem_iter_ptr = mem_iter;
-  auto mem_iter = engine_->memtable.begin(max_tranc_id_);
-  auto mem_iter_ptr = std::make_shared<HeapIterator>(std::move(mem_iter));
-  iter_vec.push_back(mem_iter_ptr);
-
-  // 2. 获取 L0 层的迭代器
-  std::vector<SearchItem> item_vec;
-  for (auto &sst_id : engine_->level_sst_ids[0]) {
-    auto sst = engine_->ssts[sst_id];
-    for (auto iter = sst->begin(max_tranc_id_); iter.is_valid(); ++iter) {
-      // 对同一 key 且同一事务 id 的项，SearchItem 按 level 升序、再按 idx
-      // 升序比较。 在 L0 中，较新的 SST 对应的 sst_id 更大。为了让较新的 SST
-      // 的记录优先出现， 我们把 SearchItem::idx_ 设为 -sst_id（即将 sst_id
-      // 取反），使得原本更大的 sst_id 在 idx 比较中变成更小的值，从而在 heap
-      // 中被优先弹出。
-      item_vec.emplace_back(iter.key(), iter.value(), -sst_id, 0,
-                            iter.get_tranc_id());
-    }
-  }
-  std::shared_ptr<HeapIterator> l0_iter_ptr =
-      std::make_shared<HeapIterator>(item_vec, max_tranc_id);
-  iter_vec.push_back(l0_iter_ptr);
+    : Level_Iterator(engine, max_tranc_id, "", "") {}
 
-  // 3. 获取其他层的迭代器
-  for (auto &[level, sst_id_list] : engine_->level_sst_ids) {
-    if (level == 0) {
-      continue;
-    }
-    // 为该层一次性创建一个 ConcactIterator（串联本层所有 SST），
-    // 而不是在逐步增长的 ssts 前缀上重复创建多个迭代器。
-    // 之前的写法会导致 [sst0], [sst0,sst1], [sst0,sst1,sst2] ...
-    // 多个前缀迭代器被加入， 既效率低也会引入重复遍历。
-    std::vector<std::shared_ptr<SST>> ssts;
-    ssts.reserve(sst_id_list.size());
-    for (auto sst_id : sst_id_list) {
-      ssts.push_back(engine_->ssts[sst_id]);
+Level_Iterator::Level_Iterator(std::shared_ptr<LSMEngine> engine,
+                               uint64_t max_tranc_id, const std::string &lower,
+                               const std::string &upper,
+                               const std::string &prefix)
+    : engine_(engine), max_tranc_id_(max_tranc_id), upper_(upper),
+      prefix_(prefix) {
+  build_iters(lower);
+}
+
+void Level_Iterator::build_iters(const std::string &lower) {
+  // 每个数据源只保留一个游标, 由 MergeIterator 按需归并
+  // iter_vec 中的数据源按从新到旧排列
+  std::vector<std::shared_ptr<BaseIterator>> iter_vec;
+  auto overlaps = [&](const std::shared_ptr<SST> &sst) {
+    if (sst->get_last_key() < lower ||
+        (!upper_.empty() && sst->get_first_key() >= upper_)) {
+      return false;
     }
-    if (!ssts.empty()) {
-      std::shared_ptr<ConcactIterator> level_i_iter =
-          std::make_shared<ConcactIterator>(std::move(ssts), max_tranc_id);
-      iter_vec.push_back(level_i_iter);
+    // 前缀扫描时 sst 的 key 范围可能横跨该前缀却不包含它,
+    // 通过前缀过滤器避免打开这类 sst 的 block
+    return prefix_.empty() || sst->may_contain_prefix(prefix_);
+  };
+
+  // 1. 获取内存部分迭代器, 活跃表在前, 冻结表从新到旧
+  // 迭代器持有快照中的表, 不持有 memtable 的锁
+  auto mem_view = engine_->memtable.get_view();
+  auto add_table = [&](const std::shared_ptr<SkipList> &table) {
+    auto iter = std::make_shared<MemTableIterator>(table, max_tranc_id_);
+    if (!lower.empty()) {
+      iter->seek(lower);
     }
+    iter_vec.push_back(std::move(iter));
+  };
+  add_table(mem_view->current);
+  for (auto &table : mem_view->frozen) {
+    add_table(table);
   }
 
-  while (!is_end()) {
-    auto [min_idx, _] = get_min_key_idx();
-    cur_idx_ = min_idx;
-    update_current();
-    auto cached_kv = *cached_value;
-    if (cached_kv.second.size() == 0) {
-      // 如果当前值为空, 说明当前key已经被删除了
-      // 需要跳过这个key
-      skip_key(cached_value->first);
+  // 2. 获取 sst 布局的快照
+  // 必须在获取 memtable 快照之后获取: flush 先发布包含新 sst 的版本再移除冻结表,
+  // 这样冻结表中的数据至少出现在其中一处 (重复的数据由归并去除)
+  version_ = engine_->get_version();
+
+  // 3. 获取 L0 层的迭代器
+  // L0 中 SST 的 key 范围重叠, 每个 SST 作为一个数据源, 较新的 SST 在前
+  for (auto &sst : version_->levels[0]) {
+    if (!overlaps(sst)) {
       continue;
-    } else {
-      // 找到一个合法的键值对, 跳出循环
-      break;
     }
+    iter_vec.push_back(std::make_shared<SstIterator>(
+        lower.empty() ? sst->begin(max_tranc_id_)
+                      : sst->lower_bound(lower, max_tranc_id_)));
   }
-}
 
-std::pair<size_t, std::string> Level_Iterator::get_min_key_idx() const {
-  size_t min_idx = 0;
-  std::string min_key = "";
-  for (size_t i = 0; i < iter_vec.size(); ++i) {
-    if (!iter_vec[i]->is_valid()) {
-      continue;
-    } else if (min_key == "") {
-      min_key = (**iter_vec[i]).first;
-      min_idx = i;
-    } else if ((**iter_vec[i]).first < min_key) { // 直接比较min_key
-      min_key = (**iter_vec[i]).first;
-      min_idx = i;
-    } else if ((**iter_vec[i]).first == min_key) {
-      // key相同时，应该选择事务ID最大的（最新的）记录
-      // 但这里需要确保两个迭代器的事务ID都对当前事务可见
-      uint64_t current_tranc_id = (*iter_vec[i]).get_tranc_id();
-      uint64_t min_tranc_id = (*iter_vec[min_idx]).get_tranc_id();
-
-      // 两个记录都对当前事务可见时，选择事务ID更大的
-      if (current_tranc_id <= max_tranc_id_ && min_tranc_id <= max_tranc_id_) {
-        if (current_tranc_id > min_tranc_id) {
-          min_idx = i;
-        }
-      } else if (current_tranc_id <= max_tranc_id_) {
-        // 只有当前迭代器可见
-        min_idx = i;
+  // 4. 获取其他层的迭代器
+  for (size_t level = 1; level < version_->levels.size(); level++) {
+    // 为该层一次性创建一个 ConcactIterator（串联本层所有 SST），
+    // 本层的 SST 按 key 有序且互不重叠, 只需要保留与范围相交的部分
+    std::vector<std::shared_ptr<SST>> ssts;
+    for (auto &sst : version_->levels[level]) {
+      if (overlaps(sst)) {
+        ssts.push_back(sst);
       }
-      // 否则保持原来的min_idx（min_tranc_id可见或两者都不可见时保持原样）
+    }
+    if (!ssts.empty()) {
+      iter_vec.push_back(std::make_shared<ConcactIterator>(
+          std::move(ssts), max_tranc_id_, lower));
     }
   }
-  return std::make_pair(min_idx, min_key);
+
+  merge_it_ = MergeIterator(std::move(iter_vec), max_tranc_id_);
 }
 
-void Level_Iterator::skip_key(const std::string &key) {
-  for (size_t i = 0; i < iter_vec.size(); ++i) {
-    while ((*iter_vec[i]).is_valid() && (**iter_vec[i]).first == key) {
-      // 如果找到当前key, 则跳过这个key
-      ++(*iter_vec[i]);
-    }
+void Level_Iterator::seek(const std::string &key) {
+  cached_value.reset();
+  // 定位到前缀之外时不能再使用前缀过滤器
+  if (key.compare(0, prefix_.size(), prefix_) != 0) {
+    prefix_.clear();
   }
+  build_iters(key);
 }
 
 void Level_Iterator::update_current() const {
-  if (!(*iter_vec[cur_idx_]).is_valid()) {
+  if (is_end()) {
     throw std::runtime_error("Level_Iterator is invalid");
   }
-  // Ensure cached_value points to the correct value_type
-  auto cur_kv = *(*iter_vec[cur_idx_]);
-  cached_value = std::make_optional<value_type>(cur_kv.first, cur_kv.second);
+  if (!cached_value.has_value()) {
+    cached_value.emplace(merge_it_.key(), merge_it_.value());
+  }
 }
 
 BaseIterator &Level_Iterator::operator++() {
-  // 先跳过和当前 key 相同的部分
-  skip_key(cached_value->first);
-
-  // 重新选择key最小的迭代器
-  while (!is_end()) {
-    auto [min_idx, _] = get_min_key_idx();
-    cur_idx_ = min_idx;
-    update_current();
-    if (cached_value->second.size() == 0) {
-      // 如果当前值为空, 说明当前key已经被删除了
-      // 需要跳过这个key
-      skip_key(cached_value->first);
-      continue;
-    } else {
-      // 找到一个合法的键值对, 跳出循环
-      break;
-    }
-  }
+  cached_value.reset();
+  ++merge_it_;
   return *this;
 }
 
@@ -156,8 +113,7 @@ bool Level_Iterator::operator==(const BaseIterator &other) const {
     return false;
   }
   if (other.is_valid() && is_valid()) {
-    return (*other).first == cached_value->first &&
-           (*other).second == cached_value->second;
+    return other.key() == key() && other.value() == value();
   }
   if (!other.is_valid() && !is_valid()) {
     return true;
@@ -170,28 +126,37 @@ bool Level_Iterator::operator!=(const BaseIterator &other) const {
 }
 
 BaseIterator::value_type Level_Iterator::operator*() const {
-  if (!cached_value.has_value()) {
-    throw std::runtime_error("Level_Iterator is invalid");
-  }
+  update_current();
   return *cached_value;
 }
 
+std::string_view Level_Iterator::key() const {
+  if (!is_valid()) {
+    return {};
+  }
+  return merge_it_.key();
+}
+
+std::string_view Level_Iterator::value() const {
+  if (!is_valid()) {
+    return {};
+  }
+  return merge_it_.value();
+}
+
 IteratorType Level_Iterator::get_type() const {
   return IteratorType::LevelIterator;
 }
 
 uint64_t Level_Iterator::get_tranc_id() const { return max_tranc_id_; }
 
-bool Level_Iterator::is_end() const {
-  for (auto &iter : iter_vec) {
-    if ((*iter).is_valid()) {
-      return false;
-    }
-  }
-  return true;
-}
+bool Level_Iterator::is_end() const { return !is_valid(); }
 
-bool Level_Iterator::is_valid() const { return !is_end(); }
+bool Level_Iterator::is_valid() const {
+  // 超过上界后即视为结束, 不再继续归并
+  return merge_it_.is_valid() &&
+         (upper_.empty() || merge_it_.key() < upper_);
+}
 
 BaseIterator::pointer Level_Iterator::operator->() const {
   update_current();
@@ -1,3 +1,4 @@
+#include "../../include/config/config.h"
 #include "../../include/lsm/engine.h"
 #include "../../include/lsm/transaction.h"
 #include "../../include/utils/files.h"
@@ -241,12 +242,18 @@ TranManager::TranManager(std::string data_dir) : data_dir_(data_dir) {
 
 void TranManager::init_new_wal() {
   // TODO: Lab 5.x 初始化 wal
+  auto segment_size = TomlConfig::getInstance().getLsmWalSegmentSize();
   wal = std::make_shared<WAL>(data_dir_, 1024, max_finished_tranc_id_, 1,
-                              1024 * 1024);
+                              segment_size);
+  wal->set_max_flushed_tranc_id(max_flushed_tranc_id_);
 }
 
 void TranManager::set_engine(std::shared_ptr<LSMEngine> engine) {
   engine_ = std::move(engine);
+  // WAL 段的清理作为低优先级任务与 compaction 共用引擎的后台线程
+  if (wal != nullptr && engine_ != nullptr) {
+    wal->set_scheduler(engine_->get_scheduler());
+  }
 }
 
 TranManager::~TranManager() { write_tranc_id_file(); }
@@ -320,6 +327,10 @@ void TranManager::update_max_flushed_tranc_id(uint64_t tranc_id) {
   // REVIEW: 同上，若采用 flushedTrancIds_ 集合，需要在此更新集合并写入文件。
   max_flushed_tranc_id_.store(tranc_id);
   write_tranc_id_file();
+  // 持久化之后才允许清理线程删除对应的 WAL 段
+  if (wal != nullptr) {
+    wal->set_max_flushed_tranc_id(tranc_id);
+  }
 }
 
 uint64_t TranManager::getNextTransactionId() {
@@ -366,12 +377,19 @@ std::map<uint64_t, std::vector<Record>> TranManager::check_recover() {
   return WAL::recover(data_dir_, max_flushed_tranc_id_);
 }
 
-bool TranManager::write_to_wal(const std::vector<Record> &records) {
+void TranManager::replay_wal(const WAL::ReplayCallback &callback) {
+  auto threads = TomlConfig::getInstance().getLsmWalRecoveryThreads();
+  WAL::replay(data_dir_, max_flushed_tranc_id_, callback,
+              static_cast<size_t>(std::max(1, threads)));
+}
+
+bool TranManager::write_to_wal(const std::vector<Record> &records,
+                               bool sync) {
   // TODO: Lab 5.4
   if (wal == nullptr) {
     return false;
   }
-  wal->log(records, true);
+  wal->log(records, true, sync);
   return true;
 }
 
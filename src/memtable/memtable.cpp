@@ -4,6 +4,7 @@
 #include "../../include/iterator/iterator.h"
 #include "../../include/skiplist/skiplist.h"
 #include "../../include/sst/sst.h"
+#include "../../include/utils/row_cache.h"
 #include "spdlog/spdlog.h"
 #include <algorithm>
 #include <cstddef>
@@ -22,6 +23,7 @@ class BlockCache;
 // MemTable implementation using PIMPL idiom
 MemTable::MemTable() : frozen_bytes(0) {
   current_table = std::make_shared<SkipList>();
+  publish_view_();
 }
 MemTable::~MemTable() = default;
 
@@ -29,21 +31,21 @@ void MemTable::put_(const std::string &key, const std::string &value,
                     uint64_t tranc_id) {
   // TODO: Lab2.1 无锁版本的 put
   current_table->put(key, value, tranc_id);
+  // 写入 memtable 之后再失效行缓存
+  if (row_cache_ != nullptr) {
+    row_cache_->invalidate(key);
+  }
 }
 
 void MemTable::put(const std::string &key, const std::string &value,
                    uint64_t tranc_id) {
   // TODO: Lab2.1 有锁版本的 put
-  std::unique_lock<std::shared_mutex> slock1(cur_mtx);
-  put_(key, value, tranc_id);
-  if (current_table->get_size() >
-      TomlConfig::getInstance().getLsmPerMemSizeLimit()) {
-    // 冻结当前表还需要获取frozen_mtx的写锁
-    std::unique_lock<std::shared_mutex> lock2(frozen_mtx);
-    frozen_cur_table_();
-    spdlog::debug("MemTable--Current table size exceeded limit. Frozen and "
-                  "created new table.");
+  // 跳表支持并发插入, 活跃表的读锁只用于防止插入期间活跃表被冻结替换
+  {
+    std::shared_lock<std::shared_mutex> slock1(cur_mtx);
+    put_(key, value, tranc_id);
   }
+  frozen_cur_table_if_full_();
 }
 
 void MemTable::put_batch(
@@ -51,18 +53,31 @@ void MemTable::put_batch(
     uint64_t tranc_id) {
   // TODO: Lab2.1 有锁版本的 put_batch
   // ? tranc_id 参数可暂时忽略其逻辑判断, 直接插入即可
-  std::unique_lock<std::shared_mutex> slock1(cur_mtx);
-  for (auto &[k, v] : kvs) {
-    put_(k, v, tranc_id);
+  {
+    std::shared_lock<std::shared_mutex> slock1(cur_mtx);
+    for (auto &[k, v] : kvs) {
+      put_(k, v, tranc_id);
+    }
+  }
+  frozen_cur_table_if_full_();
+}
+
+void MemTable::frozen_cur_table_if_full_() {
+  auto limit = TomlConfig::getInstance().getLsmPerMemSizeLimit();
+  {
+    std::shared_lock<std::shared_mutex> slock1(cur_mtx);
+    if (current_table->get_size() <= limit) {
+      return;
+    }
   }
-  if (current_table->get_size() >
-      TomlConfig::getInstance().getLsmPerMemSizeLimit()) {
+  // 并发的写入者可能已经冻结了活跃表, 获取写锁后需要重新判断
+  std::unique_lock<std::shared_mutex> lock1(cur_mtx);
+  if (current_table->get_size() > limit) {
     // 冻结当前表还需要获取frozen_mtx的写锁
     std::unique_lock<std::shared_mutex> lock2(frozen_mtx);
     frozen_cur_table_();
-
-    spdlog::debug("MemTable--Current table size exceeded limit after batch "
-                  "put. Frozen and created new table.");
+    spdlog::debug("MemTable--Current table size exceeded limit. Frozen and "
+                  "created new table.");
   }
 }
 
@@ -96,13 +111,18 @@ SkipListIterator MemTable::frozen_get_(const std::string &key,
 SkipListIterator MemTable::get(const std::string &key, uint64_t tranc_id) {
   // TODO: Lab2.1 查询, 建议复用 cur_get_ 和 frozen_get_
   // ? 注意并发控制
-  std::shared_lock<std::shared_mutex> slock1(cur_mtx);
-  auto tmp = this->cur_get_(key, tranc_id);
+  // 在快照中查询, 不需要持有 memtable 的锁
+  auto view = get_view();
+  auto tmp = view->current->get(key, tranc_id);
   if (tmp.is_valid())
     return tmp;
-  slock1.unlock(); // 释放活跃表的锁
-  std::shared_lock<std::shared_mutex> slock2(frozen_mtx); // 获取冻结表的锁
-  return this->frozen_get_(key, tranc_id);
+  for (auto &table : view->frozen) {
+    auto result = table->get(key, tranc_id);
+    if (result.is_valid()) {
+      return result;
+    }
+  }
+  return SkipListIterator{};
 }
 
 SkipListIterator MemTable::get_(const std::string &key, uint64_t tranc_id) {
@@ -123,11 +143,11 @@ MemTable::get_batch(const std::vector<std::string> &keys, uint64_t tranc_id) {
       results;
   results.reserve(keys.size());
 
-  // 1. 先获取活跃表的锁
-  std::shared_lock<std::shared_mutex> slock1(cur_mtx);
+  // 1. 先查询活跃表, 整个批次使用同一个快照, 不需要持有 memtable 的锁
+  auto view = get_view();
   for (size_t idx = 0; idx < keys.size(); idx++) {
     auto key = keys[idx];
-    auto cur_res = cur_get_(key, tranc_id);
+    auto cur_res = view->current->get(key, tranc_id);
     if (cur_res.is_valid()) {
       // 值存在且不为空
       results.emplace_back(
@@ -151,14 +171,18 @@ MemTable::get_batch(const std::vector<std::string> &keys, uint64_t tranc_id) {
     return results;
   }
 
-  slock1.unlock(); // 释放活跃表的锁
-  std::shared_lock<std::shared_mutex> slock2(frozen_mtx); // 获取冻结表的锁
   for (size_t idx = 0; idx < keys.size(); idx++) {
     if (results[idx].second.has_value()) {
       continue; // 如果在活跃表中已经找到，则跳过
     }
     auto key = keys[idx];
-    auto frozen_result = frozen_get_(key, tranc_id);
+    SkipListIterator frozen_result;
+    for (auto &table : view->frozen) {
+      frozen_result = table->get(key, tranc_id);
+      if (frozen_result.is_valid()) {
+        break;
+      }
+    }
     if (frozen_result.is_valid()) {
       // 值存在且不为空
       results[idx] =
@@ -198,7 +222,17 @@ void MemTable::clear() {
   std::unique_lock<std::shared_mutex> lock1(cur_mtx);
   std::unique_lock<std::shared_mutex> lock2(frozen_mtx);
   frozen_tables.clear();
-  current_table->clear();
+  frozen_bytes = 0;
+  // 读取者可能仍持有旧快照中的表, 替换而不是原地清空
+  current_table = std::make_shared<SkipList>();
+  publish_view_();
+  if (row_cache_ != nullptr) {
+    row_cache_->clear();
+  }
+}
+
+void MemTable::set_row_cache(std::shared_ptr<RowCache> row_cache) {
+  row_cache_ = std::move(row_cache);
 }
 
 // 将最老的 memtable 写入 SST, 并返回控制类
@@ -208,32 +242,36 @@ MemTable::flush_last(SSTBuilder &builder, std::string &sst_path, size_t sst_id,
   spdlog::debug("MemTable--flush_last(): Starting to flush memtable to SST{}",
                 sst_id);
 
-  // 由于 flush 后需要移除最老的 memtable, 因此需要加写锁
-  std::unique_lock<std::shared_mutex> lock(frozen_mtx);
-
   uint64_t max_tranc_id = 0;
   uint64_t min_tranc_id = UINT64_MAX;
 
-  if (frozen_tables.empty()) {
-    // 如果当前表为空，直接返回nullptr
-    if (current_table->get_size() == 0) {
-      spdlog::debug(
-          "MemTable--flush_last(): Current table is empty, returning null");
-
-      return nullptr;
+  std::shared_ptr<SkipList> table;
+  {
+    std::shared_lock<std::shared_mutex> slock(frozen_mtx);
+    if (!frozen_tables.empty()) {
+      table = frozen_tables.back();
     }
-    // 将当前表加入到frozen_tables头部
-    frozen_tables.push_front(current_table);
-    frozen_bytes += current_table->get_size();
-    // 创建新的空表作为当前表
-    current_table = std::make_shared<SkipList>();
   }
+  if (table == nullptr) {
+    // 没有冻结表时才需要冻结活跃表, 避免无谓地等待活跃表的写锁
+    std::unique_lock<std::shared_mutex> lock1(cur_mtx);
+    std::unique_lock<std::shared_mutex> lock2(frozen_mtx);
+    if (frozen_tables.empty()) {
+      // 如果当前表为空，直接返回nullptr
+      if (current_table->get_size() == 0) {
+        spdlog::debug(
+            "MemTable--flush_last(): Current table is empty, returning null");
 
-  // 将最老的 memtable 写入 SST
-  std::shared_ptr<SkipList> table = frozen_tables.back();
-  frozen_tables.pop_back();
-  frozen_bytes -= table->get_size();
+        return nullptr;
+      }
+      // 将当前表冻结, 加入到frozen_tables头部
+      frozen_cur_table_();
+    }
+    table = frozen_tables.back();
+  }
 
+  // 最老的 memtable 在写入 SST 期间仍保留在 frozen_tables 中供读取,
+  // 调用者发布包含新 SST 的版本后再通过 remove_last_frozen 移除
   std::vector<std::tuple<std::string, std::string, uint64_t>> flush_data =
       table->flush();
   for (auto &[k, v, t] : flush_data) {
@@ -249,21 +287,58 @@ MemTable::flush_last(SSTBuilder &builder, std::string &sst_path, size_t sst_id,
   return sst;
 }
 
+void MemTable::remove_last_frozen() {
+  std::unique_lock<std::shared_mutex> lock(frozen_mtx);
+  if (frozen_tables.empty()) {
+    return;
+  }
+  frozen_bytes -= frozen_tables.back()->get_size();
+  frozen_tables.pop_back();
+  publish_view_();
+}
+
 void MemTable::frozen_cur_table_() {
   // TODO: 冻结活跃表
   spdlog::trace("MemTable--frozen_cur_table_(): Freezing current table");
   frozen_bytes += current_table->get_size();
+  frozen_total_++;
   frozen_tables.push_front(std::move(current_table));
   current_table = std::make_shared<SkipList>();
+  publish_view_();
+}
+
+void MemTable::publish_view_() {
+  auto view = std::make_shared<MemTableView>();
+  view->current = current_table;
+  view->frozen.assign(frozen_tables.begin(), frozen_tables.end());
+  view_.store(std::move(view));
+}
+
+std::shared_ptr<const MemTableView> MemTable::get_view() const {
+  return view_.load();
 }
 
 void MemTable::frozen_cur_table() {
   // TODO: 冻结活跃表, 有锁版本
   std::unique_lock<std::shared_mutex> lock1(cur_mtx);
   std::unique_lock<std::shared_mutex> lock2(frozen_mtx);
+  // 空表无法构建 sst, 不需要冻结
+  if (current_table->get_size() == 0) {
+    return;
+  }
   frozen_cur_table_();
 }
 
+size_t MemTable::get_frozen_count() {
+  std::shared_lock<std::shared_mutex> slock(frozen_mtx);
+  return frozen_tables.size();
+}
+
+uint64_t MemTable::get_frozen_total() {
+  std::shared_lock<std::shared_mutex> slock(frozen_mtx);
+  return frozen_total_;
+}
+
 size_t MemTable::get_cur_size() {
   std::shared_lock<std::shared_mutex> slock(cur_mtx);
   return current_table->get_size();
@@ -282,16 +357,15 @@ size_t MemTable::get_total_size() {
 
 HeapIterator MemTable::begin(uint64_t tranc_id) {
   // TODO Lab 2.2 MemTable 的迭代器
-  std::shared_lock<std::shared_mutex> slock1(cur_mtx);
-  std::shared_lock<std::shared_mutex> slock2(frozen_mtx);
+  auto view = get_view();
   std::vector<SearchItem> sea;
-  for (auto tmp : current_table->flush()) {
+  for (auto tmp : view->current->flush()) {
     auto [key, value, id] = tmp;
     sea.emplace_back(SearchItem(key, value, 0, 0, id));
   }
   int table_id = 1;
 
-  for (auto tmp : frozen_tables) {
+  for (auto &tmp : view->frozen) {
     for (auto tab : (*tmp).flush()) {
       auto [key, value, id] = tab;
       sea.emplace_back(SearchItem(key, value, table_id, 0, id));
@@ -303,8 +377,6 @@ HeapIterator MemTable::begin(uint64_t tranc_id) {
 
 HeapIterator MemTable::end() {
   // TODO Lab 2.2 MemTable 的迭代器
-  std::shared_lock<std::shared_mutex> slock1(cur_mtx);
-  std::shared_lock<std::shared_mutex> slock2(frozen_mtx);
   return HeapIterator{};
 }
 
@@ -314,11 +386,10 @@ HeapIterator MemTable::iters_preffix(const std::string &preffix,
 #pragma clang diagnostic ignored "-Wambiguous-reversed-operator"
 
   // TODO Lab 2.3 MemTable 的前缀迭代器
-  std::shared_lock<std::shared_mutex> slock1(cur_mtx);
-  std::shared_lock<std::shared_mutex> slock2(frozen_mtx);
+  auto view = get_view();
   std::vector<SearchItem> sea;
-  auto it = current_table->begin_preffix(preffix);
-  auto end = current_table->end_preffix(preffix);
+  auto it = view->current->begin_preffix(preffix);
+  auto end = view->current->end_preffix(preffix);
   while (it != end) {
     sea.emplace_back(
         SearchItem(it.get_key(), it.get_value(), 0, 0, it.get_tranc_id()));
@@ -327,7 +398,7 @@ HeapIterator MemTable::iters_preffix(const std::string &preffix,
 
   int table_id = 1;
 
-  for (const auto &table : frozen_tables) {
+  for (const auto &table : view->frozen) {
     auto it_frozen = table->begin_preffix(preffix);
     auto end_frozen = table->end_preffix(preffix);
     while (it_frozen != end_frozen) {
@@ -347,12 +418,11 @@ MemTable::iters_monotony_predicate(
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wambiguous-reversed-operator"
 
-  std::shared_lock<std::shared_mutex> slock1(cur_mtx);
-  std::shared_lock<std::shared_mutex> slock2(frozen_mtx);
+  auto view = get_view();
   std::vector<SearchItem> item_vec;
 
   // 从当前表查询
-  auto cur_result = current_table->iters_monotony_predicate(predicate);
+  auto cur_result = view->current->iters_monotony_predicate(predicate);
   if (cur_result.has_value()) {
     auto [begin, end] = cur_result.value();
     for (auto iter = begin; iter != end; ++iter) {
@@ -363,7 +433,7 @@ MemTable::iters_monotony_predicate(
 
   int table_idx = 1;
   // 从冻结表查询
-  for (auto ft = frozen_tables.begin(); ft != frozen_tables.end(); ft++) {
+  for (auto ft = view->frozen.begin(); ft != view->frozen.end(); ft++) {
     auto table = *ft;
     auto result = table->iters_monotony_predicate(predicate);
     if (result.has_value()) {
@@ -384,4 +454,80 @@ MemTable::iters_monotony_predicate(
 
   return std::make_pair(HeapIterator(item_vec, tranc_id), HeapIterator{});
 }
+
+// *************************** MemTableIterator ***************************
+MemTableIterator::MemTableIterator(std::shared_ptr<SkipList> table,
+                                   uint64_t max_tranc_id)
+    : table_(std::move(table)), max_tranc_id_(max_tranc_id) {
+  if (table_) {
+    it_ = table_->begin();
+    skip_by_tranc_id();
+  }
+}
+
+void MemTableIterator::seek(const std::string &key) {
+  if (!table_) {
+    return;
+  }
+  it_ = table_->lower_bound(key);
+  skip_by_tranc_id();
+}
+
+void MemTableIterator::skip_by_tranc_id() {
+  // 同一 key 的版本按 tranc_id 降序排列, 第一个可见的即为最新的可见版本
+  while (it_.is_valid() && max_tranc_id_ != 0 &&
+         it_.get_tranc_id() > max_tranc_id_) {
+    ++it_;
+  }
+}
+
+BaseIterator &MemTableIterator::operator++() {
+  if (!it_.is_valid()) {
+    return *this;
+  }
+  // 节点由跳表持有, 移动后视图仍然有效
+  auto cur_key = it_.key();
+  ++it_;
+  while (it_.is_valid() && it_.key() == cur_key) {
+    ++it_;
+  }
+  skip_by_tranc_id();
+  return *this;
+}
+
+bool MemTableIterator::operator==(const BaseIterator &other) const {
+  if (other.get_type() != IteratorType::MemTableIterator) {
+    return false;
+  }
+  auto &other2 = dynamic_cast<const MemTableIterator &>(other);
+  if (is_end() || other2.is_end()) {
+    return is_end() && other2.is_end();
+  }
+  return table_ == other2.table_ && key() == other2.key() &&
+         get_tranc_id() == other2.get_tranc_id();
+}
+
+bool MemTableIterator::operator!=(const BaseIterator &other) const {
+  return !(*this == other);
+}
+
+MemTableIterator::value_type MemTableIterator::operator*() const {
+  return *it_;
+}
+
+std::string_view MemTableIterator::key() const { return it_.key(); }
+
+std::string_view MemTableIterator::value() const { return it_.value(); }
+
+IteratorType MemTableIterator::get_type() const {
+  return IteratorType::MemTableIterator;
+}
+
+uint64_t MemTableIterator::get_tranc_id() const {
+  return it_.is_valid() ? it_.get_tranc_id() : 0;
+}
+
+bool MemTableIterator::is_end() const { return !it_.is_valid(); }
+
+bool MemTableIterator::is_valid() const { return it_.is_valid(); }
 } // namespace tiny_lsm
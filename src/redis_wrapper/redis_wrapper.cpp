@@ -1,6 +1,7 @@
 #include "../../include/redis_wrapper/redis_wrapper.h"
 #include "../../include/config/config.h"
 #include "../../include/consts.h"
+#include "../../include/lsm/level_iterator.h"
 #include <algorithm>
 #include <cctype>
 #include <cstddef>
@@ -238,16 +239,12 @@ bool RedisWrapper::expire_set_clean(
     lsm->remove(get_set_key(key));
     lsm->remove(expire_key);
     auto preffix = get_set_key(key);
-    auto result_elem = this->lsm->lsm_iters_monotony_predicate(
-        0, [&preffix](const std::string &elem) {
-          return -elem.compare(0, preffix.size(), preffix);
-        });
-    if (result_elem.has_value()) {
-      auto [elem_begin, elem_end] = result_elem.value();
-      std::vector<std::string> remove_vec;
-      for (; elem_begin != elem_end; ++elem_begin) {
-        remove_vec.push_back(elem_begin->first);
-      }
+    std::vector<std::string> remove_vec;
+    // 扫描迭代器持有读锁, 需要在写入之前释放
+    for (auto it = lsm->scan_prefix(preffix); it.is_valid(); ++it) {
+      remove_vec.emplace_back(it.key());
+    }
+    if (!remove_vec.empty()) {
       lsm->remove_batch(remove_vec);
     }
     return true;
@@ -267,16 +264,12 @@ bool RedisWrapper::expire_sorted_set_clean(
     lsm->remove(get_sorted_set_key(key));
     lsm->remove(expire_key);
     auto preffix = get_sorted_set_key(key);
-    auto result_elem = this->lsm->lsm_iters_monotony_predicate(
-        0, [&preffix](const std::string &elem) {
-          return -elem.compare(0, preffix.size(), preffix);
-        });
-    if (result_elem.has_value()) {
-      auto [elem_begin, elem_end] = result_elem.value();
-      std::vector<std::string> remove_vec;
-      for (; elem_begin != elem_end; ++elem_begin) {
-        remove_vec.push_back(elem_begin->first);
-      }
+    std::vector<std::string> remove_vec;
+    // 扫描迭代器持有读锁, 需要在写入之前释放
+    for (auto it = lsm->scan_prefix(preffix); it.is_valid(); ++it) {
+      remove_vec.emplace_back(it.key());
+    }
+    if (!remove_vec.empty()) {
       lsm->remove_batch(remove_vec);
     }
     return true;
@@ -348,16 +341,12 @@ bool RedisWrapper::expire_list_clean(
     lsm->remove(get_list_key(key));
     lsm->remove(expire_key);
     auto preffix = get_list_key(key);
-    auto result_elem = this->lsm->lsm_iters_monotony_predicate(
-        0, [&preffix](const std::string &elem) {
-          return -elem.compare(0, preffix.size(), preffix);
-        });
-    if (result_elem.has_value()) {
-      auto [elem_begin, elem_end] = result_elem.value();
-      std::vector<std::string> remove_vec;
-      for (; elem_begin != elem_end; ++elem_begin) {
-        remove_vec.push_back(elem_begin->first);
-      }
+    std::vector<std::string> remove_vec;
+    // 扫描迭代器持有读锁, 需要在写入之前释放
+    for (auto it = lsm->scan_prefix(preffix); it.is_valid(); ++it) {
+      remove_vec.emplace_back(it.key());
+    }
+    if (!remove_vec.empty()) {
       lsm->remove_batch(remove_vec);
     }
     return true;
@@ -1452,28 +1441,18 @@ std::string RedisWrapper::redis_zrange(std::vector<std::string> &args) {
 
   std::string search_prefix = meta_key + ":SCORE:";
 
-  auto result_elem = lsm->lsm_iters_monotony_predicate(
-      0, [&search_prefix](const std::string &elem) {
-        return -elem.compare(0, search_prefix.size(), search_prefix);
-      });
-
-  auto it = result_elem->first;
-  auto it_end = result_elem->second;
-
   std::string res_body;
   int count = 0;
   int current_idx = 0;
 
-  // 迭代
-  for (; it != it_end; ++it) {
-    if (it->second.empty())
-      continue; // 跳过墓碑
-
+  // 迭代, 扫描迭代器已经跳过了墓碑
+  for (auto it = lsm->scan_prefix(search_prefix); it.is_valid(); ++it) {
     // 这里其实还是 O(N) 遍历，对于 LSM 这种结构没有 rank 索引很难做到 O(logN)
     if (current_idx >= start && current_idx <= end) {
-      std::string member = it->second;
-      res_body +=
-          "$" + std::to_string(member.size()) + "\r\n" + member + "\r\n";
+      auto member = it.value();
+      res_body += "$" + std::to_string(member.size()) + "\r\n";
+      res_body.append(member);
+      res_body += "\r\n";
       count++;
     }
 
@@ -1562,17 +1541,9 @@ std::string RedisWrapper::redis_zrank(const std::string &key,
   std::string meta_key = get_zset_meta_key(key);
   std::string search_prefix = meta_key + ":SCORE:";
 
-  auto iter_pair =
-      lsm->lsm_iters_monotony_predicate(0, [&](const std::string &k) {
-        return k.compare(0, search_prefix.size(), search_prefix) == 0;
-      });
-
   int rank = 0;
-  for (auto it = iter_pair->first; it != iter_pair->second; ++it) {
-    if (it->second.empty())
-      continue;
-
-    if (it->second == elem) {
+  for (auto it = lsm->scan_prefix(search_prefix); it.is_valid(); ++it) {
+    if (it.value() == elem) {
       return ":" + std::to_string(rank) + "\r\n";
     }
     rank++;
@@ -1734,32 +1705,18 @@ std::string RedisWrapper::redis_smembers(const std::string &key) {
 
   std::string set_meta_key = get_set_key(key);
 
-  auto prefix_predicate = [set_meta_key](const std::string &key) -> int {
-    std::string prefix = set_meta_key;    // 替换为实际前缀
-    return key.find(prefix) == 0 ? 0 : 1; // 以 prefix 开头返回 0，否则 1
-  };
-
-  auto values = lsm->lsm_iters_monotony_predicate(0, prefix_predicate);
-  if (!values)
-    return "*0\r\n";
-
-  int prefix_len = set_meta_key.size() + 1;
+  // 成员的 key 为 "<set_meta_key>_<member>", 只扫描成员, 不会扫到元数据 key
+  // 或者以 set_meta_key 为前缀的其他集合
+  std::string member_prefix = set_meta_key + "_";
   int element_count = 0;
   std::string res;
 
-  for (auto i = values->first; i != values->second; ++i) {
-    // !!! 修复点：防止迭代器扫到元数据 Key 本身
-    // 如果 Key 是 "Set:myset"，长度比 "Set:myset_" 短，substr 会崩溃
-    if (i->first.size() < prefix_len)
-      continue;
-
-    // 过滤掉 Value 为空（墓碑）的记录
-    if (i->second.empty())
-      continue;
-
+  for (auto it = lsm->scan_prefix(member_prefix); it.is_valid(); ++it) {
     ++element_count;
-    auto member = i->first.substr(prefix_len);
-    res += "$" + std::to_string(member.size()) + "\r\n" + member + "\r\n";
+    auto member = it.key().substr(member_prefix.size());
+    res += "$" + std::to_string(member.size()) + "\r\n";
+    res.append(member);
+    res += "\r\n";
   }
 
   return "*" + std::to_string(element_count) + "\r\n" + res;
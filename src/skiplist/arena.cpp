@@ -0,0 +1,55 @@
+#include "../../include/skiplist/arena.h"
+#include <cstdint>
+
+namespace tiny_lsm {
+
+namespace {
+// 跳表节点中对齐要求最高的成员为 uint64_t 和原子指针
+constexpr size_t kAlign = 8;
+static_assert(alignof(uint64_t) <= kAlign &&
+              alignof(std::atomic<void *>) <= kAlign);
+} // namespace
+
+Arena::Arena(size_t block_size) : block_size_(block_size) {}
+
+char *Arena::allocate(size_t bytes) {
+  // 统一按 kAlign 取整, 保证下一次分配的地址仍然对齐
+  bytes = (bytes + kAlign - 1) & ~(kAlign - 1);
+  if (bytes > block_size_ / 4) {
+    // 较大的对象单独分配一块, 避免浪费当前块的剩余空间
+    std::lock_guard<std::mutex> lock(mutex_);
+    return allocate_new_block(bytes)->data.get();
+  }
+
+  while (true) {
+    Block *block = current_.load(std::memory_order_acquire);
+    if (block != nullptr) {
+      size_t offset = block->used.fetch_add(bytes, std::memory_order_relaxed);
+      if (offset + bytes <= block->size) {
+        return block->data.get() + offset;
+      }
+    }
+    // 当前块已满, 只有一个线程负责换块, 其他线程重试
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (current_.load(std::memory_order_relaxed) == block) {
+      current_.store(allocate_new_block(block_size_),
+                     std::memory_order_release);
+    }
+  }
+}
+
+size_t Arena::memory_usage() const {
+  return memory_usage_.load(std::memory_order_relaxed);
+}
+
+Arena::Block *Arena::allocate_new_block(size_t block_bytes) {
+  auto block = std::make_unique<Block>();
+  // new char[] 返回的地址满足 max_align_t 的对齐要求
+  block->data.reset(new char[block_bytes]);
+  block->size = block_bytes;
+  memory_usage_.fetch_add(block_bytes + sizeof(Block),
+                          std::memory_order_relaxed);
+  blocks_.push_back(std::move(block));
+  return blocks_.back().get();
+}
+} // namespace tiny_lsm
@@ -15,7 +15,7 @@ BaseIterator &SkipListIterator::operator++() {
   // TODO: Lab1.2 任务：实现SkipListIterator的++操作符
   if (this->is_end() || !this->is_valid())
     return *this;
-  current = current->forward_[0];
+  current = current->next(0);
 
   return *this;
 }
@@ -28,7 +28,7 @@ bool SkipListIterator::operator==(const BaseIterator &other) const {
     else
       return false;
   }
-  if (current->key_ != (*other).first || current->value_ != (*other).second)
+  if (current->key() != (*other).first || current->value() != (*other).second)
     return false;
   return true;
 }
@@ -41,7 +41,7 @@ bool SkipListIterator::operator!=(const BaseIterator &other) const {
     else
       return true;
   }
-  if (current->key_ != (*other).first || current->value_ != (*other).second)
+  if (current->key() != (*other).first || current->value() != (*other).second)
     return true;
   return false;
 }
@@ -50,7 +50,7 @@ SkipListIterator::value_type SkipListIterator::operator*() const {
   // TODO: Lab1.2 任务：实现SkipListIterator的*操作符
   if (!this->is_valid())
     return {"", ""};
-  return {current->key_, current->value_};
+  return {std::string(current->key()), std::string(current->value())};
 }
 
 IteratorType SkipListIterator::get_type() const {
@@ -62,21 +62,74 @@ IteratorType SkipListIterator::get_type() const {
 }
 
 bool SkipListIterator::is_valid() const {
-  return current && !current->key_.empty();
+  return current && !current->key().empty();
 }
 bool SkipListIterator::is_end() const { return current == nullptr; }
 
-std::string SkipListIterator::get_key() const { return current->key_; }
-std::string SkipListIterator::get_value() const { return current->value_; }
+std::string_view SkipListIterator::key() const {
+  if (!current) {
+    return {};
+  }
+  return current->key();
+}
+
+std::string_view SkipListIterator::value() const {
+  if (!current) {
+    return {};
+  }
+  return current->value();
+}
+
+std::string SkipListIterator::get_key() const {
+  return std::string(current->key());
+}
+std::string SkipListIterator::get_value() const {
+  return std::string(current->value());
+}
 uint64_t SkipListIterator::get_tranc_id() const { return current->tranc_id_; }
 
+// ************************ SkipListNode ************************
+SkipListNode *SkipListNode::create(Arena &arena, std::string_view key,
+                                   std::string_view value, int level,
+                                   uint64_t tranc_id) {
+  // 节点, 指针数组, key 和 value 记录在一次分配中连续存放
+  size_t tower_bytes = sizeof(std::atomic<SkipListNode *>) * (level - 1);
+  size_t value_bytes = sizeof(uint32_t) + value.size();
+  char *mem = arena.allocate(sizeof(SkipListNode) + tower_bytes +
+                             key.size() + value_bytes);
+
+  auto node = reinterpret_cast<SkipListNode *>(mem);
+  node->tranc_id_ = tranc_id;
+  node->key_size_ = static_cast<uint32_t>(key.size());
+  node->height_ = level;
+  for (int i = 0; i < level; ++i) {
+    new (&node->forward_[i]) std::atomic<SkipListNode *>(nullptr);
+  }
+  char *key_ptr = reinterpret_cast<char *>(node->forward_ + level);
+  std::memcpy(key_ptr, key.data(), key.size());
+
+  char *value_ptr = key_ptr + key.size();
+  uint32_t value_size = static_cast<uint32_t>(value.size());
+  std::memcpy(value_ptr, &value_size, sizeof(uint32_t));
+  std::memcpy(value_ptr + sizeof(uint32_t), value.data(), value.size());
+  new (&node->value_) std::atomic<const char *>(value_ptr);
+  return node;
+}
+
+const char *SkipListNode::create_value(Arena &arena, std::string_view value) {
+  char *record = arena.allocate(sizeof(uint32_t) + value.size());
+  uint32_t value_size = static_cast<uint32_t>(value.size());
+  std::memcpy(record, &value_size, sizeof(uint32_t));
+  std::memcpy(record + sizeof(uint32_t), value.data(), value.size());
+  return record;
+}
+
 // ************************ SkipList ************************
 // 构造函数
-SkipList::SkipList(int max_lvl) : max_level(max_lvl), current_level(1) {
-  head = std::make_shared<SkipListNode>("", "", max_level, 0);
-  dis_01 = std::uniform_int_distribution<>(0, 1);
-  dis_level = std::uniform_int_distribution<>(0, (1 << max_lvl) - 1);
-  gen = std::mt19937(std::random_device()());
+SkipList::SkipList(int max_lvl)
+    : arena_(std::make_shared<Arena>()), max_level(max_lvl),
+      current_level(1) {
+  head = SkipListNode::create(head_arena_, "", "", max_level, 0);
 }
 
 int SkipList::random_level() {
@@ -85,101 +138,88 @@ int SkipList::random_level() {
   // ? - 确保层数分布为：第1层100%，第2层50%，第3层25%，以此类推
   // ? - 层数范围限制在[1, max_level]之间，避免浪费内存
   // TODO: Lab1.1 任务：插入时随机为这一次操作确定其最高连接的链表层数
+  // 多个线程并发插入, 每个线程使用自己的随机数生成器
+  thread_local std::mt19937 gen(std::random_device{}());
   int level = 1;
-  while (dis_01(gen) == 0 && level < this->max_level) {
+  while ((gen() & 1) == 0 && level < this->max_level) {
     ++level;
   }
   return level;
 }
 
+void SkipList::find_splice_for_level(const std::string &key,
+                                     uint64_t tranc_id, SkipListNode *before,
+                                     int level, SkipListNode *&prev,
+                                     SkipListNode *&next) const {
+  while (true) {
+    auto after = before->next(level);
+    if (after == nullptr || !after->less(key, tranc_id)) {
+      prev = before;
+      next = after;
+      return;
+    }
+    before = after;
+  }
+}
+
 // 插入或更新键值对
+// 节点自底向上逐层通过 CAS 链接, 第 0 层链接成功即对读取者可见;
+// CAS 失败说明有并发插入的相邻节点, 从原来的前驱开始重新查找该层的位置
 void SkipList::put(const std::string &key, const std::string &value,
                    uint64_t tranc_id) {
   spdlog::trace("SkipList--put({}, {}, {})", key, value, tranc_id);
-  std::vector<std::shared_ptr<SkipListNode>> update(max_level, nullptr);
-
-  // 先创建一个新节点
-  int new_level = std::max(random_level(), current_level);
-  auto new_node =
-      std::make_shared<SkipListNode>(key, value, new_level, tranc_id);
-
-  // std::unique_lock<std::shared_mutex> lock(rw_mutex);
-  auto current = head;
+  std::vector<SkipListNode *> prev(max_level, nullptr);
+  std::vector<SkipListNode *> next(max_level, nullptr);
+
+  int new_level = random_level();
+  int cur_level = current_level.load(std::memory_order_relaxed);
+  while (new_level > cur_level &&
+         !current_level.compare_exchange_weak(cur_level, new_level,
+                                              std::memory_order_relaxed)) {
+  }
+  cur_level = std::max(cur_level, new_level);
 
   // 从最高层开始查找插入位置
-  for (int i = current_level - 1; i >= 0; --i) {
-    while (current->forward_[i] && *current->forward_[i] < *new_node) {
-      current = current->forward_[i];
-    }
-    spdlog::trace("SkipList--put({}, {}, {}), level{} needs updating", key,
-                  value, tranc_id, i);
-
-    update[i] = current;
+  auto before = head;
+  for (int i = cur_level - 1; i >= 0; --i) {
+    find_splice_for_level(key, tranc_id, before, i, prev[i], next[i]);
+    before = prev[i];
   }
 
-  // 移动到最底层
-  current = current->forward_[0];
-
-  if (current && current->key_ == key && current->tranc_id_ == tranc_id) {
+  auto update_value = [&](SkipListNode *node) {
     // 若 key 存在且 tranc_id 相同，更新 value
-    size_bytes += value.size() - current->value_.size();
-    current->value_ = value;
-    current->tranc_id_ = tranc_id;
+    // 旧的 value 记录可能正在被读取, 保留在 arena 中
+    node->value_.store(SkipListNode::create_value(*arena_, value),
+                       std::memory_order_release);
 
     spdlog::trace("SkipList--put({}, {}, {}), key and tranc_id_ is the same, "
                   "only update value to {}",
                   key, value, tranc_id, value);
+  };
 
+  if (next[0] && next[0]->key() == key && next[0]->tranc_id_ == tranc_id) {
+    update_value(next[0]);
     return;
   }
 
   // 如果key不存在，创建新节点
-  // ! 默认新的 tranc_id 一定比当前的大, 由上层保证
-  if (new_level > current_level) {
-    for (int i = current_level; i < new_level; ++i) {
-      update[i] = head;
-
-      spdlog::trace("SkipList--put({}, {}, {}), update level{} to head", key,
-                    value, tranc_id, i);
-    }
-  }
-
-  // 生成一个随机数，用于决定是否在每一层更新节点
-  int random_bits = dis_level(gen);
-
-  size_bytes += key.size() + value.size() + sizeof(uint64_t);
-
-  // 更新各层的指针
+  auto new_node =
+      SkipListNode::create(*arena_, key, value, new_level, tranc_id);
   for (int i = 0; i < new_level; ++i) {
-    bool need_update = false;
-    if (i == 0 || (new_level > current_level) || (random_bits & (1 << i))) {
-      // 按照如下顺序判断是否进行更新
-      // 1. 第0层总是更新
-      // 2. 如果需要创建新的层级, 这个节点需要再之前所有的层级上都更新
-      // 3. 否则, 根据随机数的位数按照50%的概率更新
-      need_update = true;
-    }
-
-    if (need_update) {
-      new_node->forward_[i] = update[i]->forward_[i]; // 可能为nullptr
-      if (new_node->forward_[i]) {
-        new_node->forward_[i]->set_backward(i, new_node);
+    while (true) {
+      new_node->forward_[i].store(next[i], std::memory_order_relaxed);
+      if (prev[i]->cas_next(i, next[i], new_node)) {
+        break;
+      }
+      find_splice_for_level(key, tranc_id, prev[i], i, prev[i], next[i]);
+      if (i == 0 && next[0] && next[0]->key() == key &&
+          next[0]->tranc_id_ == tranc_id) {
+        // 相同的 (key, tranc_id) 被并发插入, 新节点尚未发布, 转为更新 value
+        update_value(next[0]);
+        return;
       }
-      update[i]->forward_[i] = new_node;
-      new_node->set_backward(i, update[i]);
-    } else {
-      // 如果不更新当前层，之后更高的层级都不更新
-      break;
     }
   }
-
-  current_level = new_level;
-
-  // TODO: Lab1.1  任务：实现插入或更新键值对
-  // ? Hint: 你需要保证不同`Level`的步长从底层到高层逐渐增加
-  // ? 你可能需要使用到`random_level`函数以确定层数, 其注释中为你提供一种思路
-  // ? tranc_id 为事务id, 现在你不需要关注它, 直接将其传递到 SkipListNode
-  // 的构造函数中即可
 }
 
 // 查找键值对
@@ -191,24 +231,26 @@ SkipListIterator SkipList::get(const std::string &key, uint64_t tranc_id) {
   // ? 日志为输出到你执行二进制所在目录下的log文件夹
   auto current = head;
   // 从最高层开始查找
-  for (int i = current_level - 1; i >= 0; --i) {
-    while (current->forward_[i] && current->forward_[i]->key_ < key) {
-      current = current->forward_[i];
+  for (int i = current_level.load(std::memory_order_relaxed) - 1; i >= 0;
+       --i) {
+    for (auto next = current->next(i); next && next->key() < key;
+         next = current->next(i)) {
+      current = next;
     }
   }
   // 移动到最底层
-  current = current->forward_[0];
+  current = current->next(0);
 
   // 统一处理事务过滤：
   // - tranc_id == 0: 返回最新版本（第一个遇到的相同 key）
   // - tranc_id != 0: 返回第一个满足 current->tranc_id_ <= tranc_id
   // 的版本（跳过不可见的新版本）
-  while (current && current->key_ == key) {
+  while (current && current->key() == key) {
     if (tranc_id == 0 || current->tranc_id_ <= tranc_id) {
-      return SkipListIterator{current};
+      return SkipListIterator{current, arena_};
     }
     // 否则该版本对当前事务不可见，继续查找更旧的版本
-    current = current->forward_[0];
+    current = current->next(0);
   }
 
   // 未找到返回空
@@ -219,110 +261,54 @@ SkipListIterator SkipList::get(const std::string &key, uint64_t tranc_id) {
 // 删除键值对
 // ! 这里的 remove 是跳表本身真实的 remove,  lsm 应该使用 put 空值表示删除,
 // ! 这里只是为了实现完整的 SkipList 不会真正被上层调用
+// ! 节点只是从链表中摘除, 内存随 arena 统一释放
 // 向后兼容的无事务版本，等价于 remove(key, 0)
 void SkipList::remove(const std::string &key) { remove(key, 0); }
 
 // 事务感知的删除：仅删除与 tranc_id 精确匹配的版本（tranc_id != 0），
 // 或者在 tranc_id == 0 时删除最新版本（与以前行为一致）。
 void SkipList::remove(const std::string &key, uint64_t tranc_id) {
-  std::vector<std::shared_ptr<SkipListNode>> update(max_level, nullptr);
-  auto current = head;
+  int cur_level = current_level.load(std::memory_order_relaxed);
+  std::vector<SkipListNode *> update(max_level, nullptr);
 
-  // 根据是否提供 tranc_id 选择不同的前驱搜索条件。
   // 节点排序规则：按 key 升序；当 key 相等时，tranc_id 较大者排在前面。
-  for (int i = current_level - 1; i >= 0; --i) {
-    while (true) {
-      auto f = current->forward_[i];
-      if (!f)
-        break;
-      if (f->key_ < key) {
-        current = f;
-        continue;
-      }
-      if (f->key_ == key) {
-        if (tranc_id == 0) {
-          // 不使用事务 id：我们只需定位到第一个 key（最新版本）之前的位置
-          break;
-        } else {
-          // 使用事务 id：依据跳表的排序规则，向前移动直到遇到第一个不小于目标
-          // (key,tranc_id) 排序中 key 相等时 tranc_id 较大者在前，所以当
-          // f->tranc_id_ > tranc_id 时，f < target
-          if (f->tranc_id_ > tranc_id) {
-            current = f;
-            continue;
-          }
-        }
-      }
-      break;
+  // tranc_id == 0 时定位到该 key 的最新版本之前, 否则定位到
+  // (key, tranc_id) 之前
+  auto target_less = [&](SkipListNode *node) {
+    if (node->key() != key) {
+      return node->key() < key;
+    }
+    return tranc_id != 0 && node->tranc_id_ > tranc_id;
+  };
+  auto current = head;
+  for (int i = cur_level - 1; i >= 0; --i) {
+    for (auto next = current->next(i); next && target_less(next);
+         next = current->next(i)) {
+      current = next;
     }
     update[i] = current;
   }
 
-  current = update[0]->forward_[0];
+  current = update[0]->next(0);
 
   // 如果没有找到 key，直接返回
-  if (!current || current->key_ != key) {
+  if (!current || current->key() != key ||
+      (tranc_id != 0 && current->tranc_id_ != tranc_id)) {
     return;
   }
 
-  // tranc_id == 0 表示删除最新版本（current 即为最新版本）
-  if (tranc_id != 0 && current->tranc_id_ != tranc_id) {
-    // 如果 current 不是目标事务 id，则尝试向后查找同 key 的节点（更旧的版本）
-    auto cursor = current->forward_[0];
-    std::shared_ptr<SkipListNode> target = nullptr;
-    while (cursor && cursor->key_ == key) {
-      if (cursor->tranc_id_ == tranc_id) {
-        target = cursor;
-        break;
-      }
-      cursor = cursor->forward_[0];
-    }
-
-    if (!target) {
-      // 没有找到匹配的事务版本，什么也不做
-      return;
-    }
-
-    // 为了删除 target，需要重建 update 链以指向 target 的前驱
-    current = head;
-    for (int i = current_level - 1; i >= 0; --i) {
-      while (true) {
-        auto f = current->forward_[i];
-        if (!f)
-          break;
-        // 向前移动直到 f 指向 target 或在 target 之前
-        if (f.get() != target.get() &&
-            (f->key_ < key || (f->key_ == key && f->tranc_id_ > tranc_id))) {
-          current = f;
-          continue;
-        }
-        break;
-      }
-      update[i] = current;
-    }
-
-    current = target; // 将要删除的节点
-  }
-
-  // 执行删除：更新 forward 指针与 backward 链
-  for (int i = 0; i < current_level; ++i) {
-    if (update[i]->forward_[i] != current) {
+  // 执行删除：更新 forward 指针
+  for (int i = 0; i < current->height_; ++i) {
+    if (update[i]->next(i) != current) {
       break;
     }
-    update[i]->forward_[i] = current->forward_[i];
-  }
-  for (int i = 0; i < current->backward_.size() && i < current_level; ++i) {
-    if (current->forward_[i]) {
-      current->forward_[i]->set_backward(i, update[i]);
-    }
+    update[i]->set_next(i, current->next(i));
   }
 
-  size_bytes -=
-      (current->key_.size() + current->value_.size() + sizeof(uint64_t));
-
-  while (current_level > 1 && head->forward_[current_level - 1] == nullptr) {
-    current_level--;
+  while (cur_level > 1 && head->next(cur_level - 1) == nullptr) {
+    cur_level--;
   }
+  current_level.store(cur_level, std::memory_order_relaxed);
 }
 
 // 刷盘时可以直接遍历最底层链表
@@ -331,10 +317,9 @@ std::vector<std::tuple<std::string, std::string, uint64_t>> SkipList::flush() {
   spdlog::debug("SkipList--flush(): Starting to flush skiplist data");
 
   std::vector<std::tuple<std::string, std::string, uint64_t>> data;
-  auto node = head->forward_[0];
-  while (node) {
-    data.emplace_back(node->key_, node->value_, node->tranc_id_);
-    node = node->forward_[0];
+  for (auto node = head->next(0); node; node = node->next(0)) {
+    data.emplace_back(std::string(node->key()), std::string(node->value()),
+                      node->tranc_id_);
   }
 
   spdlog::debug("SkipList--flush(): Flushed {} entries", data.size());
@@ -342,57 +327,72 @@ std::vector<std::tuple<std::string, std::string, uint64_t>> SkipList::flush() {
   return data;
 }
 
-size_t SkipList::get_size() {
-  // std::shared_lock<std::shared_mutex> slock(rw_mutex);
-  return size_bytes;
-}
+size_t SkipList::get_size() { return arena_->memory_usage(); }
 
 // 清空跳表，释放内存
+// 已经创建的迭代器仍持有旧节点的所有权, 不受影响
 void SkipList::clear() {
-  // std::unique_lock<std::shared_mutex> lock(rw_mutex);
-  head = std::make_shared<SkipListNode>("", "", max_level, 0);
-  size_bytes = 0;
+  arena_ = std::make_shared<Arena>();
+  for (int i = 0; i < max_level; ++i) {
+    head->set_next(i, nullptr);
+  }
+  current_level.store(1, std::memory_order_relaxed);
 }
 
 SkipListIterator SkipList::begin() {
-  // return SkipListIterator(head->forward[0], rw_mutex);
-  return SkipListIterator(head->forward_[0]);
+  return SkipListIterator(head->next(0), arena_);
 }
 
 SkipListIterator SkipList::end() {
   return SkipListIterator(); // 使用空构造函数
 }
 
+SkipListIterator SkipList::lower_bound(const std::string &key) {
+  auto current = head;
+  for (int i = current_level.load(std::memory_order_relaxed) - 1; i >= 0;
+       --i) {
+    for (auto next = current->next(i); next && next->key() < key;
+         next = current->next(i)) {
+      current = next;
+    }
+  }
+  return SkipListIterator{current->next(0), arena_};
+}
+
 // 找到前缀的起始位置
 // 返回第一个前缀匹配或者大于前缀的迭代器
 SkipListIterator SkipList::begin_preffix(const std::string &preffix) {
   // TODO: Lab1.3 任务：实现前缀查询的起始位置
   auto current = head;
-  for (int i = current_level - 1; i >= 0; --i) {
-    while (current->forward_[i] &&
-           current->forward_[i]->key_.compare(0, preffix.size(), preffix, 0,
-                                              preffix.size()) < 0) {
-      current = current->forward_[i];
+  for (int i = current_level.load(std::memory_order_relaxed) - 1; i >= 0;
+       --i) {
+    for (auto next = current->next(i);
+         next && next->key().compare(0, preffix.size(), preffix, 0,
+                                    preffix.size()) < 0;
+         next = current->next(i)) {
+      current = next;
     }
   }
-  current = current->forward_[0];
+  current = current->next(0);
 
-  return SkipListIterator{current};
+  return SkipListIterator{current, arena_};
 }
 
 // 找到前缀的终结位置
 SkipListIterator SkipList::end_preffix(const std::string &prefix) {
   // TODO: Lab1.3 任务：实现前缀查询的终结位置
   auto current = head;
-  for (int i = current_level - 1; i >= 0; --i) {
-    while (current->forward_[i] &&
-           current->forward_[i]->key_.compare(0, prefix.size(), prefix, 0,
-                                              prefix.size()) <= 0) {
-      current = current->forward_[i];
+  for (int i = current_level.load(std::memory_order_relaxed) - 1; i >= 0;
+       --i) {
+    for (auto next = current->next(i);
+         next && next->key().compare(0, prefix.size(), prefix, 0,
+                                    prefix.size()) <= 0;
+         next = current->next(i)) {
+      current = next;
     }
   }
-  current = current->forward_[0];
-  return SkipListIterator{current};
+  current = current->next(0);
+  return SkipListIterator{current, arena_};
 }
 
 // ? 这里单调谓词的含义是, 整个数据库只会有一段连续区间满足此谓词
@@ -409,112 +409,51 @@ std::optional<std::pair<SkipListIterator, SkipListIterator>>
 SkipList::iters_monotony_predicate(
     std::function<int(const std::string &)> predicate) {
   // TODO: Lab1.3 任务：实现谓词查询的起始位置
-  auto current = head;
-  bool find1 = false;
+  // 两次自顶向下的查找分别定位区间的两端, 不需要反向指针
+  int cur_level = current_level.load(std::memory_order_relaxed);
 
-  // 从最高层开始查找第一个满足谓词的位置
-  for (int i = current_level - 1; i >= 0; --i) {
-    while (!find1) {
-      auto forward_i = current->forward_[i];
-      if (forward_i == nullptr) {
-        break;
-      }
-      auto direction = predicate(forward_i->key_);
-      if (direction == 0) {
-        // 找到满足谓词的位置
-        find1 = true;
-        current = forward_i;
-        break;
-      } else if (direction < 0) {
-        // 不满足谓词，且方向错误（位于目标区间右侧）
-        // 需要尝试更小的步长(层级)
-        break;
-      } else {
-        // 不满足谓词，但方向正确（位于目标区间左侧）
-        current = forward_i;
-      }
+  // 1. 找到最后一个位于区间左侧的节点, 其后继即为第一个满足谓词的节点
+  auto current = head;
+  for (int i = cur_level - 1; i >= 0; --i) {
+    for (auto next = current->next(i);
+         next && predicate(std::string(next->key())) > 0;
+         next = current->next(i)) {
+      current = next;
     }
   }
-
-  if (!find1) {
+  auto first = current->next(0);
+  if (first == nullptr || predicate(std::string(first->key())) != 0) {
     // 没有找到满足谓词的位置
     return std::nullopt;
   }
 
-  // 记住当前位置
-  auto current2 = current;
-
-  // current 已经满足谓词，但有可能中途跳过了节点，需要向前检查
-  for (int i = current->backward_.size() - 1; i >= 0; --i) {
-    while (true) {
-      if (current->backward_[i].lock() == nullptr ||
-          current->backward_[i].lock() == head) {
-        // 当前层没有前向节点，或前向节点指向头结点
-        break;
-      }
-      auto direction = predicate(current->backward_[i].lock()->key_);
-      if (direction == 0) {
-        // 前一个位置满足谓词，继续判断
-        current = current->backward_[i].lock();
-        continue;
-      } else if (direction > 0) {
-        // 前一个位置不满足谓词
-        // 需要尝试更小的步长(层级)
-        break;
-      } else {
-        // 因为当前位置满足了谓词，前一个位置不可能返回-1
-        // 这种情况属于跳表实现错误
-        std::cerr << "SkipList::iters_monotony_predicate: invalid direction"
-                  << std::endl;
-        throw std::runtime_error("iters_monotony_predicate: invalid direction");
-      }
+  // 2. 找到最后一个满足谓词的节点, 其后继即为区间的结束位置
+  current = first;
+  for (int i = cur_level - 1; i >= 0; --i) {
+    if (i >= current->height_) {
+      continue;
     }
-  }
-
-  // 找到第一个满足谓词的节点
-  SkipListIterator begin_iter(current);
-
-  // 找到最后一个满足谓词的节点
-  for (int i = current2->forward_.size() - 1; i >= 0; --i) {
-    while (true) {
-      if (current2->forward_[i] == nullptr) {
-        // 当前层没有后向节点
-        break;
-      }
-      auto direction = predicate(current2->forward_[i]->key_);
-      if (direction == 0) {
-        // 后一个位置满足谓词，继续判断
-        current2 = current2->forward_[i];
-        continue;
-      } else if (direction < 0) {
-        // 后一个位置不满足谓词
-        // 需要尝试更小的步长(层级)
-        break;
-      } else {
-        // 因为当前位置满足了谓词，后一个位置不可能返回1
-        // 这种情况属于跳表实现错误
-        std::cerr << "SkipList::iters_monotony_predicate: invalid direction"
-                  << std::endl;
-        throw std::runtime_error("iters_monotony_predicate: invalid direction");
-      }
+    for (auto next = current->next(i);
+         next && predicate(std::string(next->key())) == 0;
+         next = current->next(i)) {
+      current = next;
     }
   }
 
-  SkipListIterator end_iter(current2);
   // 转化为开区间 [begin, end)
-  ++end_iter;
-
-  return std::make_optional(std::make_pair(begin_iter, end_iter));
+  return std::make_optional(
+      std::make_pair(SkipListIterator{first, arena_},
+                     SkipListIterator{current->next(0), arena_}));
 }
 
 // ? 打印跳表, 你可以在出错时调用此函数进行调试
 void SkipList::print_skiplist() {
   for (int level = 0; level < current_level; level++) {
     std::cout << "Level " << level << ": ";
-    auto current = head->forward_[level];
+    auto current = head->next(level);
     while (current) {
-      std::cout << current->key_;
-      current = current->forward_[level];
+      std::cout << current->key();
+      current = current->next(level);
       if (current) {
         std::cout << " -> ";
       }
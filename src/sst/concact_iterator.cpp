@@ -1,4 +1,6 @@
 #include "../../include/sst/concact_iterator.h"
+#include <algorithm>
+#include <utility>
 
 namespace tiny_lsm {
 
@@ -11,6 +13,32 @@ ConcactIterator::ConcactIterator(std::vector<std::shared_ptr<SST>> ssts,
   }
 }
 
+ConcactIterator::ConcactIterator(std::vector<std::shared_ptr<SST>> ssts,
+                                 uint64_t tranc_id, const std::string &lower)
+    : cur_iter(nullptr, tranc_id), cur_idx(0), ssts(std::move(ssts)),
+      max_tranc_id_(tranc_id) {
+  // 二分跳过 last_key 小于 lower 的 sst
+  auto it = std::partition_point(
+      this->ssts.begin(), this->ssts.end(),
+      [&lower](const std::shared_ptr<SST> &sst) {
+        return sst->get_last_key() < lower;
+      });
+  cur_idx = it - this->ssts.begin();
+  if (cur_idx >= this->ssts.size()) {
+    return;
+  }
+  cur_iter = this->ssts[cur_idx]->lower_bound(lower, max_tranc_id_);
+  // 当前 sst 中没有可见的条目时移动到下一个 sst
+  while (!is_valid() && cur_idx + 1 < this->ssts.size()) {
+    cur_idx++;
+    cur_iter.continue_with(this->ssts[cur_idx]);
+  }
+}
+
+void ConcactIterator::set_readahead(size_t blocks, bool fill_cache) {
+  cur_iter.set_readahead(blocks, fill_cache);
+}
+
 BaseIterator &ConcactIterator::operator++() {
   if (is_end()) {
     return *this; // 如果已经是结束状态，直接返回
@@ -21,7 +49,8 @@ BaseIterator &ConcactIterator::operator++() {
   while ((cur_iter.is_end() || !cur_iter.is_valid()) && cur_idx < ssts.size()) {
     cur_idx++;
     if (cur_idx < ssts.size()) {
-      cur_iter = ssts[cur_idx]->begin(max_tranc_id_);
+      // 沿用预读状态, 跨 sst 的顺序遍历同样可以持续扩大预读窗口
+      cur_iter.continue_with(ssts[cur_idx]);
     } else {
       cur_iter = SstIterator(nullptr, max_tranc_id_);
       break;
@@ -50,7 +79,9 @@ IteratorType ConcactIterator::get_type() const {
   return IteratorType::ConcactIterator;
 }
 
-uint64_t ConcactIterator::get_tranc_id() const { return max_tranc_id_; }
+uint64_t ConcactIterator::get_tranc_id() const {
+  return cur_iter.get_tranc_id();
+}
 
 bool ConcactIterator::is_end() const {
   return cur_iter.is_end() || !cur_iter.is_valid();
@@ -64,7 +95,7 @@ ConcactIterator::pointer ConcactIterator::operator->() const {
   return cur_iter.operator->();
 }
 
-std::string ConcactIterator::key() { return cur_iter.key(); }
+std::string_view ConcactIterator::key() const { return cur_iter.key(); }
 
-std::string ConcactIterator::value() { return cur_iter.value(); }
+std::string_view ConcactIterator::value() const { return cur_iter.value(); }
 } // namespace tiny_lsm
@@ -2,6 +2,7 @@
 #include "../../include/config/config.h"
 #include "../../include/consts.h"
 #include "../../include/sst/sst_iterator.h"
+#include "../../include/utils/async_reader.h"
 #include <algorithm>
 #include <cstddef>
 #include <cstdint>
@@ -37,6 +38,18 @@ std::shared_ptr<SST> SST::open(size_t sst_id, FileObj file,
     throw std::runtime_error("Invalid SST file: too small");
   }
 
+  // 分区格式的 footer 末尾多出 8 字节的魔数, 去掉后与普通格式相同
+  if (file_size >= sizeof(uint64_t) * 3 + sizeof(uint32_t) * 2) {
+    auto magic_bytes =
+        sst->file.read_to_slice(file_size - sizeof(uint64_t), sizeof(uint64_t));
+    uint64_t magic;
+    memcpy(&magic, magic_bytes.data(), sizeof(uint64_t));
+    if (magic == SST_PARTITIONED_MAGIC) {
+      sst->partitioned_ = true;
+      file_size -= sizeof(uint64_t);
+    }
+  }
+
   // 0. 读取最大和最小的事务id
   auto max_tranc_id =
       sst->file.read_to_slice(file_size - sizeof(uint64_t), sizeof(uint64_t));
@@ -58,9 +71,27 @@ std::shared_ptr<SST> SST::open(size_t sst_id, FileObj file,
       sizeof(uint32_t));
   memcpy(&sst->meta_block_offset, meta_offset_bytes.data(), sizeof(uint32_t));
 
+  // footer 之前可能附加了前缀过滤器
+  size_t sections_end = sst->read_prefix_filter(
+      file_size - sizeof(uint64_t) * 2 - sizeof(uint32_t) * 2);
+
+  if (sst->partitioned_) {
+    // 分区格式只读取顶层索引, 分区在使用时按需加载
+    uint32_t index_size = sections_end - sst->bloom_offset;
+    auto index_bytes = sst->file.read_to_slice(sst->bloom_offset, index_size);
+    uint32_t num_blocks = 0;
+    sst->partitions_ =
+        PartitionHandle::decode_partitions(index_bytes, num_blocks);
+    sst->num_blocks_ = num_blocks;
+    if (!sst->partitions_.empty()) {
+      sst->first_key = sst->partitions_.front().first_key;
+      sst->last_key = sst->partitions_.back().last_key;
+    }
+    return sst;
+  }
+
   // 2. 读取 bloom filter
-  if (sst->bloom_offset + 2 * sizeof(uint32_t) + 2 * sizeof(uint64_t) <
-      file_size) {
+  if (sst->bloom_offset < sections_end) {
     //     如果没有布隆过滤器，SSTBuilder 会将 bloom_offset
     //     设置为元数据块的结束位置。此时，bloom_offset 加上 Footer
     //     的大小（24字节）应该正好等于文件总大小 file_size。
@@ -68,8 +99,7 @@ std::shared_ptr<SST> SST::open(size_t sst_id, FileObj file,
     // Footer 的大小（24字节）才等于 file_size。因此，bloom_offset + Footer
     // 大小必然会小于 file_size。 布隆过滤器偏移量（此处未被实际复制） +
     // 2*uint32_t 的大小小于文件大小 表示存在布隆过滤器
-    uint32_t bloom_size = file_size - sizeof(uint64_t) * 2 - sst->bloom_offset -
-                          sizeof(uint32_t) * 2;
+    uint32_t bloom_size = sections_end - sst->bloom_offset;
     auto bloom_bytes = sst->file.read_to_slice(sst->bloom_offset, bloom_size);
 
     auto bloom = BloomFilter::decode(bloom_bytes);
@@ -79,15 +109,46 @@ std::shared_ptr<SST> SST::open(size_t sst_id, FileObj file,
   // 3. 读取并解码元数据块
   uint32_t meta_size = sst->bloom_offset - sst->meta_block_offset;
   auto meta_bytes = sst->file.read_to_slice(sst->meta_block_offset, meta_size);
-  sst->meta_entries = BlockMeta::decode_meta_from_slice(meta_bytes);
+  // 4. 设置首尾key并构建栅栏索引
+  sst->init_index(BlockMeta::decode_meta_from_slice(meta_bytes));
+
+  return sst;
+}
 
-  // 4. 设置首尾key
-  if (!sst->meta_entries.empty()) {
-    sst->first_key = sst->meta_entries.front().first_key;
-    sst->last_key = sst->meta_entries.back().last_key;
+void SST::init_index(std::vector<BlockMeta> metas) {
+  if (metas.empty()) {
+    return;
+  }
+  first_key = metas.front().first_key;
+  last_key = metas.back().last_key;
+  block_offsets_.reserve(metas.size());
+  for (const auto &meta : metas) {
+    block_offsets_.push_back(static_cast<uint32_t>(meta.offset));
   }
+  fence_index = FenceIndex(metas);
+  if (fence_index.size() == 0) {
+    // block 之间不是严格有序的, 定位 block 时需要逐个比较首尾 key
+    meta_entries = std::move(metas);
+  }
+}
 
-  return sst;
+std::shared_ptr<IndexPartition> SST::load_meta_entries() {
+  // 非分区格式的 sst 没有分区, 完整元数据在缓存中使用分区 0 的编号
+  if (block_cache != nullptr) {
+    auto cached = block_cache->get_meta(sst_id, 0);
+    if (cached != nullptr) {
+      return std::static_pointer_cast<IndexPartition>(cached);
+    }
+  }
+
+  auto bytes = file.read_to_slice(meta_block_offset,
+                                  bloom_offset - meta_block_offset);
+  auto metas = std::make_shared<IndexPartition>(
+      BlockMeta::decode_meta_from_slice(bytes));
+  if (block_cache != nullptr) {
+    block_cache->put_meta(sst_id, 0, metas);
+  }
+  return metas;
 }
 
 void SST::del_sst() { file.del_file(); }
@@ -108,7 +169,7 @@ std::shared_ptr<SST> SST::create_sst_with_meta_only(
 
 std::shared_ptr<Block> SST::read_block(size_t block_idx) {
   // TODO: Lab 3.6 根据 block 的 id 读取一个 `Block`
-  if (block_idx >= meta_entries.size()) {
+  if (block_idx >= num_blocks()) {
     throw std::out_of_range("Block index out of range");
   }
 
@@ -122,20 +183,18 @@ std::shared_ptr<Block> SST::read_block(size_t block_idx) {
     throw std::runtime_error("Block cache not set");
   }
 
-  const auto &meta = meta_entries[block_idx];
-  size_t block_size;
+  auto [block_offset, block_size] = block_location(block_idx);
 
-  // 计算block大小
-  if (block_idx == meta_entries.size() - 1) {
-    block_size = meta_block_offset - meta.offset;
+  // 读取block数据, mmap 模式下 block 直接引用映射的内存, 不再拷贝
+  std::shared_ptr<Block> block_res;
+  auto mapped = file.mapped_slice(block_offset, block_size);
+  if (mapped != nullptr) {
+    block_res = Block::decode_view(std::move(mapped), block_size, true);
   } else {
-    block_size = meta_entries[block_idx + 1].offset - meta.offset;
+    auto block_data = file.read_to_slice(block_offset, block_size);
+    block_res = Block::decode(block_data, true);
   }
 
-  // 读取block数据
-  auto block_data = file.read_to_slice(meta.offset, block_size);
-  auto block_res = Block::decode(block_data, true);
-
   // 更新缓存
   if (block_cache != nullptr) {
     block_cache->put(this->sst_id, block_idx, block_res);
@@ -145,13 +204,210 @@ std::shared_ptr<Block> SST::read_block(size_t block_idx) {
   return block_res;
 }
 
+// 所有 sst 共享的并发读取器
+static AsyncReader &sst_async_reader() {
+  static AsyncReader reader(std::max(
+      0, TomlConfig::getInstance().getLsmSstReadQueueDepth()));
+  return reader;
+}
+
+std::vector<std::shared_ptr<Block>>
+SST::read_blocks(const std::vector<size_t> &block_idxs, bool fill_cache) {
+  if (block_cache == nullptr) {
+    throw std::runtime_error("Block cache not set");
+  }
+
+  // 1. 先从缓存中查找, 记录未命中的 block
+  std::vector<std::shared_ptr<Block>> blocks(block_idxs.size());
+  std::vector<size_t> miss_pos;
+  for (size_t i = 0; i < block_idxs.size(); i++) {
+    if (block_idxs[i] >= num_blocks()) {
+      throw std::out_of_range("Block index out of range");
+    }
+    blocks[i] = block_cache->get(this->sst_id, block_idxs[i]);
+    if (blocks[i] == nullptr) {
+      miss_pos.push_back(i);
+    }
+  }
+  if (miss_pos.empty()) {
+    return blocks;
+  }
+
+  std::vector<std::pair<size_t, size_t>> locations;
+  locations.reserve(miss_pos.size());
+  for (auto pos : miss_pos) {
+    locations.push_back(block_location(block_idxs[pos]));
+  }
+
+  if (file.is_mapped()) {
+    // 2. mmap 模式下先让内核对所有 block 并发预读, 再零拷贝解码
+    for (auto [offset, size] : locations) {
+      file.advise_willneed(offset, size);
+    }
+    for (size_t i = 0; i < miss_pos.size(); i++) {
+      auto [offset, size] = locations[i];
+      blocks[miss_pos[i]] =
+          Block::decode_view(file.mapped_slice(offset, size), size, true);
+    }
+  } else {
+    // 2. 并发读取所有未命中的 block
+    std::vector<ReadRequest> requests(miss_pos.size());
+    for (size_t i = 0; i < miss_pos.size(); i++) {
+      requests[i].file = &file;
+      requests[i].offset = locations[i].first;
+      requests[i].length = locations[i].second;
+    }
+    sst_async_reader().read_all(requests);
+    for (size_t i = 0; i < miss_pos.size(); i++) {
+      if (requests[i].error) {
+        std::rethrow_exception(requests[i].error);
+      }
+      blocks[miss_pos[i]] = Block::decode(requests[i].data, true);
+    }
+  }
+
+  // 3. 放入缓存
+  if (!fill_cache) {
+    return blocks;
+  }
+  for (auto pos : miss_pos) {
+    block_cache->put(this->sst_id, block_idxs[pos], blocks[pos]);
+  }
+  return blocks;
+}
+
+std::pair<size_t, size_t> SST::block_location(size_t block_idx) {
+  if (partitioned_) {
+    size_t part_idx = find_partition_by_block(block_idx);
+    auto partition = load_index_partition(part_idx);
+    size_t local_idx = block_idx - partitions_[part_idx].first_block_idx;
+    size_t offset = partition->metas[local_idx].offset;
+    size_t end_offset;
+    if (local_idx + 1 < partition->metas.size()) {
+      end_offset = partition->metas[local_idx + 1].offset;
+    } else if (part_idx + 1 < partitions_.size()) {
+      end_offset = partitions_[part_idx + 1].data_offset;
+    } else {
+      end_offset = meta_block_offset;
+    }
+    return {offset, end_offset - offset};
+  }
+
+  size_t offset = block_offsets_[block_idx];
+  size_t block_size;
+
+  // 计算block大小
+  if (block_idx == block_offsets_.size() - 1) {
+    block_size = meta_block_offset - offset;
+  } else {
+    block_size = block_offsets_[block_idx + 1] - offset;
+  }
+  return {offset, block_size};
+}
+
+size_t SST::find_partition_by_key(const std::string &key) const {
+  // 第一个 last_key >= key 的分区
+  auto it = std::lower_bound(
+      partitions_.begin(), partitions_.end(), key,
+      [](const PartitionHandle &handle, const std::string &target) {
+        return handle.last_key < target;
+      });
+  if (it == partitions_.end() || key < it->first_key) {
+    // key 落在两个分区之间的空隙中
+    return static_cast<size_t>(-1);
+  }
+  return it - partitions_.begin();
+}
+
+size_t SST::find_partition_by_block(size_t block_idx) const {
+  // 最后一个 first_block_idx <= block_idx 的分区
+  auto it = std::upper_bound(
+      partitions_.begin(), partitions_.end(), block_idx,
+      [](size_t target, const PartitionHandle &handle) {
+        return target < handle.first_block_idx;
+      });
+  return (it - partitions_.begin()) - 1;
+}
+
+std::shared_ptr<IndexPartition> SST::load_index_partition(size_t part_idx) {
+  // 索引分区和过滤器分区在缓存中分别编号为 2 * idx 和 2 * idx + 1
+  int meta_id = static_cast<int>(part_idx * 2);
+  if (block_cache != nullptr) {
+    auto cached = block_cache->get_meta(sst_id, meta_id);
+    if (cached != nullptr) {
+      return std::static_pointer_cast<IndexPartition>(cached);
+    }
+  }
+
+  const auto &handle = partitions_[part_idx];
+  auto bytes = file.read_to_slice(handle.index_offset, handle.index_size);
+  auto partition = std::make_shared<IndexPartition>(
+      BlockMeta::decode_meta_from_slice(bytes));
+  if (block_cache != nullptr) {
+    block_cache->put_meta(sst_id, meta_id, partition);
+  }
+  return partition;
+}
+
+std::shared_ptr<FilterPartition> SST::load_filter_partition(size_t part_idx) {
+  int meta_id = static_cast<int>(part_idx * 2 + 1);
+  if (block_cache != nullptr) {
+    auto cached = block_cache->get_meta(sst_id, meta_id);
+    if (cached != nullptr) {
+      return std::static_pointer_cast<FilterPartition>(cached);
+    }
+  }
+
+  const auto &handle = partitions_[part_idx];
+  auto bytes = file.read_to_slice(handle.filter_offset, handle.filter_size);
+  auto partition =
+      std::make_shared<FilterPartition>(BloomFilter::decode(bytes));
+  if (block_cache != nullptr) {
+    block_cache->put_meta(sst_id, meta_id, partition);
+  }
+  return partition;
+}
+
 size_t SST::find_block_idx(const std::string &key) {
   // TODO: Lab 3.6 选择包含 key 的 block
-  // 注意：即使 first/last_key 的全局序不严格单调（例如 key 未补零），
-  // 也应尽力找到 first_key <= key <= last_key 的块。
-  if (meta_entries.empty())
+  if (partitioned_) {
+    size_t part_idx = find_partition_by_key(key);
+    if (part_idx == static_cast<size_t>(-1)) {
+      return static_cast<size_t>(-1);
+    }
+    auto partition = load_index_partition(part_idx);
+    size_t local_idx = static_cast<size_t>(-1);
+    if (partition->fence_index.size() > 0) {
+      local_idx = partition->fence_index.find(key);
+    } else {
+      for (size_t i = 0; i < partition->metas.size(); ++i) {
+        const auto &m = partition->metas[i];
+        if (key >= m.first_key && key <= m.last_key) {
+          local_idx = i;
+        }
+      }
+    }
+    if (local_idx == static_cast<size_t>(-1)) {
+      return local_idx;
+    }
+    return partitions_[part_idx].first_block_idx + local_idx;
+  }
+
+  if (block_offsets_.empty())
     return static_cast<size_t>(-1);
 
+  // block 之间按 key 严格有序 (相同 key 位于同一 block) 时,
+  // 在栅栏索引上二分即可定位, 落在两个 block 间隙中的 key 会定位到
+  // 相邻 block 之一, 后续在 block 内查找时自然找不到
+  if (fence_index.size() > 0) {
+    if (key > last_key) {
+      return static_cast<size_t>(-1);
+    }
+    return fence_index.find(key);
+  }
+
+  // 注意：即使 first/last_key 的全局序不严格单调（例如 key 未补零），
+  // 也应尽力找到 first_key <= key <= last_key 的块。
   size_t best = static_cast<size_t>(-1);
   std::string best_first;
   for (size_t i = 0; i < meta_entries.size(); ++i) {
@@ -167,6 +423,33 @@ size_t SST::find_block_idx(const std::string &key) {
   return best;
 }
 
+size_t SST::lower_bound_block_idx(const std::string &key) {
+  if (key <= first_key) {
+    return 0;
+  }
+  if (key > last_key) {
+    return num_blocks();
+  }
+  if (!partitioned_ && fence_index.size() > 0) {
+    // 栅栏之前的 block 的 last_key 都小于 key, 该 block 中没有满足条件的条目时
+    // 由迭代器继续移动到下一个 block
+    size_t idx = fence_index.find(key);
+    return idx == static_cast<size_t>(-1) ? 0 : idx;
+  }
+  // 二分查找第一个 last_key 不小于 key 的 block
+  size_t left = 0;
+  size_t right = num_blocks();
+  while (left < right) {
+    size_t mid = left + (right - left) / 2;
+    if (get_block_meta(mid).last_key < key) {
+      left = mid + 1;
+    } else {
+      right = mid;
+    }
+  }
+  return left;
+}
+
 SstIterator SST::get(const std::string &key, uint64_t tranc_id) {
   // TODO: Lab 3.6 根据查询`key`返回一个迭代器
   // ? 如果`key`不存在, 返回一个无效的迭代器即可
@@ -174,19 +457,196 @@ SstIterator SST::get(const std::string &key, uint64_t tranc_id) {
     return this->end();
   }
 
-  return SstIterator(shared_from_this(), key, tranc_id);
+  // 布隆过滤器判定不存在时, 无需读取任何 block
+  if (!may_contain(key)) {
+    return this->end();
+  }
+
+  return find(key, tranc_id);
 }
 
-size_t SST::num_blocks() const { return meta_entries.size(); }
+SstIterator SST::find(const std::string &key, uint64_t tranc_id,
+                      bool *key_exists) {
+  if (key_exists != nullptr) {
+    *key_exists = false;
+  }
+  if (key < first_key || key > last_key) {
+    return this->end();
+  }
 
-std::string SST::get_first_key() const { return first_key; }
+  try {
+    size_t block_idx = find_block_idx(key);
+    if (block_idx == static_cast<size_t>(-1) || block_idx >= num_blocks()) {
+      return this->end();
+    }
+    auto block = read_block(block_idx);
+    if (!block) {
+      return this->end();
+    }
+    // 同一个 key 的所有版本位于同一个 block 中
+    auto block_it =
+        std::make_shared<BlockIterator>(block, key, tranc_id, key_exists);
+    if (block_it->is_end()) {
+      return this->end();
+    }
+    // 不能通过构造函数传入 sst, 否则会 seek_first 读取第一个 block
+    SstIterator it(nullptr, tranc_id);
+    it.m_sst = shared_from_this();
+    it.m_block_idx = block_idx;
+    it.m_block_it = std::move(block_it);
+    return it;
+  } catch (const std::exception &) {
+    // 与 SstIterator::seek 一致, 读取失败视为不存在
+    return this->end();
+  }
+}
+
+std::vector<std::optional<std::pair<std::string, uint64_t>>>
+SST::get_batch(const std::vector<std::string> &keys, uint64_t tranc_id,
+               std::vector<bool> *key_exists) {
+  std::vector<std::optional<std::pair<std::string, uint64_t>>> results(
+      keys.size());
+  if (key_exists != nullptr) {
+    key_exists->assign(keys.size(), false);
+  }
+
+  // 1. 定位每个 key 所在的 block, keys 有序, block 索引单调不减
+  std::vector<size_t> key_blocks(keys.size(), static_cast<size_t>(-1));
+  std::vector<size_t> block_idxs;
+  for (size_t i = 0; i < keys.size(); i++) {
+    const auto &key = keys[i];
+    if (key < first_key || key > last_key) {
+      continue;
+    }
+    size_t block_idx = find_block_idx(key);
+    if (block_idx == static_cast<size_t>(-1) || block_idx >= num_blocks()) {
+      continue;
+    }
+    if (block_idxs.empty() || block_idxs.back() != block_idx) {
+      block_idxs.push_back(block_idx);
+    }
+    key_blocks[i] = block_idxs.size() - 1;
+  }
+  if (block_idxs.empty()) {
+    return results;
+  }
+
+  // 2. 一次性读取所有需要的 block, 每个 block 只读取一次
+  auto blocks = read_blocks(block_idxs);
+
+  // 3. 在各自的 block 中查找
+  for (size_t i = 0; i < keys.size(); i++) {
+    if (key_blocks[i] == static_cast<size_t>(-1)) {
+      continue;
+    }
+    bool exists = false;
+    BlockIterator it(blocks[key_blocks[i]], keys[i], tranc_id, &exists);
+    if (key_exists != nullptr) {
+      (*key_exists)[i] = exists;
+    }
+    if (it.is_end()) {
+      continue;
+    }
+    results[i].emplace(std::string(it.value()), it.current_tranc_id());
+  }
+  return results;
+}
+
+size_t SST::read_prefix_filter(size_t sections_end) {
+  constexpr size_t trailer_len = sizeof(uint32_t) * 3 + sizeof(uint64_t);
+  if (sections_end < bloom_offset + trailer_len) {
+    return sections_end;
+  }
+  auto trailer = file.read_to_slice(sections_end - trailer_len, trailer_len);
+  uint64_t magic;
+  memcpy(&magic, trailer.data() + sizeof(uint32_t) * 3, sizeof(uint64_t));
+  if (magic != SST_PREFIX_FILTER_MAGIC) {
+    return sections_end;
+  }
+
+  uint32_t stride, max_len, filter_size;
+  memcpy(&stride, trailer.data(), sizeof(uint32_t));
+  memcpy(&max_len, trailer.data() + sizeof(uint32_t), sizeof(uint32_t));
+  memcpy(&filter_size, trailer.data() + sizeof(uint32_t) * 2,
+         sizeof(uint32_t));
+  if (sections_end < bloom_offset + trailer_len + filter_size) {
+    throw std::runtime_error("Invalid SST file: corrupted prefix filter");
+  }
+
+  size_t filter_offset = sections_end - trailer_len - filter_size;
+  auto filter_bytes = file.read_to_slice(filter_offset, filter_size);
+  prefix_bloom_ =
+      std::make_shared<BloomFilter>(BloomFilter::decode(filter_bytes));
+  prefix_extractor_ = PrefixExtractor(stride, max_len);
+  return filter_offset;
+}
 
-std::string SST::get_last_key() const { return last_key; }
+bool SST::may_contain_prefix(const std::string &prefix) const {
+  if (prefix_bloom_ == nullptr) {
+    return true;
+  }
+  auto len = prefix_extractor_.query_len(prefix.size());
+  if (len == 0) {
+    return true;
+  }
+  return prefix_bloom_->possibly_contains(prefix.substr(0, len));
+}
+
+bool SST::may_contain(const std::string &key) {
+  if (partitioned_) {
+    size_t part_idx = find_partition_by_key(key);
+    if (part_idx == static_cast<size_t>(-1)) {
+      return false;
+    }
+    if (partitions_[part_idx].filter_size == 0) {
+      return true;
+    }
+    return load_filter_partition(part_idx)->bloom_filter.possibly_contains(key);
+  }
+
+  if (bloom_filter == nullptr) {
+    return true;
+  }
+  return bloom_filter->possibly_contains(key);
+}
+
+BlockMeta SST::get_block_meta(size_t block_idx) {
+  if (block_idx >= num_blocks()) {
+    throw std::out_of_range("Block index out of range");
+  }
+  if (partitioned_) {
+    size_t part_idx = find_partition_by_block(block_idx);
+    auto partition = load_index_partition(part_idx);
+    return partition->metas[block_idx - partitions_[part_idx].first_block_idx];
+  }
+  if (!meta_entries.empty()) {
+    return meta_entries[block_idx];
+  }
+  return load_meta_entries()->metas[block_idx];
+}
+
+bool SST::is_partitioned() const { return partitioned_; }
+
+size_t SST::num_blocks() const {
+  return partitioned_ ? num_blocks_ : block_offsets_.size();
+}
+
+const std::string &SST::get_first_key() const { return first_key; }
+
+const std::string &SST::get_last_key() const { return last_key; }
 
 size_t SST::sst_size() const { return file.size(); }
 
 size_t SST::get_sst_id() const { return sst_id; }
 
+SstIterator SST::lower_bound(const std::string &key, uint64_t tranc_id) {
+  // 不通过构造函数传入 sst, 避免 seek_first 读取第一个 block
+  SstIterator res(nullptr, tranc_id);
+  res.m_sst = shared_from_this();
+  res.lower_bound(key);
+  return res;
+}
+
 SstIterator SST::begin(uint64_t tranc_id) {
   // TODO: Lab 3.6 返回起始位置迭代器
   SstIterator res(shared_from_this(), tranc_id);
@@ -195,8 +655,10 @@ SstIterator SST::begin(uint64_t tranc_id) {
 
 SstIterator SST::end() {
   // TODO: Lab 3.6 返回终止位置迭代器
-  SstIterator res(shared_from_this(), 0);
-  res.m_block_idx = meta_entries.size();
+  // 不能通过构造函数传入 sst, 否则会 seek_first 读取第一个 block
+  SstIterator res(nullptr, 0);
+  res.m_sst = shared_from_this();
+  res.m_block_idx = num_blocks();
   res.m_block_it = nullptr;
   return res;
 }
@@ -274,13 +736,26 @@ void SST::export_to_txt(const std::string &out_path, size_t level,
 // SSTBuilder
 // **************************************************
 
-SSTBuilder::SSTBuilder(size_t block_size, bool has_bloom) : block(block_size) {
+SSTBuilder::SSTBuilder(size_t block_size, bool has_bloom,
+                       size_t partition_blocks)
+    : block(block_size), has_bloom_(has_bloom),
+      partition_blocks_(partition_blocks) {
   // 初始化第一个block
-  if (has_bloom) {
+  // 分区格式下每个分区单独构建布隆过滤器
+  if (has_bloom && partition_blocks_ == 0) {
     bloom_filter = std::make_shared<BloomFilter>(
         TomlConfig::getInstance().getBloomFilterExpectedSize(),
         TomlConfig::getInstance().getBloomFilterExpectedErrorRate());
   }
+  // 前缀过滤器覆盖整个 sst, 与是否分区无关
+  auto prefix_stride = TomlConfig::getInstance().getBloomFilterPrefixStride();
+  auto prefix_max_len = TomlConfig::getInstance().getBloomFilterPrefixMaxLen();
+  if (has_bloom && prefix_stride > 0 && prefix_max_len > 0) {
+    prefix_extractor_ = PrefixExtractor(prefix_stride, prefix_max_len);
+    prefix_bloom_ = std::make_shared<BloomFilter>(
+        TomlConfig::getInstance().getBloomFilterExpectedSize(),
+        TomlConfig::getInstance().getBloomFilterExpectedErrorRate());
+  }
   meta_entries.clear();
   data.clear();
   first_key.clear();
@@ -301,6 +776,15 @@ void SSTBuilder::add(const std::string &key, const std::string &value,
     bloom_filter->add(key);
   }
 
+  // key 有序写入, 只需要添加与上一个 key 不同的前缀
+  if (prefix_bloom_ != nullptr && key != prefix_last_key_) {
+    prefix_extractor_.new_prefixes(prefix_last_key_, key, prefix_buf_);
+    for (auto prefix : prefix_buf_) {
+      prefix_bloom_->add(std::string(prefix));
+    }
+    prefix_last_key_ = key;
+  }
+
   // 记录 事务id 范围
   max_tranc_id_ = std::max(max_tranc_id_, tranc_id);
   min_tranc_id_ = std::min(min_tranc_id_, tranc_id);
@@ -325,6 +809,12 @@ void SSTBuilder::add(const std::string &key, const std::string &value,
     // 写入成功，更新 last_key
     last_key = key;
   }
+
+  // 分区的过滤器在 finish_partition 时构建, 需在 block 切换之后再记录 key
+  if (partition_blocks_ > 0 && has_bloom_ &&
+      (partition_keys_.empty() || partition_keys_.back() != key)) {
+    partition_keys_.push_back(key);
+  }
 }
 
 size_t SSTBuilder::estimated_size() const { 
@@ -342,7 +832,8 @@ void SSTBuilder::finish_block() {
   }
 
   auto old_block = std::move(this->block);
-  auto encoded_block = old_block.encode();
+  auto encoded_block =
+      old_block.encode(TomlConfig::getInstance().getLsmBlockHashIndex());
 
   // 记录当前块的起始偏移
   meta_entries.emplace_back(data.size(), first_key, last_key);
@@ -362,6 +853,53 @@ void SSTBuilder::finish_block() {
   this->block = Block(this->block_size);
   first_key.clear();
   last_key.clear();
+
+  if (partition_blocks_ > 0 &&
+      meta_entries.size() - partition_start_ >= partition_blocks_) {
+    finish_partition();
+  }
+}
+
+void SSTBuilder::finish_partition() {
+  if (partition_start_ >= meta_entries.size()) {
+    return;
+  }
+
+  std::vector<BlockMeta> metas(meta_entries.begin() + partition_start_,
+                               meta_entries.end());
+
+  PartitionHandle handle;
+  handle.first_block_idx = partition_start_;
+  handle.data_offset = metas.front().offset;
+  handle.first_key = metas.front().first_key;
+  handle.last_key = metas.back().last_key;
+
+  // 索引分区, 偏移量暂时相对于 index_data_, build 时再修正
+  std::vector<uint8_t> index_block;
+  BlockMeta::encode_meta_to_slice(metas, index_block);
+  handle.index_offset = index_data_.size();
+  handle.index_size = index_block.size();
+  index_data_.insert(index_data_.end(), index_block.begin(),
+                     index_block.end());
+
+  // 过滤器分区, 偏移量暂时相对于 filter_data_
+  handle.filter_offset = filter_data_.size();
+  if (has_bloom_) {
+    BloomFilter filter(
+        std::max<size_t>(1, partition_keys_.size()),
+        TomlConfig::getInstance().getBloomFilterExpectedErrorRate());
+    for (const auto &key : partition_keys_) {
+      filter.add(key);
+    }
+    auto filter_block = filter.encode();
+    handle.filter_size = filter_block.size();
+    filter_data_.insert(filter_data_.end(), filter_block.begin(),
+                        filter_block.end());
+  }
+
+  partitions_.push_back(std::move(handle));
+  partition_keys_.clear();
+  partition_start_ = meta_entries.size();
 }
 
 std::shared_ptr<SST>
@@ -379,6 +917,10 @@ SSTBuilder::build(size_t sst_id, const std::string &path,
     throw std::runtime_error("Cannot build empty SST");
   }
 
+  if (partition_blocks_ > 0) {
+    return build_partitioned(sst_id, path, block_cache);
+  }
+
   // 编码元数据块
   std::vector<uint8_t> meta_block;
   BlockMeta::encode_meta_to_slice(meta_entries, meta_block);
@@ -399,6 +941,7 @@ SSTBuilder::build(size_t sst_id, const std::string &path,
     auto bf_data = bloom_filter->encode();
     file_content.insert(file_content.end(), bf_data.begin(), bf_data.end());
   }
+  append_prefix_filter(file_content);
 
   auto extra_len = sizeof(uint32_t) * 2 + sizeof(uint64_t) * 2;
   file_content.resize(file_content.size() + extra_len);
@@ -422,18 +965,113 @@ SSTBuilder::build(size_t sst_id, const std::string &path,
 
   // 创建文件
   FileObj file = FileObj::create_and_write(path, file_content);
+  if (TomlConfig::getInstance().getLsmSstMmapRead()) {
+    file = FileObj::open_mmap(path);
+  }
 
   // 返回SST对象
   auto res = std::make_shared<SST>();
 
   res->sst_id = sst_id;
   res->file = std::move(file);
-  res->first_key = meta_entries.front().first_key;
-  res->last_key = meta_entries.back().last_key;
   res->meta_block_offset = meta_offset;
   res->bloom_filter = this->bloom_filter;
   res->bloom_offset = bloom_offset;
-  res->meta_entries = std::move(meta_entries);
+  res->prefix_bloom_ = prefix_bloom_;
+  res->prefix_extractor_ = prefix_extractor_;
+  res->init_index(std::move(meta_entries));
+  res->block_cache = block_cache;
+  res->max_tranc_id_ = max_tranc_id_;
+  res->min_tranc_id_ = min_tranc_id_;
+
+  return res;
+}
+
+void SSTBuilder::append_prefix_filter(std::vector<uint8_t> &file_content) {
+  if (prefix_bloom_ == nullptr) {
+    return;
+  }
+  auto filter = prefix_bloom_->encode();
+  uint32_t stride = prefix_extractor_.stride();
+  uint32_t max_len = prefix_extractor_.max_len();
+  uint32_t filter_size = filter.size();
+  uint64_t magic = SST_PREFIX_FILTER_MAGIC;
+
+  file_content.insert(file_content.end(), filter.begin(), filter.end());
+  auto append = [&](const void *src, size_t len) {
+    auto ptr = static_cast<const uint8_t *>(src);
+    file_content.insert(file_content.end(), ptr, ptr + len);
+  };
+  append(&stride, sizeof(uint32_t));
+  append(&max_len, sizeof(uint32_t));
+  append(&filter_size, sizeof(uint32_t));
+  append(&magic, sizeof(uint64_t));
+}
+
+std::shared_ptr<SST>
+SSTBuilder::build_partitioned(size_t sst_id, const std::string &path,
+                              std::shared_ptr<BlockCache> block_cache) {
+  // 完成最后一个分区
+  finish_partition();
+
+  uint32_t meta_offset = data.size();
+  uint32_t filter_base = meta_offset + index_data_.size();
+  for (auto &handle : partitions_) {
+    handle.index_offset += meta_offset;
+    handle.filter_offset += filter_base;
+  }
+
+  // 构建完整的文件内容
+  // 1. 已有的数据块
+  std::vector<uint8_t> file_content = std::move(data);
+
+  // 2. 索引分区和过滤器分区
+  file_content.insert(file_content.end(), index_data_.begin(),
+                      index_data_.end());
+  file_content.insert(file_content.end(), filter_data_.begin(),
+                      filter_data_.end());
+
+  // 3. 顶层索引
+  uint32_t top_index_offset = file_content.size();
+  std::vector<uint8_t> top_index;
+  PartitionHandle::encode_partitions(partitions_, meta_entries.size(),
+                                     top_index);
+  file_content.insert(file_content.end(), top_index.begin(), top_index.end());
+  append_prefix_filter(file_content);
+
+  // 4. footer
+  auto extra_len = sizeof(uint32_t) * 2 + sizeof(uint64_t) * 3;
+  file_content.resize(file_content.size() + extra_len);
+  uint8_t *footer = file_content.data() + file_content.size() - extra_len;
+  uint64_t magic = SST_PARTITIONED_MAGIC;
+  memcpy(footer, &meta_offset, sizeof(uint32_t));
+  memcpy(footer + sizeof(uint32_t), &top_index_offset, sizeof(uint32_t));
+  memcpy(footer + sizeof(uint32_t) * 2, &min_tranc_id_, sizeof(uint64_t));
+  memcpy(footer + sizeof(uint32_t) * 2 + sizeof(uint64_t), &max_tranc_id_,
+         sizeof(uint64_t));
+  memcpy(footer + sizeof(uint32_t) * 2 + sizeof(uint64_t) * 2, &magic,
+         sizeof(uint64_t));
+
+  // 创建文件
+  FileObj file = FileObj::create_and_write(path, file_content);
+  if (TomlConfig::getInstance().getLsmSstMmapRead()) {
+    file = FileObj::open_mmap(path);
+  }
+
+  // 返回SST对象, 分区内容留给读取时按需加载
+  auto res = std::make_shared<SST>();
+
+  res->sst_id = sst_id;
+  res->file = std::move(file);
+  res->first_key = meta_entries.front().first_key;
+  res->last_key = meta_entries.back().last_key;
+  res->meta_block_offset = meta_offset;
+  res->bloom_offset = top_index_offset;
+  res->partitioned_ = true;
+  res->num_blocks_ = meta_entries.size();
+  res->partitions_ = std::move(partitions_);
+  res->prefix_bloom_ = prefix_bloom_;
+  res->prefix_extractor_ = prefix_extractor_;
   res->block_cache = block_cache;
   res->max_tranc_id_ = max_tranc_id_;
   res->min_tranc_id_ = min_tranc_id_;
@@ -1,6 +1,8 @@
 #include "../../include/sst/sst_iterator.h"
 #include "../../include/sst/sst.h"
+#include "../../include/config/config.h"
 #include "spdlog/spdlog.h"
+#include <algorithm>
 #include <cstddef>
 #include <iostream>
 #include <memory>
@@ -23,11 +25,12 @@ std::optional<std::pair<SstIterator, SstIterator>> sst_iters_monotony_predicate(
   }
 
   const int n = static_cast<int>(sst->num_blocks());
-  auto first_key_of = [&](int i) -> const std::string & {
-    return sst->meta_entries[i].first_key;
+  // 分区格式下 block 元数据需要按需加载, 因此按值返回
+  auto first_key_of = [&](int i) -> std::string {
+    return sst->get_block_meta(i).first_key;
   };
-  auto last_key_of = [&](int i) -> const std::string & {
-    return sst->meta_entries[i].last_key;
+  auto last_key_of = [&](int i) -> std::string {
+    return sst->get_block_meta(i).last_key;
   };
 
   int l = 0, r = n - 1, first = -1;
@@ -94,8 +97,13 @@ std::optional<std::pair<SstIterator, SstIterator>> sst_iters_monotony_predicate(
   return std::make_pair(it_begin, it_end);
 }
 
+// 自适应预读的初始窗口
+static constexpr size_t SST_READAHEAD_INITIAL_BLOCKS = 2;
+
 SstIterator::SstIterator(std::shared_ptr<SST> sst, uint64_t tranc_id)
-    : m_sst(sst), m_block_idx(0), m_block_it(nullptr), max_tranc_id_(tranc_id) {
+    : m_sst(sst), m_block_idx(0), m_block_it(nullptr), max_tranc_id_(tranc_id),
+      readahead_max_(std::max(
+          0, TomlConfig::getInstance().getLsmSstReadaheadMaxBlocks())) {
   if (m_sst) {
     seek_first();
   }
@@ -103,19 +111,95 @@ SstIterator::SstIterator(std::shared_ptr<SST> sst, uint64_t tranc_id)
 
 SstIterator::SstIterator(std::shared_ptr<SST> sst, const std::string &key,
                          uint64_t tranc_id)
-    : m_sst(sst), m_block_idx(0), m_block_it(nullptr), max_tranc_id_(tranc_id) {
+    : m_sst(sst), m_block_idx(0), m_block_it(nullptr), max_tranc_id_(tranc_id),
+      readahead_max_(std::max(
+          0, TomlConfig::getInstance().getLsmSstReadaheadMaxBlocks())) {
   if (m_sst) {
     seek(key);
   }
 }
 
-void SstIterator::set_block_idx(size_t idx) { m_block_idx = idx; }
+void SstIterator::set_block_idx(size_t idx) {
+  reset_readahead();
+  m_block_idx = idx;
+}
 void SstIterator::set_block_it(std::shared_ptr<BlockIterator> it) {
   m_block_it = it;
 }
 
+void SstIterator::reset_readahead() {
+  readahead_blocks_.clear();
+  sequential_reads_ = 0;
+  if (!readahead_fixed_) {
+    readahead_window_ = 0;
+  }
+}
+
+std::shared_ptr<Block> SstIterator::next_block() {
+  if (!readahead_blocks_.empty()) {
+    auto block = std::move(readahead_blocks_.front());
+    readahead_blocks_.pop_front();
+    return block;
+  }
+
+  // 连续两次顺序读取后开始预读, 之后每次预读的窗口翻倍, 直到上限
+  sequential_reads_++;
+  if (!readahead_fixed_ && readahead_max_ > 0 && sequential_reads_ >= 2) {
+    readahead_window_ =
+        readahead_window_ == 0
+            ? std::min(SST_READAHEAD_INITIAL_BLOCKS, readahead_max_)
+            : std::min(readahead_window_ * 2, readahead_max_);
+  }
+
+  size_t end = std::min(m_block_idx + readahead_window_, m_sst->num_blocks());
+  if (end <= m_block_idx + 1) {
+    return m_sst->read_block(m_block_idx);
+  }
+  std::vector<size_t> block_idxs;
+  for (size_t idx = m_block_idx; idx < end; idx++) {
+    block_idxs.push_back(idx);
+  }
+  auto blocks = m_sst->read_blocks(block_idxs, readahead_fill_cache_);
+  readahead_blocks_.assign(std::make_move_iterator(blocks.begin() + 1),
+                           std::make_move_iterator(blocks.end()));
+  return blocks.front();
+}
+
+void SstIterator::skip_to_visible_block() {
+  while (m_block_idx < m_sst->num_blocks()) {
+    m_block_it =
+        std::make_shared<BlockIterator>(next_block(), 0, max_tranc_id_);
+    // 如果新block有可见记录，停止查找
+    if (!m_block_it->is_end()) {
+      return;
+    }
+    // 否则继续查找下一个block
+    m_block_idx++;
+  }
+  // 如果所有block都没有可见记录，设为end状态
+  m_block_it = nullptr;
+}
+
+void SstIterator::continue_with(std::shared_ptr<SST> sst) {
+  cached_value = std::nullopt;
+  readahead_blocks_.clear();
+  m_sst = std::move(sst);
+  m_block_idx = 0;
+  m_block_it = nullptr;
+  if (m_sst) {
+    skip_to_visible_block();
+  }
+}
+
+void SstIterator::set_readahead(size_t blocks, bool fill_cache) {
+  readahead_fixed_ = true;
+  readahead_window_ = blocks;
+  readahead_fill_cache_ = fill_cache;
+}
+
 void SstIterator::seek_first() {
   // TODO: Lab 3.6 将迭代器定位到第一个key
+  reset_readahead();
   if (!m_sst || m_sst->num_blocks() == 0) {
     m_block_it = nullptr;
     return;
@@ -128,6 +212,7 @@ void SstIterator::seek_first() {
 
 void SstIterator::seek(const std::string &key) {
   // TODO: Lab 3.6 将迭代器定位到指定key的位置
+  reset_readahead();
   if (!m_sst) {
     m_block_it = nullptr;
     return;
@@ -159,18 +244,42 @@ void SstIterator::seek(const std::string &key) {
   }
 }
 
-std::string SstIterator::key() {
+void SstIterator::lower_bound(const std::string &key) {
+  reset_readahead();
+  cached_value = std::nullopt;
+  m_block_it = nullptr;
+  if (!m_sst) {
+    return;
+  }
+
+  m_block_idx = m_sst->lower_bound_block_idx(key);
+  while (m_block_idx < m_sst->num_blocks()) {
+    auto block = m_sst->read_block(m_block_idx);
+    m_block_it = std::make_shared<BlockIterator>(
+        block, block->lower_bound(key), max_tranc_id_);
+    if (!m_block_it->is_end()) {
+      return;
+    }
+    // 当前 block 中的 key 都小于目标 key, 或者都不可见
+    m_block_idx++;
+  }
+  m_block_it = nullptr;
+}
+
+std::string_view SstIterator::key() const {
+  // 与 BlockIterator 一致, 无效的迭代器返回空视图
   if (!m_block_it) {
-    throw std::runtime_error("Iterator is invalid");
+    return {};
   }
-  return (*m_block_it)->first;
+  return m_block_it->key();
 }
 
-std::string SstIterator::value() {
+std::string_view SstIterator::value() const {
+  // 与 BlockIterator 一致, 无效的迭代器返回空视图
   if (!m_block_it) {
-    throw std::runtime_error("Iterator is invalid");
+    return {};
   }
-  return (*m_block_it)->second;
+  return m_block_it->value();
 }
 
 BaseIterator &SstIterator::operator++() {
@@ -178,27 +287,12 @@ BaseIterator &SstIterator::operator++() {
   if (!m_block_it) { // 添加空指针检查
     return *this;
   }
+  cached_value = std::nullopt;
   ++(*m_block_it);
   if (m_block_it->is_end()) {
-    m_block_idx++;
     // 需要循环查找下一个有可见记录的block
-    while (m_block_idx < m_sst->num_blocks()) {
-      auto next_block = m_sst->read_block(m_block_idx);
-      m_block_it =
-          std::make_shared<BlockIterator>(next_block, 0, max_tranc_id_);
-
-      // 如果新block有可见记录，停止查找
-      if (!m_block_it->is_end()) {
-        break;
-      }
-      // 否则继续查找下一个block
-      m_block_idx++;
-    }
-
-    // 如果所有block都没有可见记录，设为end状态
-    if (m_block_idx >= m_sst->num_blocks()) {
-      m_block_it = nullptr;
-    }
+    m_block_idx++;
+    skip_to_visible_block();
   }
   return *this;
 }
@@ -239,7 +333,13 @@ SstIterator::value_type SstIterator::operator*() const {
 
 IteratorType SstIterator::get_type() const { return IteratorType::SstIterator; }
 
-uint64_t SstIterator::get_tranc_id() const { return max_tranc_id_; }
+uint64_t SstIterator::get_tranc_id() const {
+  // 返回当前条目的事务id, 归并时需要据此比较同一 key 的新旧
+  if (!m_block_it) {
+    return 0;
+  }
+  return m_block_it->current_tranc_id();
+}
 bool SstIterator::is_end() const { return !m_block_it; }
 
 bool SstIterator::is_valid() const {
@@ -269,7 +369,7 @@ SstIterator::merge_sst_iterator(std::vector<SstIterator> iter_vec,
   std::vector<SearchItem> items;
   for (auto &iter : iter_vec) {
     while (iter.is_valid() && !iter.is_end()) {
-      items.emplace_back(iter.key(), iter.value(),
+      items.emplace_back(std::string(iter.key()), std::string(iter.value()),
                          -static_cast<int>(iter.m_sst->get_sst_id()), 0,
                          tranc_id);
       ++iter;
@@ -0,0 +1,107 @@
+#include "../../include/sst/sst_partition.h"
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+namespace tiny_lsm {
+
+void PartitionHandle::encode_partitions(
+    const std::vector<PartitionHandle> &handles, uint32_t num_blocks,
+    std::vector<uint8_t> &out) {
+  size_t total_size = sizeof(uint32_t) * 2; // num_blocks + num_partitions
+  for (const auto &handle : handles) {
+    total_size += sizeof(uint32_t) * 6 + sizeof(uint16_t) * 2 +
+                  handle.first_key.size() + handle.last_key.size();
+  }
+  total_size += sizeof(uint32_t); // hash
+
+  out.resize(total_size);
+  uint8_t *ptr = out.data();
+  auto write = [&ptr](const void *src, size_t len) {
+    memcpy(ptr, src, len);
+    ptr += len;
+  };
+
+  uint32_t num_partitions = handles.size();
+  write(&num_blocks, sizeof(uint32_t));
+  write(&num_partitions, sizeof(uint32_t));
+  for (const auto &handle : handles) {
+    write(&handle.first_block_idx, sizeof(uint32_t));
+    write(&handle.data_offset, sizeof(uint32_t));
+    write(&handle.index_offset, sizeof(uint32_t));
+    write(&handle.index_size, sizeof(uint32_t));
+    write(&handle.filter_offset, sizeof(uint32_t));
+    write(&handle.filter_size, sizeof(uint32_t));
+    uint16_t first_key_len = handle.first_key.size();
+    write(&first_key_len, sizeof(uint16_t));
+    write(handle.first_key.data(), first_key_len);
+    uint16_t last_key_len = handle.last_key.size();
+    write(&last_key_len, sizeof(uint16_t));
+    write(handle.last_key.data(), last_key_len);
+  }
+
+  uint32_t hash = std::hash<std::string_view>{}(
+      std::string_view(reinterpret_cast<const char *>(out.data()),
+                       ptr - out.data()));
+  write(&hash, sizeof(uint32_t));
+}
+
+std::vector<PartitionHandle>
+PartitionHandle::decode_partitions(const std::vector<uint8_t> &data,
+                                   uint32_t &num_blocks) {
+  if (data.size() < sizeof(uint32_t) * 3) {
+    throw std::runtime_error("partition index too short");
+  }
+
+  const uint8_t *ptr = data.data();
+  const uint8_t *data_end = data.data() + data.size() - sizeof(uint32_t);
+  uint32_t stored_hash;
+  memcpy(&stored_hash, data_end, sizeof(uint32_t));
+  uint32_t computed_hash = std::hash<std::string_view>{}(std::string_view(
+      reinterpret_cast<const char *>(ptr), data_end - ptr));
+  if (stored_hash != computed_hash) {
+    throw std::runtime_error("partition index hash mismatch");
+  }
+
+  auto read = [&ptr, data_end](void *dst, size_t len) {
+    if (ptr + len > data_end) {
+      throw std::runtime_error("corrupted partition index");
+    }
+    memcpy(dst, ptr, len);
+    ptr += len;
+  };
+
+  uint32_t num_partitions;
+  read(&num_blocks, sizeof(uint32_t));
+  read(&num_partitions, sizeof(uint32_t));
+
+  std::vector<PartitionHandle> handles(num_partitions);
+  for (auto &handle : handles) {
+    read(&handle.first_block_idx, sizeof(uint32_t));
+    read(&handle.data_offset, sizeof(uint32_t));
+    read(&handle.index_offset, sizeof(uint32_t));
+    read(&handle.index_size, sizeof(uint32_t));
+    read(&handle.filter_offset, sizeof(uint32_t));
+    read(&handle.filter_size, sizeof(uint32_t));
+    uint16_t first_key_len;
+    read(&first_key_len, sizeof(uint16_t));
+    handle.first_key.resize(first_key_len);
+    read(handle.first_key.data(), first_key_len);
+    uint16_t last_key_len;
+    read(&last_key_len, sizeof(uint16_t));
+    handle.last_key.resize(last_key_len);
+    read(handle.last_key.data(), last_key_len);
+  }
+  return handles;
+}
+
+IndexPartition::IndexPartition(std::vector<BlockMeta> metas)
+    : metas(std::move(metas)) {
+  fence_index = FenceIndex(this->metas);
+}
+
+FilterPartition::FilterPartition(BloomFilter bloom_filter)
+    : bloom_filter(std::move(bloom_filter)) {}
+} // namespace tiny_lsm
@@ -0,0 +1,103 @@
+#include "../../include/utils/async_reader.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace tiny_lsm {
+
+AsyncReader::AsyncReader(size_t queue_depth) {
+  workers_.reserve(queue_depth);
+  for (size_t i = 0; i < queue_depth; i++) {
+    workers_.emplace_back([this]() { worker_loop(); });
+  }
+}
+
+AsyncReader::~AsyncReader() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+}
+
+size_t AsyncReader::queue_depth() const { return workers_.size(); }
+
+void AsyncReader::worker_loop() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this]() { return stop_ || !tasks_.empty(); });
+      if (stop_ && tasks_.empty()) {
+        return;
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+    task();
+  }
+}
+
+void AsyncReader::read_all(std::vector<ReadRequest> &requests) {
+  auto execute = [](ReadRequest &req) {
+    try {
+      req.data = req.file->pread_to_slice(req.offset, req.length);
+    } catch (...) {
+      req.error = std::current_exception();
+    }
+  };
+
+  if (workers_.empty() || requests.size() <= 1) {
+    for (auto &req : requests) {
+      execute(req);
+    }
+    return;
+  }
+
+  // 后台任务可能在本批请求完成之后才被调度, 因此批次状态由共享指针管理,
+  // 任务只有在领取到有效的请求下标时才会访问 requests
+  struct Batch {
+    std::vector<ReadRequest> *requests;
+    std::atomic<size_t> next{0};
+    size_t finished = 0;
+    std::mutex mutex;
+    std::condition_variable cv;
+  };
+  auto batch = std::make_shared<Batch>();
+  batch->requests = &requests;
+  size_t total = requests.size();
+
+  auto run = [batch, total, execute]() {
+    size_t done = 0;
+    for (size_t idx = batch->next.fetch_add(1); idx < total;
+         idx = batch->next.fetch_add(1)) {
+      execute((*batch->requests)[idx]);
+      done++;
+    }
+    if (done > 0) {
+      std::lock_guard<std::mutex> lock(batch->mutex);
+      batch->finished += done;
+      if (batch->finished == total) {
+        batch->cv.notify_all();
+      }
+    }
+  };
+
+  size_t helpers = std::min(workers_.size(), total - 1);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < helpers; i++) {
+      tasks_.push_back(run);
+    }
+  }
+  cv_.notify_all();
+
+  // 调用线程同样领取请求执行
+  run();
+  std::unique_lock<std::mutex> lock(batch->mutex);
+  batch->cv.wait(lock, [&]() { return batch->finished == total; });
+}
+} // namespace tiny_lsm
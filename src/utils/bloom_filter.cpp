@@ -31,8 +31,10 @@ BloomFilter::BloomFilter(size_t expected_elements, double false_positive_rate)
 
 void BloomFilter::add(const std::string &key) {
   // TODO: Lab 4.9: 添加一个记录到布隆过滤器中
+  size_t h1 = hash1(key);
+  size_t h2 = hash2(key);
   for (size_t i = 0; i < num_hashes_; ++i) {
-    size_t idx = hash(key, i) % num_bits_;
+    size_t idx = combine_hash(h1, h2, i) % num_bits_;
     bits_[idx] = 1;
   }
 }
@@ -40,8 +42,11 @@ void BloomFilter::add(const std::string &key) {
 //  如果key可能存在于布隆过滤器中，返回true；否则返回false
 bool BloomFilter::possibly_contains(const std::string &key) const {
   // TODO: Lab 4.9: 检查一个记录是否可能存在于布隆过滤器中
+  // 点查路径上每次都会调用, 两个基础哈希只计算一次
+  size_t h1 = hash1(key);
+  size_t h2 = hash2(key);
   for (size_t i = 0; i < num_hashes_; ++i) {
-    size_t idx = hash(key, i) % num_bits_;
+    size_t idx = combine_hash(h1, h2, i) % num_bits_;
     if (bits_[idx] != 1)
       return false;
   }
@@ -65,8 +70,11 @@ size_t BloomFilter::hash(const std::string &key, size_t idx) const {
   // TODO: Lab 4.9: 计算哈希值
   // ? idx 标识这是第几个哈希函数
   // ? 你需要按照某些方式, 从 hash1 和 hash2 中组合成新的哈希函数
-  auto tmp = hash2(key);
-  return (hash1(key) + idx * (tmp != 0 ? tmp : 1));
+  return combine_hash(hash1(key), hash2(key), idx);
+}
+
+size_t BloomFilter::combine_hash(size_t h1, size_t h2, size_t idx) const {
+  return (h1 + idx * (h2 != 0 ? h2 : 1));
 }
 
 // 编码布隆过滤器为 std::vector<uint8_t>
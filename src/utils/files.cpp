@@ -9,7 +9,8 @@ FileObj::~FileObj() = default;
 
 // 实现移动语义
 FileObj::FileObj(FileObj &&other) noexcept
-    : m_file(std::move(other.m_file)), m_size(other.m_size) {
+    : m_file(std::move(other.m_file)), m_size(other.m_size),
+      m_mmap(std::move(other.m_mmap)) {
   other.m_size = 0;
 }
 
@@ -17,16 +18,29 @@ FileObj &FileObj::operator=(FileObj &&other) noexcept {
   if (this != &other) {
     m_file = std::move(other.m_file);
     m_size = other.m_size;
+    m_mmap = std::move(other.m_mmap);
     other.m_size = 0;
   }
   return *this;
 }
 
-size_t FileObj::size() const { return m_file->size(); }
+size_t FileObj::size() const {
+  // 只读映射的文件大小不会改变
+  if (m_mmap != nullptr) {
+    return m_mmap->size();
+  }
+  return m_file->size();
+}
 
 void FileObj::set_size(size_t size) { m_size = size; }
 
-void FileObj::del_file() { m_file->remove(); }
+void FileObj::del_file() {
+  if (m_mmap != nullptr) {
+    m_mmap->remove();
+    return;
+  }
+  m_file->remove();
+}
 FileObj FileObj::create_and_write(const std::string &path,
                                   std::vector<uint8_t> buf) {
   FileObj file_obj;
@@ -51,7 +65,40 @@ FileObj FileObj::open(const std::string &path, bool create) {
   return std::move(file_obj);
 }
 
+FileObj FileObj::open_mmap(const std::string &path) {
+  // 所有读取都经过映射, 不需要再打开普通的文件
+  FileObj file_obj;
+
+  auto mmap_file = std::make_shared<MmapFile>();
+  if (!mmap_file->open_readonly(path)) {
+    throw std::runtime_error("Failed to mmap file: " + path);
+  }
+  file_obj.m_mmap = std::move(mmap_file);
+
+  return file_obj;
+}
+
+std::shared_ptr<const uint8_t> FileObj::mapped_slice(size_t offset,
+                                                     size_t length) {
+  if (m_mmap == nullptr) {
+    return nullptr;
+  }
+  if (offset + length > m_mmap->size()) {
+    throw std::out_of_range("Read beyond file size");
+  }
+  // 别名构造: 指向映射内的地址, 同时共享映射的所有权
+  return std::shared_ptr<const uint8_t>(m_mmap, m_mmap->data_at(offset));
+}
+
 std::vector<uint8_t> FileObj::read_to_slice(size_t offset, size_t length) {
+  if (m_mmap != nullptr) {
+    if (offset + length > m_mmap->size()) {
+      throw std::out_of_range("Read beyond file size");
+    }
+    const uint8_t *src = m_mmap->data_at(offset);
+    return std::vector<uint8_t>(src, src + length);
+  }
+
   // 检查边界
   if (offset + length > m_file->size()) {
     throw std::out_of_range("Read beyond file size");
@@ -63,14 +110,29 @@ std::vector<uint8_t> FileObj::read_to_slice(size_t offset, size_t length) {
   return result;
 }
 
+std::vector<uint8_t> FileObj::pread_to_slice(size_t offset, size_t length) {
+  if (m_mmap != nullptr) {
+    return read_to_slice(offset, length);
+  }
+  return m_file->pread(offset, length);
+}
+
+bool FileObj::is_mapped() const { return m_mmap != nullptr; }
+
+void FileObj::advise_willneed(size_t offset, size_t length) {
+  if (m_mmap != nullptr) {
+    m_mmap->advise_willneed(offset, length);
+  }
+}
+
 uint8_t FileObj::read_uint8(size_t offset) {
   // 检查边界
-  if (offset + sizeof(uint8_t) > m_file->size()) {
+  if (offset + sizeof(uint8_t) > size()) {
     throw std::out_of_range("Read beyond file size");
   }
 
   // 从w文件复制数据
-  auto result = m_file->read(offset, sizeof(uint8_t));
+  auto result = read_to_slice(offset, sizeof(uint8_t));
 
   // 将数据转换为uint8_t
   return result[0];
@@ -78,21 +140,21 @@ uint8_t FileObj::read_uint8(size_t offset) {
 
 uint16_t FileObj::read_uint16(size_t offset) {
   // 检查边界
-  if (offset + sizeof(uint16_t) > m_file->size()) {
+  if (offset + sizeof(uint16_t) > size()) {
     throw std::out_of_range("Read beyond file size");
   }
-  auto result = m_file->read(offset, sizeof(uint16_t));
+  auto result = read_to_slice(offset, sizeof(uint16_t));
   return *(uint16_t *)result.data();
 }
 
 uint32_t FileObj::read_uint32(size_t offset) {
   // 检查边界
-  if (offset + sizeof(uint32_t) > m_file->size()) {
+  if (offset + sizeof(uint32_t) > size()) {
     throw std::out_of_range("Read beyond file size");
   }
 
   // 从w文件复制数据
-  auto result = m_file->read(offset, sizeof(uint32_t));
+  auto result = read_to_slice(offset, sizeof(uint32_t));
 
   // 将数据转换为uint32_t
   return *(uint32_t *)result.data();
@@ -100,12 +162,12 @@ uint32_t FileObj::read_uint32(size_t offset) {
 
 uint64_t FileObj::read_uint64(size_t offset) {
   // 检查边界
-  if (offset + sizeof(uint64_t) > m_file->size()) {
+  if (offset + sizeof(uint64_t) > size()) {
     throw std::out_of_range("Read beyond file size");
   }
 
   // 从w文件复制数据
-  auto result = m_file->read(offset, sizeof(uint64_t));
+  auto result = read_to_slice(offset, sizeof(uint64_t));
 
   // 将数据转换为uint64_t
   return *(uint64_t *)result.data();
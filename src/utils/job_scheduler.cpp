@@ -0,0 +1,169 @@
+#include "../../include/utils/job_scheduler.h"
+#include <algorithm>
+#include <exception>
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace tiny_lsm {
+
+JobScheduler::JobScheduler(size_t high_threads, size_t low_threads) {
+  // 每个线程池至少一个线程, 保证提交的任务总能执行
+  high_threads = std::max<size_t>(high_threads, 1);
+  low_threads = std::max<size_t>(low_threads, 1);
+  for (size_t i = 0; i < high_threads; i++) {
+    high_.threads.emplace_back(
+        [this]() { worker_loop_(JobPriority::HIGH); });
+  }
+  for (size_t i = 0; i < low_threads; i++) {
+    low_.threads.emplace_back([this]() { worker_loop_(JobPriority::LOW); });
+  }
+}
+
+JobScheduler::~JobScheduler() { shutdown(); }
+
+JobScheduler::Pool &JobScheduler::pool_(JobPriority priority) {
+  return priority == JobPriority::HIGH ? high_ : low_;
+}
+
+bool JobScheduler::schedule(JobPriority priority, std::function<void()> job) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stop_) {
+      return false;
+    }
+    pool_(priority).jobs.push_back(std::move(job));
+  }
+  cv_.notify_all();
+  return true;
+}
+
+bool JobScheduler::schedule_after(JobPriority priority,
+                                  std::chrono::milliseconds delay,
+                                  std::function<void()> job) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stop_) {
+      return false;
+    }
+    delayed_.push_back(DelayedJob{std::chrono::steady_clock::now() + delay,
+                                  priority, std::move(job)});
+  }
+  // 唤醒等待中的线程, 按新的到期时间重新等待
+  cv_.notify_all();
+  return true;
+}
+
+void JobScheduler::promote_due_jobs_() {
+  auto now = std::chrono::steady_clock::now();
+  bool promoted = false;
+  for (auto it = delayed_.begin(); it != delayed_.end();) {
+    if (it->due <= now) {
+      pool_(it->priority).jobs.push_back(std::move(it->job));
+      it = delayed_.erase(it);
+      promoted = true;
+    } else {
+      ++it;
+    }
+  }
+  if (promoted) {
+    cv_.notify_all();
+  }
+}
+
+size_t JobScheduler::shutdown() {
+  size_t dropped = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stop_ && high_.threads.empty() && low_.threads.empty()) {
+      return 0;
+    }
+    stop_ = true;
+    dropped = high_.jobs.size() + low_.jobs.size() + delayed_.size();
+    high_.jobs.clear();
+    low_.jobs.clear();
+    delayed_.clear();
+  }
+  cv_.notify_all();
+  idle_cv_.notify_all();
+  for (auto *pool : {&high_, &low_}) {
+    for (auto &thread : pool->threads) {
+      if (thread.joinable() &&
+          thread.get_id() != std::this_thread::get_id()) {
+        thread.join();
+      }
+    }
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  high_.threads.clear();
+  low_.threads.clear();
+  return dropped;
+}
+
+bool JobScheduler::is_shutting_down() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stop_;
+}
+
+bool JobScheduler::idle_() const {
+  return high_.jobs.empty() && low_.jobs.empty() && delayed_.empty() &&
+         high_.running == 0 && low_.running == 0;
+}
+
+void JobScheduler::wait_for_idle() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  idle_cv_.wait(lock, [this]() { return stop_ || idle_(); });
+}
+
+size_t JobScheduler::pending(JobPriority priority) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return pool_(priority).jobs.size();
+}
+
+void JobScheduler::worker_loop_(JobPriority priority) {
+#ifdef __linux__
+  if (priority == JobPriority::LOW) {
+    // Linux 的 nice 值是线程级别的, 只影响当前线程
+    setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 19);
+  }
+#endif
+  auto &pool = pool_(priority);
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    promote_due_jobs_();
+    if (stop_) {
+      return;
+    }
+    if (pool.jobs.empty()) {
+      if (delayed_.empty()) {
+        cv_.wait(lock);
+      } else {
+        // 最早的延迟任务到期时醒来, 由任意线程将其移入线程池
+        auto due = std::min_element(delayed_.begin(), delayed_.end(),
+                                    [](const auto &lhs, const auto &rhs) {
+                                      return lhs.due < rhs.due;
+                                    })
+                       ->due;
+        cv_.wait_until(lock, due);
+      }
+      continue;
+    }
+    auto job = std::move(pool.jobs.front());
+    pool.jobs.pop_front();
+    pool.running++;
+    lock.unlock();
+    try {
+      job();
+    } catch (...) {
+      // 任务需要自行处理错误, 这里只保证线程不会退出
+    }
+    lock.lock();
+    pool.running--;
+    if (idle_()) {
+      idle_cv_.notify_all();
+    }
+  }
+}
+} // namespace tiny_lsm
@@ -1,5 +1,6 @@
 #include "../../include/utils/mmap_file.h"
 #include <cstdint>
+#include <cstdio>
 #include <errno.h>
 #include <stdexcept>
 #include <string.h>
@@ -43,6 +44,47 @@ bool MmapFile::open(const std::string &filename, bool create) {
   return true;
 }
 
+bool MmapFile::open_readonly(const std::string &filename) {
+  filename_ = filename;
+
+  fd_ = ::open(filename.c_str(), O_RDONLY);
+  if (fd_ == -1) {
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd_, &st) == -1) {
+    close();
+    return false;
+  }
+  file_size_ = st.st_size;
+
+  if (file_size_ > 0) {
+    mapped_data_ = mmap(nullptr, file_size_, PROT_READ, MAP_SHARED, fd_, 0);
+    if (mapped_data_ == MAP_FAILED) {
+      mapped_data_ = nullptr;
+      close();
+      return false;
+    }
+  }
+  // 映射建立后不再需要描述符, 只读映射也不会再写入或 sync
+  ::close(fd_);
+  fd_ = -1;
+
+  return true;
+}
+
+void MmapFile::advise_willneed(size_t offset, size_t length) const {
+  if (mapped_data_ == nullptr || length == 0) {
+    return;
+  }
+  // madvise 要求起始地址按页对齐
+  static const size_t page_size = sysconf(_SC_PAGESIZE);
+  size_t begin = offset / page_size * page_size;
+  madvise(static_cast<uint8_t *>(mapped_data_) + begin, offset + length - begin,
+          MADV_WILLNEED);
+}
+
 bool MmapFile::create(const std::string &filename, std::vector<uint8_t> &buf) {
   // 创建文件，设置大小并映射到内存
   if (!create_and_map(filename, buf.size())) {
@@ -116,6 +158,8 @@ bool MmapFile::sync() {
   return true;
 }
 
+bool MmapFile::remove() { return std::remove(filename_.c_str()) == 0; }
+
 // ********************* private *********************
 
 bool MmapFile::create_and_map(const std::string &path, size_t size) {
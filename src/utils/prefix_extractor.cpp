@@ -0,0 +1,40 @@
+#include "../../include/utils/prefix_extractor.h"
+#include <algorithm>
+
+namespace tiny_lsm {
+
+PrefixExtractor::PrefixExtractor(size_t stride, size_t max_len)
+    : stride_(stride), max_len_(stride == 0 ? 0 : max_len / stride * stride) {}
+
+bool PrefixExtractor::enabled() const { return stride_ > 0 && max_len_ > 0; }
+
+size_t PrefixExtractor::stride() const { return stride_; }
+
+size_t PrefixExtractor::max_len() const { return max_len_; }
+
+void PrefixExtractor::new_prefixes(std::string_view prev, std::string_view key,
+                                   std::vector<std::string_view> &out) const {
+  out.clear();
+  if (!enabled()) {
+    return;
+  }
+  // 计算与上一个 key 的公共前缀长度
+  auto limit = std::min({prev.size(), key.size(), max_len_});
+  size_t common = 0;
+  while (common < limit && prev[common] == key[common]) {
+    common++;
+  }
+  auto end = std::min(key.size(), max_len_);
+  for (size_t len = (common / stride_ + 1) * stride_; len <= end;
+       len += stride_) {
+    out.push_back(key.substr(0, len));
+  }
+}
+
+size_t PrefixExtractor::query_len(size_t prefix_len) const {
+  if (!enabled()) {
+    return 0;
+  }
+  return std::min(prefix_len, max_len_) / stride_ * stride_;
+}
+} // namespace tiny_lsm
@@ -0,0 +1,137 @@
+#include "../../include/utils/row_cache.h"
+#include <algorithm>
+#include <functional>
+#include <mutex>
+
+namespace tiny_lsm {
+
+// 每个缓存项除 key 和 value 外的估计开销 (链表节点, 哈希表节点等)
+static constexpr size_t ROW_CACHE_ITEM_OVERHEAD = 96;
+
+RowCache::RowCache(size_t capacity_bytes, size_t num_shards) {
+  num_shards = std::max<size_t>(1, num_shards);
+  shard_capacity_ = capacity_bytes / num_shards;
+  shards_.reserve(num_shards);
+  for (size_t i = 0; i < num_shards; i++) {
+    shards_.push_back(std::make_unique<Shard>());
+  }
+}
+
+RowCache::~RowCache() = default;
+
+RowCache::Shard &RowCache::get_shard(const std::string &key) {
+  return *shards_[std::hash<std::string>{}(key) % shards_.size()];
+}
+
+bool RowCache::lookup(const std::string &key, uint64_t tranc_id,
+                      std::optional<std::pair<std::string, uint64_t>> &value) {
+  total_requests_.fetch_add(1, std::memory_order_relaxed);
+  auto &shard = get_shard(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.map.find(key);
+  if (it == shard.map.end()) {
+    return false;
+  }
+
+  const auto &item = *it->second;
+  // 最新版本对该快照不可见, 需要查询 lsm 获取更旧的版本
+  if (tranc_id != 0 && item.tranc_id > tranc_id) {
+    return false;
+  }
+
+  hit_requests_.fetch_add(1, std::memory_order_relaxed);
+  shard.lru_list.splice(shard.lru_list.begin(), shard.lru_list, it->second);
+  if (item.found) {
+    value = std::make_pair(item.value, item.tranc_id);
+  } else {
+    value = std::nullopt;
+  }
+  return true;
+}
+
+uint64_t RowCache::generation(const std::string &key) {
+  auto &shard = get_shard(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  return shard.generation;
+}
+
+void RowCache::insert(
+    const std::string &key,
+    const std::optional<std::pair<std::string, uint64_t>> &version,
+    uint64_t generation) {
+  Item item;
+  item.key = key;
+  item.tranc_id = version.has_value() ? version->second : 0;
+  item.found = version.has_value();
+  if (item.found) {
+    item.value = version->first;
+  }
+  item.charge = key.size() + item.value.size() + ROW_CACHE_ITEM_OVERHEAD;
+  if (item.charge > shard_capacity_) {
+    return;
+  }
+
+  auto &shard = get_shard(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  if (shard.generation != generation) {
+    // 查询期间发生了写入, 结果可能已经过期
+    return;
+  }
+
+  auto it = shard.map.find(key);
+  if (it != shard.map.end()) {
+    erase_(shard, it);
+  }
+  while (!shard.lru_list.empty() &&
+         shard.usage + item.charge > shard_capacity_) {
+    erase_(shard, shard.map.find(shard.lru_list.back().key));
+  }
+
+  shard.usage += item.charge;
+  shard.lru_list.push_front(std::move(item));
+  shard.map[key] = shard.lru_list.begin();
+}
+
+void RowCache::invalidate(const std::string &key) {
+  auto &shard = get_shard(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  shard.generation++;
+  auto it = shard.map.find(key);
+  if (it != shard.map.end()) {
+    erase_(shard, it);
+  }
+}
+
+void RowCache::clear() {
+  for (auto &shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    shard->generation++;
+    shard->map.clear();
+    shard->lru_list.clear();
+    shard->usage = 0;
+  }
+}
+
+size_t RowCache::size_bytes() const {
+  size_t total = 0;
+  for (auto &shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    total += shard->usage;
+  }
+  return total;
+}
+
+double RowCache::hit_rate() const {
+  auto total = total_requests_.load(std::memory_order_relaxed);
+  return total == 0 ? 0.0
+                    : static_cast<double>(hit_requests_.load(
+                          std::memory_order_relaxed)) /
+                          total;
+}
+
+void RowCache::erase_(Shard &shard, ItemMap::iterator it) {
+  shard.usage -= it->second->charge;
+  shard.lru_list.erase(it->second);
+  shard.map.erase(it);
+}
+} // namespace tiny_lsm
@@ -1,4 +1,6 @@
 #include "../../include/utils/std_file.h"
+#include <fcntl.h>
+#include <unistd.h>
 
 namespace tiny_lsm {
 
@@ -11,6 +13,9 @@ bool StdFile::open(const std::string &filename, bool create) {
   } else {
     file_.open(filename, std::ios::in | std::ios::out | std::ios::binary);
   }
+  if (file_.is_open() && read_fd_ == -1) {
+    read_fd_ = ::open(filename.c_str(), O_RDONLY);
+  }
 
   return file_.is_open();
 }
@@ -31,6 +36,10 @@ void StdFile::close() {
     sync();
     file_.close();
   }
+  if (read_fd_ != -1) {
+    ::close(read_fd_);
+    read_fd_ = -1;
+  }
 }
 
 size_t StdFile::size() {
@@ -47,6 +56,22 @@ std::vector<uint8_t> StdFile::read(size_t offset, size_t length) {
   return buf;
 }
 
+std::vector<uint8_t> StdFile::pread(size_t offset, size_t length) {
+  if (read_fd_ == -1) {
+    throw std::runtime_error("Failed to read from file");
+  }
+  std::vector<uint8_t> buf(length);
+  size_t done = 0;
+  while (done < length) {
+    auto n = ::pread(read_fd_, buf.data() + done, length - done, offset + done);
+    if (n <= 0) {
+      throw std::runtime_error("Failed to read from file");
+    }
+    done += n;
+  }
+  return buf;
+}
+
 bool StdFile::write(size_t offset, const void *data, size_t size) {
   file_.seekg(offset, std::ios::beg);
   file_.write(static_cast<const char *>(data), size);
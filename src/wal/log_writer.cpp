@@ -0,0 +1,142 @@
+#include "../../include/wal/log_writer.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace tiny_lsm {
+
+LogWriter::~LogWriter() { close(); }
+
+LogWriter::LogWriter(LogWriter &&other) noexcept
+    : fd_(other.fd_), path_(std::move(other.path_)),
+      file_size_(other.file_size_), allocated_(other.allocated_),
+      preallocate_size_(other.preallocate_size_),
+      buffer_(std::move(other.buffer_)),
+      buffer_capacity_(other.buffer_capacity_) {
+  other.fd_ = -1;
+}
+
+LogWriter &LogWriter::operator=(LogWriter &&other) noexcept {
+  if (this != &other) {
+    close();
+    fd_ = other.fd_;
+    path_ = std::move(other.path_);
+    file_size_ = other.file_size_;
+    allocated_ = other.allocated_;
+    preallocate_size_ = other.preallocate_size_;
+    buffer_ = std::move(other.buffer_);
+    buffer_capacity_ = other.buffer_capacity_;
+    other.fd_ = -1;
+  }
+  return *this;
+}
+
+LogWriter LogWriter::open(const std::string &path, size_t preallocate_size,
+                          size_t buffer_capacity) {
+  LogWriter writer;
+  writer.fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+  if (writer.fd_ == -1) {
+    throw std::runtime_error("Failed to open log file: " + path);
+  }
+  struct stat st;
+  if (::fstat(writer.fd_, &st) != 0) {
+    throw std::runtime_error("Failed to stat log file: " + path);
+  }
+  writer.path_ = path;
+  writer.file_size_ = st.st_size;
+  writer.allocated_ = st.st_size;
+  writer.preallocate_size_ = preallocate_size;
+  writer.buffer_capacity_ = buffer_capacity;
+  writer.buffer_.reserve(buffer_capacity);
+  return writer;
+}
+
+size_t LogWriter::size() const { return file_size_ + buffer_.size(); }
+
+void LogWriter::append(const uint8_t *data, size_t length) {
+  if (buffer_.size() + length > buffer_capacity_) {
+    flush();
+  }
+  if (length >= buffer_capacity_) {
+    // 超过缓冲区容量的数据直接写入, 避免额外的复制
+    write_(data, length);
+    return;
+  }
+  buffer_.insert(buffer_.end(), data, data + length);
+}
+
+void LogWriter::append(const std::vector<uint8_t> &buf) {
+  append(buf.data(), buf.size());
+}
+
+void LogWriter::flush() {
+  if (buffer_.empty()) {
+    return;
+  }
+  write_(buffer_.data(), buffer_.size());
+  buffer_.clear();
+}
+
+bool LogWriter::sync() {
+  if (fd_ == -1) {
+    return false;
+  }
+  flush();
+  return ::fdatasync(fd_) == 0;
+}
+
+void LogWriter::close() {
+  if (fd_ == -1) {
+    return;
+  }
+  try {
+    sync();
+  } catch (...) {
+    // 析构时无法报告错误, 未写入的数据会丢失
+  }
+  ::close(fd_);
+  fd_ = -1;
+}
+
+void LogWriter::write_(const uint8_t *data, size_t length) {
+  if (fd_ == -1) {
+    throw std::runtime_error("Log file is not open");
+  }
+  preallocate_(file_size_ + length);
+  size_t done = 0;
+  while (done < length) {
+    auto n = ::pwrite(fd_, data + done, length - done, file_size_ + done);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::runtime_error("Failed to write log file: " + path_ + ": " +
+                               std::strerror(errno));
+    }
+    done += n;
+  }
+  file_size_ += length;
+}
+
+void LogWriter::preallocate_(size_t end) {
+  if (preallocate_size_ == 0 || end <= allocated_) {
+    return;
+  }
+  // 按 preallocate_size_ 对齐扩展预分配的范围
+  size_t new_allocated =
+      (end + preallocate_size_ - 1) / preallocate_size_ * preallocate_size_;
+#ifdef __linux__
+  if (::fallocate(fd_, FALLOC_FL_KEEP_SIZE, allocated_,
+                  new_allocated - allocated_) != 0) {
+    // 文件系统不支持时退化为普通的追加写入
+    preallocate_size_ = 0;
+    return;
+  }
+#endif
+  allocated_ = new_allocated;
+}
+} // namespace tiny_lsm
@@ -4,6 +4,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <stdexcept>
 #include <string>
 
 namespace tiny_lsm {
@@ -96,42 +97,64 @@ std::vector<uint8_t> Record::encode() const {
 
 std::vector<Record> Record::decode(const std::vector<uint8_t> &data) {
   // TODO: Lab 5.3 实现Record的解码函数
-  const uint8_t *pos = data.data();
-  const uint8_t *end = data.data() + data.size();
   std::vector<Record> res;
-  while (pos < end) {
-    Record record;
-    uint16_t rec_len;
-    uint64_t trac_id;
-    OperationType ot;
-    memcpy(&record.record_len_, pos, sizeof(uint16_t));
-    pos += sizeof(uint16_t);
+  size_t pos = 0;
+  while (pos < data.size()) {
+    auto record = decode_one(data.data() + pos, data.size() - pos);
+    if (!record.has_value()) {
+      throw std::runtime_error("Record::decode: incomplete record");
+    }
+    pos += record->record_len_;
+    res.emplace_back(std::move(*record));
+  }
 
-    memcpy(&record.tranc_id_, pos, sizeof(uint64_t));
-    pos += sizeof(uint64_t);
+  return res;
+}
 
-    memcpy(&record.operation_type_, pos, sizeof(OperationType));
-    pos += sizeof(OperationType);
+std::optional<Record> Record::decode_one(const uint8_t *data, size_t size) {
+  constexpr size_t header_len =
+      sizeof(uint16_t) + sizeof(uint64_t) + sizeof(OperationType);
+  if (size < sizeof(uint16_t)) {
+    return std::nullopt;
+  }
+  Record record;
+  memcpy(&record.record_len_, data, sizeof(uint16_t));
+  if (record.record_len_ < header_len) {
+    throw std::runtime_error("Record::decode_one: invalid record length");
+  }
+  if (size < record.record_len_) {
+    return std::nullopt;
+  }
+  const uint8_t *pos = data + sizeof(uint16_t);
+  const uint8_t *end = data + record.record_len_;
 
-    if (record.operation_type_ == OperationType::PUT ||
-        record.operation_type_ == OperationType::DELETE) {
-      uint16_t str_len;
-      memcpy(&str_len, pos, sizeof(uint16_t));
-      pos += sizeof(uint16_t);
-      record.key_.assign(reinterpret_cast<const char *>(pos), str_len);
-      pos += str_len;
+  memcpy(&record.tranc_id_, pos, sizeof(uint64_t));
+  pos += sizeof(uint64_t);
+
+  memcpy(&record.operation_type_, pos, sizeof(OperationType));
+  pos += sizeof(OperationType);
+
+  auto read_str = [&](std::string &out) {
+    uint16_t str_len;
+    if (end - pos < static_cast<ptrdiff_t>(sizeof(uint16_t))) {
+      throw std::runtime_error("Record::decode_one: corrupted record");
     }
-    if (record.operation_type_ == OperationType::PUT) {
-      uint16_t str_len;
-      memcpy(&str_len, pos, sizeof(uint16_t));
-      pos += sizeof(uint16_t);
-      record.value_.assign(reinterpret_cast<const char *>(pos), str_len);
-      pos += str_len;
+    memcpy(&str_len, pos, sizeof(uint16_t));
+    pos += sizeof(uint16_t);
+    if (end - pos < str_len) {
+      throw std::runtime_error("Record::decode_one: corrupted record");
     }
-    res.emplace_back(record);
+    out.assign(reinterpret_cast<const char *>(pos), str_len);
+    pos += str_len;
+  };
+  if (record.operation_type_ == OperationType::PUT ||
+      record.operation_type_ == OperationType::DELETE) {
+    read_str(record.key_);
   }
-
-  return res;
+  if (record.operation_type_ == OperationType::PUT) {
+    read_str(record.value_);
+  }
+  return record;
 }
 void Record::print() const {
   std::cout << "Record: tranc_id=" << tranc_id_
@@ -1,15 +1,38 @@
 // src/wal/wal.cpp
 
+#include "../../include/config/config.h"
+#include "../../include/utils/files.h"
 #include "../../include/wal/wal.h"
+#include "spdlog/spdlog.h"
 #include <algorithm>
 #include <cstdint>
+#include <fcntl.h>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <stdexcept>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace tiny_lsm {
 
+namespace {
+// 重放时每次读取的数据量
+constexpr size_t REPLAY_CHUNK_SIZE = 1024 * 1024;
+
+// 新建或删除段文件后同步目录, 保证目录项落盘
+void sync_dir(const std::string &dir) {
+  int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+  if (fd == -1) {
+    return;
+  }
+  ::fsync(fd);
+  ::close(fd);
+}
+} // namespace
+
 // 从零开始的初始化流程
 WAL::WAL(const std::string &log_dir, size_t buffer_size,
          uint64_t max_finished_tranc_id, uint64_t clean_interval,
@@ -17,14 +40,25 @@ WAL::WAL(const std::string &log_dir, size_t buffer_size,
     : file_size_limit_(file_size_limit), buffer_size_(buffer_size),
       max_finished_tranc_id_(max_finished_tranc_id),
       clean_interval_(clean_interval), stop_cleaner_(false) {
+  auto &config = TomlConfig::getInstance();
+  group_commit_max_size_ = static_cast<size_t>(
+      std::max(1, config.getLsmWalGroupCommitMaxSize()));
+  group_commit_max_wait_us_ = static_cast<uint64_t>(
+      std::max(0, config.getLsmWalGroupCommitMaxWaitUs()));
   // TODO Lab 5.4 : 实现WAL的初始化流程
   if (!std::filesystem::exists(log_dir)) {
     std::filesystem::create_directories(log_dir);
   }
-  active_log_path_ = (std::filesystem::path(log_dir) / "wal.log").string();
-  // If wal.log already exists, open without truncation; otherwise create it
-  bool create = !std::filesystem::exists(active_log_path_);
-  log_file_ = FileObj::open(active_log_path_, create);
+  log_dir_ = log_dir;
+  // 上次运行留下的段不再写入, 新的记录写到编号更大的新段中
+  auto segments = list_segments_(log_dir_);
+  for (auto &[seq, path] : segments) {
+    sealed_segments_[seq] = Segment{path, std::nullopt};
+  }
+  active_seq_ = segments.empty() ? 1 : segments.rbegin()->first + 1;
+  active_log_path_ = segment_path_(log_dir_, active_seq_);
+  log_file_ = LogWriter::open(active_log_path_);
+  sync_dir(log_dir_);
   cleaner_thread_ = std::thread(&WAL::cleaner, this);
 }
 
@@ -32,24 +66,24 @@ WAL::~WAL() {
   // TODO Lab 5.4 : 实现WAL的清理流程
   // TODO Lab 5.4 : 实现WAL的清理流程
 
-  // 1. 处理线程
+  // 1. 处理线程, 等待正在执行的清理任务结束并使之后的任务失效
+  if (clean_state_ != nullptr) {
+    std::lock_guard<std::mutex> lock(clean_state_->mutex);
+    clean_state_->wal = nullptr;
+  }
   if (cleaner_thread_.joinable()) {
     // 如果有清理线程在运行，等待它结束
     // 注意：这里需要确保cleaner()函数有退出机制
     // 比如通过atomic标志位让cleaner()自己退出
-    stop_cleaner_ = true;
+    {
+      std::lock_guard<std::mutex> lock(cleaner_mtx_);
+      stop_cleaner_ = true;
+    }
+    cleaner_cv_.notify_all();
     cleaner_thread_.join();
   }
-  // 2.获取锁，确保没有其他操作在进行
-  std::lock_guard<std::mutex> lock(mutex_);
-
-  // 3. 强制刷新缓冲区中的剩余数据
-  if (!log_buffer_.empty()) {
-    // 这里应该调用flush()，但注意flush()内部也会获取锁
-    // 由于我们已经持有锁，需要避免死锁
-    // 可以创建一个不锁的flush实现，或者在这里直接写文件
-    flush(); // 假设flush能处理重入问题
-  }
+  // 2. 强制刷新缓冲区中的剩余数据, flush 内部会获取锁
+  flush();
 
   // 4. 文件对象会自己关闭，不需要手动操作
   // FileObj的析构函数会自动关闭文件
@@ -58,68 +92,462 @@ WAL::~WAL() {
 std::map<uint64_t, std::vector<Record>>
 WAL::recover(const std::string &log_dir, uint64_t max_flushed_tranc_id) {
   // TODO: Lab 5.5 检查需要重放的WAL日志
-  auto file_path = (std::filesystem::path(log_dir) / "wal.log").string();
+  std::map<uint64_t, std::vector<Record>> res;
+  replay(log_dir, max_flushed_tranc_id,
+         [&res](uint64_t tranc_id, std::vector<Record> &records) {
+           res[tranc_id] = std::move(records);
+         });
+  return res;
+}
 
-  // 如果文件不存在，返回空 map
-  if (!std::filesystem::exists(file_path)) {
-    return {};
+void WAL::replay(const std::string &log_dir, uint64_t max_flushed_tranc_id,
+                 const ReplayCallback &callback, size_t threads) {
+  // 已经全部 flush 的段会被清理线程删除, 这里只需读取剩余的段
+  std::vector<std::string> paths;
+  for (auto &[seq, path] : list_segments_(log_dir)) {
+    paths.push_back(path);
   }
 
-  auto wal_file_ = FileObj::open(file_path, false);
+  using Committed = std::vector<std::pair<uint64_t, std::vector<Record>>>;
+  // 解码一个段, 返回其中按 tranc_id 排序的已提交事务
+  auto decode_segment = [&](const std::string &path) {
+    Committed committed;
+    // 只缓存尚未看到 COMMIT 的事务
+    std::unordered_map<uint64_t, std::vector<Record>> pending;
+    scan_segment_(path, [&](Record &record) {
+      auto tranc_id = record.getTrancId();
+      if (tranc_id <= max_flushed_tranc_id) {
+        return;
+      }
+      switch (record.getOperationType()) {
+      case OperationType::COMMIT: {
+        std::vector<Record> records;
+        auto it = pending.find(tranc_id);
+        if (it != pending.end()) {
+          records = std::move(it->second);
+          pending.erase(it);
+        }
+        records.push_back(std::move(record));
+        committed.emplace_back(tranc_id, std::move(records));
+        break;
+      }
+      case OperationType::ROLLBACK:
+        pending.erase(tranc_id);
+        break;
+      default:
+        pending[tranc_id].push_back(std::move(record));
+      }
+    });
+    std::stable_sort(
+        committed.begin(), committed.end(),
+        [](const auto &lhs, const auto &rhs) { return lhs.first < rhs.first; });
+    return committed;
+  };
+  auto apply = [&](Committed &committed) {
+    for (auto &[tranc_id, records] : committed) {
+      callback(tranc_id, records);
+    }
+  };
 
-  // 如果文件为空，返回空 map
-  if (wal_file_.size() == 0) {
-    return {};
+  threads = std::min(threads, paths.size());
+  if (threads <= 1) {
+    for (auto &path : paths) {
+      auto committed = decode_segment(path);
+      apply(committed);
+    }
+    return;
   }
 
-  auto data = Record::decode(wal_file_.read_to_slice(0, wal_file_.size()));
+  // 多个线程并行解码, 当前线程按段的顺序应用, 保证新的事务总是在旧的事务
+  // 之后写入. 解码最多领先应用 threads 个段, 限制缓存的事务数量
+  struct Slot {
+    bool done = false;
+    Committed committed;
+    std::exception_ptr error;
+  };
+  std::vector<Slot> slots(paths.size());
+  std::mutex mtx;
+  std::condition_variable cv;
+  size_t next = 0;    // 下一个待解码的段
+  size_t applied = 0; // 已经应用的段数
+  bool abort = false;
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < threads; i++) {
+    workers.emplace_back([&]() {
+      while (true) {
+        size_t idx;
+        {
+          std::unique_lock<std::mutex> lock(mtx);
+          cv.wait(lock, [&]() {
+            return abort || next >= paths.size() || next < applied + threads;
+          });
+          if (abort || next >= paths.size()) {
+            return;
+          }
+          idx = next++;
+        }
+        Slot slot;
+        slot.done = true;
+        try {
+          slot.committed = decode_segment(paths[idx]);
+        } catch (...) {
+          slot.error = std::current_exception();
+        }
+        {
+          std::lock_guard<std::mutex> lock(mtx);
+          slots[idx] = std::move(slot);
+        }
+        cv.notify_all();
+      }
+    });
+  }
 
-  std::map<uint64_t, std::vector<Record>> res;
-  for (auto &record : data) {
-    auto trac_id = record.getTrancId();
-    if (trac_id > max_flushed_tranc_id) {
-      res[trac_id].emplace_back(record);
+  std::exception_ptr error;
+  for (size_t i = 0; i < paths.size() && !error; i++) {
+    Committed committed;
+    {
+      std::unique_lock<std::mutex> lock(mtx);
+      cv.wait(lock, [&]() { return slots[i].done; });
+      error = slots[i].error;
+      committed = std::move(slots[i].committed);
+    }
+    if (!error) {
+      try {
+        apply(committed);
+      } catch (...) {
+        error = std::current_exception();
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      applied = i + 1;
+      abort = error != nullptr;
     }
+    cv.notify_all();
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
   }
-  return res;
 }
 
-void WAL::log(const std::vector<Record> &records, bool force_flush) {
-  // TODO Lab 5.4 : 实现WAL的写入流程
-  std::lock_guard<std::mutex> lock(mutex_);
-  if (buffer_size_ < log_buffer_.size() + records.size()) {
-    throw std::runtime_error("WAL Buffer File Size has arrived limt");
+void WAL::scan_segment_(const std::string &path,
+                        const std::function<void(Record &)> &fn) {
+  auto file = FileObj::open(path, false);
+  size_t file_size = file.size();
+  size_t offset = 0;
+  // buf 中 pos 之前的数据已经解码
+  std::vector<uint8_t> buf;
+  size_t pos = 0;
+  while (true) {
+    std::optional<Record> record;
+    if (pos < buf.size()) {
+      try {
+        record = Record::decode_one(buf.data() + pos, buf.size() - pos);
+      } catch (const std::exception &e) {
+        spdlog::warn("WAL--scan_segment_(): stop at corrupted record in {}: {}",
+                     path, e.what());
+        return;
+      }
+    }
+    if (record.has_value()) {
+      pos += record->getRecordLen();
+      fn(*record);
+      continue;
+    }
+    if (offset >= file_size) {
+      break;
+    }
+    // 保留不完整的记录, 读取下一块
+    buf.erase(buf.begin(), buf.begin() + pos);
+    pos = 0;
+    size_t length = std::min(REPLAY_CHUNK_SIZE, file_size - offset);
+    auto chunk = file.pread_to_slice(offset, length);
+    buf.insert(buf.end(), chunk.begin(), chunk.end());
+    offset += length;
+  }
+  if (pos < buf.size()) {
+    spdlog::warn("WAL--scan_segment_(): ignore {} trailing bytes in {}",
+                 buf.size() - pos, path);
+  }
+}
+
+void WAL::set_max_flushed_tranc_id(uint64_t tranc_id) {
+  max_flushed_tranc_id_.store(tranc_id);
+  if (scheduler_ == nullptr || clean_scheduled_.exchange(true)) {
+    return;
+  }
+  auto scheduled =
+      scheduler_->schedule(JobPriority::LOW, [state = clean_state_]() {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->wal == nullptr) {
+          return;
+        }
+        // 先清除标记, 清理期间更新的 max_flushed_tranc_id 会提交新的任务
+        state->wal->clean_scheduled_ = false;
+        try {
+          state->wal->clean_flushed_segments();
+        } catch (const std::exception &e) {
+          spdlog::error("WAL--clean job: failed to clean segments: {}",
+                        e.what());
+        }
+      });
+  if (!scheduled) {
+    clean_scheduled_ = false;
+  }
+}
+
+void WAL::set_scheduler(std::shared_ptr<JobScheduler> scheduler) {
+  if (cleaner_thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(cleaner_mtx_);
+      stop_cleaner_ = true;
+    }
+    cleaner_cv_.notify_all();
+    cleaner_thread_.join();
+  }
+  clean_state_ = std::make_shared<CleanState>();
+  clean_state_->wal = this;
+  scheduler_ = std::move(scheduler);
+  // 上次运行留下的段可能已经可以删除
+  set_max_flushed_tranc_id(max_flushed_tranc_id_.load());
+}
+
+void WAL::clean_flushed_segments() {
+  // 上次运行留下的段需要读取一次才能知道其中最大的 tranc_id
+  std::vector<std::pair<uint64_t, std::string>> unknown;
+  {
+    std::lock_guard<std::mutex> lock(segments_mtx_);
+    for (auto &[seq, segment] : sealed_segments_) {
+      if (!segment.max_tranc_id.has_value()) {
+        unknown.emplace_back(seq, segment.path);
+      }
+    }
+  }
+  for (auto &[seq, path] : unknown) {
+    uint64_t max_tranc_id = 0;
+    scan_segment_(path, [&max_tranc_id](Record &record) {
+      max_tranc_id = std::max(max_tranc_id, record.getTrancId());
+    });
+    std::lock_guard<std::mutex> lock(segments_mtx_);
+    sealed_segments_[seq].max_tranc_id = max_tranc_id;
+  }
+
+  auto max_flushed_tranc_id = max_flushed_tranc_id_.load();
+  std::vector<std::string> removable;
+  {
+    std::lock_guard<std::mutex> lock(segments_mtx_);
+    for (auto it = sealed_segments_.begin(); it != sealed_segments_.end();) {
+      auto &max_tranc_id = it->second.max_tranc_id;
+      if (max_tranc_id.has_value() && *max_tranc_id <= max_flushed_tranc_id) {
+        removable.push_back(it->second.path);
+        it = sealed_segments_.erase(it);
+      } else {
+        ++it;
+      }
+    }
   }
-  log_buffer_.insert(log_buffer_.end(), records.begin(), records.end());
-  if (force_flush) {
-    flush();
+  if (removable.empty()) {
+    return;
   }
+  for (auto &path : removable) {
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+  }
+  sync_dir(log_dir_);
+}
+
+size_t WAL::segment_count() {
+  std::lock_guard<std::mutex> lock(segments_mtx_);
+  return sealed_segments_.size() + 1;
+}
+
+std::map<uint64_t, std::string>
+WAL::list_segments_(const std::string &log_dir) {
+  std::map<uint64_t, std::string> segments;
+  if (!std::filesystem::exists(log_dir)) {
+    return segments;
+  }
+  for (auto &entry : std::filesystem::directory_iterator(log_dir)) {
+    if (!entry.is_regular_file()) {
+      continue;
+    }
+    auto name = entry.path().filename().string();
+    // 段文件名为 wal.<seq>.log
+    if (name.size() <= 8 || name.rfind("wal.", 0) != 0 ||
+        name.compare(name.size() - 4, 4, ".log") != 0) {
+      continue;
+    }
+    auto seq_str = name.substr(4, name.size() - 8);
+    if (!std::all_of(seq_str.begin(), seq_str.end(),
+                     [](char c) { return c >= '0' && c <= '9'; })) {
+      continue;
+    }
+    segments[std::stoull(seq_str)] = entry.path().string();
+  }
+  return segments;
+}
+
+std::string WAL::segment_path_(const std::string &log_dir, uint64_t seq) {
+  return (std::filesystem::path(log_dir) /
+          ("wal." + std::to_string(seq) + ".log"))
+      .string();
+}
+
+void WAL::roll_segment_() {
+  auto next_seq = active_seq_ + 1;
+  auto next_path = segment_path_(log_dir_, next_seq);
+  auto next_file = LogWriter::open(next_path);
+  sync_dir(log_dir_);
+  {
+    std::lock_guard<std::mutex> lock(segments_mtx_);
+    sealed_segments_[active_seq_] =
+        Segment{active_log_path_, active_max_tranc_id_};
+  }
+  // 旧段在移动赋值时 sync 并关闭
+  log_file_ = std::move(next_file);
+  active_seq_ = next_seq;
+  active_log_path_ = next_path;
+  active_max_tranc_id_ = 0;
+}
+
+void WAL::log(const std::vector<Record> &records, bool force_flush,
+              bool sync) {
+  // TODO Lab 5.4 : 实现WAL的写入流程
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!force_flush) {
+    if (log_buffer_.size() + records.size() <= buffer_size_) {
+      log_buffer_.insert(log_buffer_.end(), records.begin(), records.end());
+      return;
+    }
+    // 缓冲区已满, 与缓冲区中的记录一起写入文件
+  }
+  group_commit_(lock, records, force_flush && sync);
 }
 
 // commit 时 强制写入
 void WAL::flush() {
   // TODO Lab 5.4 : 强制刷盘
-  // ? 取决于你的 log 实现是否使用了缓冲区或者异步的实现
-  if (file_size_limit_ < log_file_.size() + log_buffer_.size()) {
-    throw std::runtime_error("WAL File Size has arrived limt");
+  // 以空记录参与一次组提交, 缓冲区中的记录由所在组的 leader 写入,
+  // 之前未 sync 的写入也一并落盘
+  std::unique_lock<std::mutex> lock(mutex_);
+  group_commit_(lock, {}, true);
+}
+
+void WAL::group_commit_(std::unique_lock<std::mutex> &lock,
+                        const std::vector<Record> &records, bool sync) {
+  Writer w;
+  w.records = &records;
+  w.sync = sync;
+  writers_.push_back(&w);
+  if (writers_.size() > 1) {
+    // leader 可能正在等待组内凑满, 唤醒它检查
+    writers_.front()->cv.notify_one();
   }
+
+  w.cv.wait(lock, [&]() { return w.done || writers_.front() == &w; });
+  if (w.done) {
+    if (w.error) {
+      std::rethrow_exception(w.error);
+    }
+    return;
+  }
+
+  // 成为 leader, 可选地等待更多提交者加入本组
+  if (group_commit_max_wait_us_ > 0 &&
+      writers_.size() < group_commit_max_size_) {
+    w.cv.wait_for(lock, std::chrono::microseconds(group_commit_max_wait_us_),
+                  [&]() { return writers_.size() >= group_commit_max_size_; });
+  }
+
+  size_t group_size = std::min(writers_.size(), group_commit_max_size_);
+  std::vector<Writer *> group(writers_.begin(),
+                              writers_.begin() + group_size);
+
+  // 缓冲区中未强制写入的记录先于本组的记录落盘. 解锁期间其他线程可能
+  // 继续向缓冲区追加, 因此只在持锁时编码, 成功后只移除已写入的部分
+  bool need_sync = false;
+  for (auto *writer : group) {
+    need_sync |= writer->sync;
+  }
+
+  size_t buffered = log_buffer_.size();
+  uint64_t max_tranc_id = 0;
   std::vector<uint8_t> res;
   for (auto &record : log_buffer_) {
     auto data = record.encode();
     res.insert(res.end(), data.begin(), data.end());
+    max_tranc_id = std::max(max_tranc_id, record.getTrancId());
+  }
+
+  std::exception_ptr error;
+  lock.unlock();
+  try {
+    for (auto *writer : group) {
+      for (auto &record : *writer->records) {
+        auto data = record.encode();
+        res.insert(res.end(), data.begin(), data.end());
+        max_tranc_id = std::max(max_tranc_id, record.getTrancId());
+      }
+    }
+    if (!res.empty()) {
+      // 当前段写满后切换到新段, 一组记录总是写在同一个段中
+      if (log_file_.size() > 0 &&
+          log_file_.size() + res.size() > file_size_limit_) {
+        roll_segment_();
+      }
+      log_file_.append(res);
+      active_max_tranc_id_ = std::max(active_max_tranc_id_, max_tranc_id);
+    }
+    if (!need_sync) {
+      log_file_.flush();
+    } else if (!log_file_.sync()) {
+      throw std::runtime_error("WAL File Flush sync raise error");
+    }
+  } catch (...) {
+    error = std::current_exception();
+  }
+  lock.lock();
+
+  if (!error) {
+    log_buffer_.erase(log_buffer_.begin(), log_buffer_.begin() + buffered);
+  }
+  // 持锁时唤醒, 保证 follower 返回 (Writer 析构) 前 notify 已经完成
+  for (auto *writer : group) {
+    writers_.pop_front();
+    if (writer != &w) {
+      writer->done = true;
+      writer->error = error;
+      writer->cv.notify_one();
+    }
+  }
+  if (!writers_.empty()) {
+    writers_.front()->cv.notify_one();
+  }
+  if (error) {
+    std::rethrow_exception(error);
   }
-  log_file_.write(log_file_.size(), res);
-  if (!log_file_.sync()) {
-    throw std::runtime_error("WAL File Flush sync raise error");
-  };
-  log_buffer_.clear();
 }
 
 void WAL::cleaner() {
   // TODO Lab 5.4 : 实现WAL的清理线程
   while (!stop_cleaner_) {
-    std::this_thread::sleep_for(std::chrono::seconds(clean_interval_));
-    // Lab 5.5 再实现真正的清理逻辑
+    {
+      std::unique_lock<std::mutex> lock(cleaner_mtx_);
+      cleaner_cv_.wait_for(lock, std::chrono::seconds(clean_interval_),
+                           [this]() { return stop_cleaner_.load(); });
+    }
+    if (stop_cleaner_) {
+      break;
+    }
+    try {
+      clean_flushed_segments();
+    } catch (const std::exception &e) {
+      // 清理失败不影响写入, 下一轮重试
+      spdlog::error("WAL--cleaner(): failed to clean segments: {}", e.what());
+    }
   }
 }
 
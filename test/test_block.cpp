@@ -3,9 +3,11 @@
 #include "../include/config/config.h"
 #include "../include/consts.h"
 #include "../include/logger/logger.h"
+#include <cstring>
 #include <gtest/gtest.h>
 #include <iomanip>
 #include <memory>
+#include <sstream>
 #include <vector>
 
 using namespace ::tiny_lsm;
@@ -113,7 +115,99 @@ TEST_F(BlockTest, EncodeTest) {
   EXPECT_EQ(decoded->get_value_binary("orange", 3).value(), "orange3");
 }
 
+// 测试带哈希索引的编码
+TEST_F(BlockTest, HashIndexTest) {
+  Block block(8192);
+  for (int i = 0; i < 100; i++) {
+    std::ostringstream oss;
+    oss << "key" << std::setw(3) << std::setfill('0') << i;
+    // 每个 key 有两个版本, 事务 id 从大到小排列
+    block.add_entry(oss.str(), "new" + std::to_string(i), 2, false);
+    block.add_entry(oss.str(), "old" + std::to_string(i), 1, false);
+  }
+
+  auto encoded = block.encode(true);
+  EXPECT_GT(encoded.size(), block.encode().size());
+
+  auto decoded = Block::decode(encoded);
+  EXPECT_TRUE(decoded->has_hash_index());
+  EXPECT_FALSE(Block::decode(block.encode())->has_hash_index());
+
+  for (int i = 0; i < 100; i++) {
+    std::ostringstream oss;
+    oss << "key" << std::setw(3) << std::setfill('0') << i;
+    BlockIterator latest(decoded, oss.str(), 0);
+    ASSERT_FALSE(latest.is_end());
+    EXPECT_EQ(latest->second, "new" + std::to_string(i));
+    BlockIterator snapshot(decoded, oss.str(), 1);
+    ASSERT_FALSE(snapshot.is_end());
+    EXPECT_EQ(snapshot->second, "old" + std::to_string(i));
+
+    // 二分查找的结果与哈希索引一致
+    EXPECT_EQ(decoded->get_value_binary(oss.str(), 1).value(),
+              "old" + std::to_string(i));
+  }
+
+  // 不存在的 key
+  EXPECT_FALSE(decoded->get_idx("key100", 0).has_value());
+  EXPECT_FALSE(decoded->get_idx("key0505", 0).has_value());
+  EXPECT_FALSE(decoded->get_idx("", 0).has_value());
+
+  // 所有版本都不可见时仍然报告 key 存在, 用于区分布隆过滤器误判
+  Block versions(4096);
+  versions.add_entry("a", "v", 5, false);
+  for (bool with_hash : {true, false}) {
+    auto b = Block::decode(versions.encode(with_hash));
+    bool exists = false;
+    EXPECT_FALSE(b->get_idx("a", 3, &exists).has_value());
+    EXPECT_TRUE(exists);
+    EXPECT_TRUE(b->get_idx("a", 5, &exists).has_value());
+    EXPECT_TRUE(exists);
+    EXPECT_FALSE(b->get_idx("b", 3, &exists).has_value());
+    EXPECT_FALSE(exists);
+  }
+}
+
 // 测试二分查找
+// 零拷贝解码的 block 与普通解码的行为一致
+TEST_F(BlockTest, DecodeViewTest) {
+  Block block(8192);
+  for (int i = 0; i < 100; i++) {
+    std::ostringstream oss;
+    oss << "key" << std::setw(3) << std::setfill('0') << i;
+    block.add_entry(oss.str(), "value" + std::to_string(i), i, false);
+  }
+
+  for (bool with_hash_index : {false, true}) {
+    auto encoded = block.encode(with_hash_index);
+    auto buffer = std::shared_ptr<uint8_t>(new uint8_t[encoded.size()],
+                                           std::default_delete<uint8_t[]>());
+    memcpy(buffer.get(), encoded.data(), encoded.size());
+    auto view = Block::decode_view(buffer, encoded.size());
+    buffer.reset(); // block 持有内存的所有权
+
+    auto decoded = Block::decode(encoded);
+    EXPECT_EQ(view->size(), decoded->size());
+    EXPECT_EQ(view->has_hash_index(), with_hash_index);
+    EXPECT_EQ(view->get_first_key(), "key000");
+    for (int i = 0; i < 100; i++) {
+      std::ostringstream oss;
+      oss << "key" << std::setw(3) << std::setfill('0') << i;
+      EXPECT_EQ(view->get_value_binary(oss.str(), 0).value(),
+                "value" + std::to_string(i));
+      EXPECT_EQ(view->get_idx(oss.str(), 0), decoded->get_idx(oss.str(), 0));
+    }
+    EXPECT_FALSE(view->get_idx("key100", 0).has_value());
+
+    int count = 0;
+    for (auto it = view->begin(); it != view->end(); ++it) {
+      count++;
+    }
+    EXPECT_EQ(count, 100);
+    EXPECT_THROW(view->encode(), std::runtime_error);
+  }
+}
+
 TEST_F(BlockTest, BinarySearchTest) {
   Block block(1024);
   block.add_entry("apple", "red", 0, false);
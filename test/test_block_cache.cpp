@@ -95,6 +95,33 @@ TEST_F(BlockCacheTest, HitRate) {
   EXPECT_EQ(cache->hit_rate(), 2.0 / 3.0);
 }
 
+TEST_F(BlockCacheTest, MetaPriority) {
+  auto meta1 = std::make_shared<CacheEntry>();
+  auto meta2 = std::make_shared<CacheEntry>();
+  auto block1 = std::make_shared<Block>();
+  auto block2 = std::make_shared<Block>();
+  auto block3 = std::make_shared<Block>();
+
+  cache->put_meta(1, 0, meta1);
+  cache->put(1, 1, block1);
+  cache->put(1, 2, block2);
+
+  // 插入 block3 时优先淘汰低优先级的 block1, 元数据项保留
+  cache->put(1, 3, block3);
+  EXPECT_EQ(cache->get_meta(1, 0), meta1);
+  EXPECT_EQ(cache->get(1, 1), nullptr);
+
+  // 元数据项与 block_id 相同的 data block 互不影响
+  EXPECT_EQ(cache->get_meta(1, 2), nullptr);
+
+  // 高优先级池已满, 新的元数据项替换旧的元数据项
+  cache->put_meta(1, 1, meta2);
+  EXPECT_EQ(cache->get_meta(1, 0), nullptr);
+  EXPECT_EQ(cache->get_meta(1, 1), meta2);
+  EXPECT_EQ(cache->get(1, 2), block2);
+  EXPECT_EQ(cache->get(1, 3), block3);
+}
+
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
   init_spdlog_file();
@@ -1,4 +1,5 @@
 #include "../include/block/blockmeta.h"
+#include "../include/block/fence_index.h"
 #include "../include/logger/logger.h"
 #include <gtest/gtest.h>
 
@@ -166,6 +167,37 @@ TEST_F(BlockMetaTest, OrderTest) {
   }
 }
 
+// 栅栏索引测试
+TEST_F(BlockMetaTest, FenceIndexTest) {
+  auto metas = createTestMetas();
+  FenceIndex index(metas);
+  ASSERT_EQ(index.size(), metas.size());
+
+  // 最短分隔 key 满足 prev < sep <= next
+  for (size_t i = 1; i < metas.size(); i++) {
+    auto sep = FenceIndex::shortest_separator(metas[i - 1].last_key,
+                                              metas[i].first_key);
+    EXPECT_LT(metas[i - 1].last_key, sep);
+    EXPECT_LE(sep, metas[i].first_key);
+  }
+  EXPECT_EQ(FenceIndex::shortest_separator("abc", "abd"), "abd");
+  EXPECT_EQ(FenceIndex::shortest_separator("ab", "abcde"), "abc");
+  EXPECT_EQ(FenceIndex::shortest_separator("a199", "a200"), "a2");
+
+  // 每个 block 的首尾 key 都应定位到自身
+  for (size_t i = 0; i < metas.size(); i++) {
+    EXPECT_EQ(index.find(metas[i].first_key), i);
+    EXPECT_EQ(index.find(metas[i].last_key), i);
+  }
+
+  // 小于第一个 block 的 key 找不到
+  EXPECT_EQ(index.find("a0"), static_cast<size_t>(-1));
+
+  // block 之间无序时索引为空
+  std::swap(metas[0], metas[1]);
+  EXPECT_EQ(FenceIndex(metas).size(), 0);
+}
+
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
   init_spdlog_file();
@@ -1,10 +1,12 @@
 #include "../include/consts.h"
 #include "../include/logger/logger.h"
 #include "../include/lsm/engine.h"
+#include "../include/lsm/level_iterator.h"
 #include <cstdlib>
 #include <filesystem>
 #include <gtest/gtest.h>
 #include <iostream>
+#include <string>
 
 using namespace ::tiny_lsm;
 
@@ -78,6 +80,74 @@ TEST_F(CompactTest, Persistence) {
   EXPECT_FALSE(lsm.get("nonexistent").has_value());
 }
 
+TEST_F(CompactTest, Subcompaction) {
+  // 每轮写入的 key 交错分布在整个 key 空间, l0 的 sst 之间相互重叠,
+  // 累计的数据量足够让 l0 -> l1 的 compaction 拆分为多个子任务
+  int num = 48000;
+  int rounds = 6;
+  std::string padding(1000, 'v');
+  auto make_key = [](int i) {
+    std::ostringstream oss;
+    oss << "key" << std::setw(6) << std::setfill('0') << i;
+    return oss.str();
+  };
+
+  auto check_levels = [](const Version &version) {
+    for (size_t level = 1; level < version.levels.size(); level++) {
+      auto &level_ssts = version.levels[level];
+      for (size_t i = 1; i < level_ssts.size(); i++) {
+        EXPECT_LT(level_ssts[i - 1]->get_last_key(),
+                  level_ssts[i]->get_first_key());
+      }
+    }
+  };
+
+  {
+    auto engine = std::make_shared<LSMEngine>(test_dir);
+    for (int round = 0; round < rounds; round++) {
+      for (int i = round; i < num; i += rounds) {
+        engine->put(make_key(i), std::to_string(i) + padding, 0);
+      }
+    }
+    // 覆盖写和删除, 较新的数据需要在各个范围中保持优先
+    for (int i = 0; i < num; i += 100) {
+      engine->put(make_key(i), "new" + std::to_string(i), 0);
+      engine->remove(make_key(i + 1), 0);
+    }
+    engine->flush().wait();
+    engine->wait_for_background_jobs();
+
+    auto version = engine->get_version();
+    ASSERT_GT(version->levels.size(), 1);
+    check_levels(*version);
+  }
+
+  // 重新加载后非 l0 层仍然按 key 排序
+  auto engine = std::make_shared<LSMEngine>(test_dir);
+  check_levels(*engine->get_version());
+  for (int i = 0; i < num; i++) {
+    auto res = engine->get(make_key(i), 0);
+    if (i % 100 == 1) {
+      EXPECT_FALSE(res.has_value());
+    } else if (i % 100 == 0) {
+      ASSERT_TRUE(res.has_value());
+      EXPECT_EQ(res->first, "new" + std::to_string(i));
+    } else {
+      ASSERT_TRUE(res.has_value()) << make_key(i);
+      EXPECT_EQ(res->first, std::to_string(i) + padding);
+    }
+  }
+
+  auto it = engine->begin(0);
+  int count = 0;
+  std::string prev;
+  for (; it.is_valid() && !it.is_end(); ++it, ++count) {
+    EXPECT_LT(prev, it.key());
+    prev = it.key();
+  }
+  EXPECT_EQ(count, num - num / 100);
+}
+
 int main(int argc, char **argv) {
   testing::InitGoogleTest(&argc, argv);
   init_spdlog_file();
@@ -1,6 +1,9 @@
+#include "../include/config/config.h"
 #include "../include/logger/logger.h"
 #include "../include/lsm/engine.h"
 #include "../include/lsm/level_iterator.h"
+#include "../include/wal/wal.h"
+#include <atomic>
 #include <cstdlib>
 #include <filesystem>
 #include <gtest/gtest.h>
@@ -165,6 +168,271 @@ TEST_F(LSMTest, IteratorOperations) {
   EXPECT_EQ(it == lsm.end(), ref_it == reference.end());
 }
 
+TEST_F(LSMTest, IteratorViews) {
+  auto lsm = std::make_shared<LSMEngine>(test_dir);
+  std::map<std::string, std::string> reference;
+
+  // 数据分布在 sst 和 memtable 中, 并包含覆盖写和删除
+  for (int i = 0; i < 200; i++) {
+    std::string key = "key" + std::to_string(i);
+    std::string value = "value" + std::to_string(i);
+    lsm->put(key, value, 0);
+    reference[key] = value;
+    if (i % 50 == 49) {
+      lsm->flush().wait();
+    }
+  }
+  for (int i = 0; i < 200; i += 3) {
+    std::string key = "key" + std::to_string(i);
+    lsm->put(key, "new_value" + std::to_string(i), 0);
+    reference[key] = "new_value" + std::to_string(i);
+  }
+  for (int i = 1; i < 200; i += 7) {
+    std::string key = "key" + std::to_string(i);
+    lsm->remove(key, 0);
+    reference.erase(key);
+  }
+
+  auto it = lsm->begin(0);
+  auto ref_it = reference.begin();
+  while (it.is_valid() && ref_it != reference.end()) {
+    EXPECT_EQ(it.key(), ref_it->first);
+    EXPECT_EQ(it.value(), ref_it->second);
+    auto kv = *it;
+    EXPECT_EQ(it.key(), kv.first);
+    EXPECT_EQ(it.value(), kv.second);
+    ++it;
+    ++ref_it;
+  }
+  EXPECT_FALSE(it.is_valid());
+  EXPECT_EQ(ref_it, reference.end());
+}
+
+TEST_F(LSMTest, IteratorSnapshot) {
+  auto lsm = std::make_shared<LSMEngine>(test_dir);
+  lsm->put("key1", "value1", 1);
+  lsm->put("key2", "value2", 2);
+  lsm->flush().wait();
+  lsm->put("key1", "value1_new", 3);
+  lsm->remove("key2", 4);
+  lsm->memtable.frozen_cur_table();
+  lsm->put("key3", "value3", 5);
+
+  auto scan = [&](uint64_t tranc_id) {
+    std::vector<std::pair<std::string, std::string>> result;
+    for (auto it = lsm->begin(tranc_id); it.is_valid(); ++it) {
+      result.emplace_back(it.key(), it.value());
+    }
+    return result;
+  };
+
+  using KVs = std::vector<std::pair<std::string, std::string>>;
+  EXPECT_EQ(scan(2), (KVs{{"key1", "value1"}, {"key2", "value2"}}));
+  EXPECT_EQ(scan(3), (KVs{{"key1", "value1_new"}, {"key2", "value2"}}));
+  EXPECT_EQ(scan(4), (KVs{{"key1", "value1_new"}}));
+  EXPECT_EQ(scan(0), (KVs{{"key1", "value1_new"}, {"key3", "value3"}}));
+}
+
+TEST_F(LSMTest, VersionSnapshot) {
+  auto lsm = std::make_shared<LSMEngine>(test_dir);
+  std::map<std::string, std::string> reference;
+
+  // 前两轮写入刷盘, 之后的写入留在 memtable 中, 最后一轮在活跃表中
+  char buf[16];
+  std::shared_ptr<const Version> old_version;
+  for (int round = 0; round < 8; round++) {
+    for (int i = round; i < 400; i += 4) {
+      snprintf(buf, sizeof(buf), "key%04d", i);
+      std::string value = "value" + std::to_string(round);
+      lsm->put(buf, value, 0);
+      reference[buf] = value;
+    }
+    if (round < 2) {
+      lsm->flush().wait();
+    } else if (round < 7) {
+      lsm->memtable.frozen_cur_table();
+    }
+    if (round == 1) {
+      old_version = lsm->get_version();
+    }
+  }
+  ASSERT_EQ(old_version->levels[0].size(), 2);
+
+  auto it = lsm->begin(0);
+  auto ref_it = reference.begin();
+  for (int i = 0; i < 50; i++, ++it, ++ref_it) {
+    ASSERT_TRUE(it.is_valid());
+    EXPECT_EQ(it.key(), ref_it->first);
+  }
+
+  // 迭代器持有的版本不阻塞刷盘和 compaction
+  lsm->flush().wait();
+  EXPECT_EQ(lsm->memtable.get_total_size(), 0);
+  // compaction 在刷盘之后由低优先级任务执行
+  lsm->wait_for_background_jobs();
+  auto new_version = lsm->get_version();
+  EXPECT_NE(new_version, old_version);
+  EXPECT_GT(new_version->levels.size(), 1);
+
+  // 被 compaction 移除的 sst 在旧版本中仍然可读
+  for (auto &sst : old_version->levels[0]) {
+    EXPECT_TRUE(sst->get(sst->get_first_key(), 0).is_valid());
+  }
+
+  for (; ref_it != reference.end(); ++it, ++ref_it) {
+    ASSERT_TRUE(it.is_valid());
+    EXPECT_EQ(it.key(), ref_it->first);
+    EXPECT_EQ(it.value(), ref_it->second);
+  }
+  EXPECT_FALSE(it.is_valid());
+
+  for (auto &[key, value] : reference) {
+    EXPECT_EQ(lsm->get(key, 0).value().first, value);
+  }
+}
+
+TEST_F(LSMTest, BackgroundFlush) {
+  auto lsm = std::make_shared<LSMEngine>(test_dir);
+  std::atomic<int> flush_cnt{0};
+  lsm->set_flush_listener([&](uint64_t) { flush_cnt++; });
+
+  // 写入超过多个 memtable 的数据量, 写满的表由后台线程刷盘
+  const int num = 60000;
+  std::string value(200, 'v');
+  char buf[16];
+  for (int i = 0; i < num; i++) {
+    snprintf(buf, sizeof(buf), "key%06d", i);
+    lsm->put(buf, value + std::to_string(i), i + 1);
+  }
+
+  auto handle = lsm->flush();
+  EXPECT_EQ(handle.get(), num);
+  EXPECT_EQ(lsm->memtable.get_total_size(), 0);
+  EXPECT_GT(flush_cnt.load(), 1);
+
+  // 没有需要刷盘的数据时请求立即完成
+  auto empty_handle = lsm->flush();
+  EXPECT_EQ(empty_handle.wait_for(std::chrono::seconds(0)),
+            std::future_status::ready);
+
+  for (int i = 0; i < num; i += 997) {
+    snprintf(buf, sizeof(buf), "key%06d", i);
+    EXPECT_EQ(lsm->get(buf, 0).value().first, value + std::to_string(i));
+  }
+}
+
+TEST_F(LSMTest, RangeScan) {
+  auto lsm = std::make_shared<LSMEngine>(test_dir);
+  std::map<std::string, std::string> reference;
+
+  // 多次刷盘触发 compaction, 使数据分布在 memtable, L0 和更深的层中
+  char buf[16];
+  for (int round = 0; round < 6; round++) {
+    for (int i = round; i < 600; i += 3) {
+      snprintf(buf, sizeof(buf), "key%04d", i);
+      std::string value =
+          "value" + std::to_string(i) + "_" + std::to_string(round);
+      lsm->put(buf, value, 0);
+      reference[buf] = value;
+    }
+    lsm->flush().wait();
+  }
+  for (int i = 0; i < 600; i += 11) {
+    snprintf(buf, sizeof(buf), "key%04d", i);
+    lsm->remove(buf, 0);
+    reference.erase(buf);
+  }
+  // compaction 不阻塞刷盘, 等待后台任务完成后再检查 sst 布局
+  lsm->wait_for_background_jobs();
+  EXPECT_GT(lsm->level_sst_ids.size(), 1);
+
+  auto check = [&](const std::string &lower, const std::string &upper) {
+    auto ref_it = reference.lower_bound(lower);
+    auto ref_end =
+        upper.empty() ? reference.end() : reference.lower_bound(upper);
+    if (!upper.empty() && upper < lower) {
+      ref_end = ref_it;
+    }
+    auto it = lsm->scan(lower, upper, 0);
+    for (; it.is_valid() && ref_it != ref_end; ++it, ++ref_it) {
+      EXPECT_EQ(it.key(), ref_it->first);
+      EXPECT_EQ(it.value(), ref_it->second);
+    }
+    EXPECT_FALSE(it.is_valid());
+    EXPECT_EQ(ref_it, ref_end);
+  };
+
+  check("", "");
+  check("key0100", "key0200");
+  check("key0101", "key0102");
+  check("key0150x", "key0300");
+  check("key0590", "");
+  check("key0700", "");
+  check("a", "key0010");
+  check("key0200", "key0100"); // 空范围
+
+  // seek 之后保持上界
+  auto it = lsm->scan("key0000", "key0300", 0);
+  it.seek("key0250");
+  auto ref_it = reference.lower_bound("key0250");
+  auto ref_end = reference.lower_bound("key0300");
+  for (; it.is_valid() && ref_it != ref_end; ++it, ++ref_it) {
+    EXPECT_EQ(it.key(), ref_it->first);
+  }
+  EXPECT_FALSE(it.is_valid());
+  EXPECT_EQ(ref_it, ref_end);
+}
+
+TEST_F(LSMTest, GetBatch) {
+  auto lsm = std::make_shared<LSMEngine>(test_dir);
+  std::map<std::string, std::string> reference;
+
+  // 数据分布在 memtable, L0 和更深的层中, 部分 key 被删除
+  char buf[16];
+  for (int round = 0; round < 6; round++) {
+    for (int i = round; i < 600; i += 3) {
+      snprintf(buf, sizeof(buf), "key%04d", i);
+      std::string value =
+          "value" + std::to_string(i) + "_" + std::to_string(round);
+      lsm->put(buf, value, 0);
+      reference[buf] = value;
+    }
+    lsm->flush().wait();
+  }
+  for (int i = 0; i < 600; i += 11) {
+    snprintf(buf, sizeof(buf), "key%04d", i);
+    lsm->remove(buf, 0);
+    reference[buf] = "";
+  }
+  lsm->put("key0005", "value_mem", 0);
+  reference["key0005"] = "value_mem";
+
+  // 乱序且包含重复和不存在的 key, 结果保持输入顺序
+  std::vector<std::string> keys;
+  for (int i = 650; i >= 0; i -= 7) {
+    snprintf(buf, sizeof(buf), "key%04d", i);
+    keys.push_back(buf);
+  }
+  keys.push_back("key0005");
+  keys.push_back("key0014");
+  keys.push_back("key0014");
+  keys.push_back("a");
+  keys.push_back("zzz");
+
+  auto results = lsm->get_batch(keys, 0);
+  ASSERT_EQ(results.size(), keys.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    EXPECT_EQ(results[i].first, keys[i]);
+    auto ref = reference.find(keys[i]);
+    if (ref == reference.end()) {
+      EXPECT_FALSE(results[i].second.has_value()) << keys[i];
+    } else {
+      ASSERT_TRUE(results[i].second.has_value()) << keys[i];
+      EXPECT_EQ(results[i].second->first, ref->second) << keys[i];
+    }
+  }
+}
+
 TEST_F(LSMTest, MonotonyPredicate) {
   LSM lsm(test_dir);
 
@@ -179,7 +447,7 @@ TEST_F(LSMTest, MonotonyPredicate) {
     lsm.put(key, value);
     if (i == 50) {
       // 主动刷一次盘
-      lsm.flush();
+      lsm.flush().wait();
     }
   }
 
@@ -233,7 +501,7 @@ TEST_F(LSMTest, TrancIdTest) {
     std::string key = oss_key.str();
     lsm.put(key, "tranc1", 1);
   }
-  lsm.flush();
+  lsm.flush().wait();
 
   // key10-key10 再插入, 此时事务id为2
   for (int i = 0; i < 10; i++) {
@@ -269,6 +537,91 @@ TEST_F(LSMTest, TrancIdTest) {
   }
 }
 
+TEST_F(LSMTest, BloomFilterStats) {
+  LSMEngine lsm(test_dir);
+  auto make_key = [](int i) {
+    std::ostringstream oss_key;
+    oss_key << "key" << std::setw(3) << std::setfill('0') << i;
+    return oss_key.str();
+  };
+
+  // 只写入偶数 key, 其中 key100 之后的 key 由较新的事务写入
+  for (int i = 0; i < 200; i += 2) {
+    lsm.put(make_key(i), "value" + std::to_string(i), i < 100 ? 1 : 10);
+  }
+  lsm.flush().wait();
+
+  // 查询 key 范围内不存在的奇数 key, 每次查询要么被布隆过滤器直接过滤,
+  // 要么是一次误判
+  for (int i = 1; i < 199; i += 2) {
+    EXPECT_FALSE(lsm.get(make_key(i), 0).has_value());
+  }
+  auto stats = lsm.get_bloom_filter_stats();
+  ASSERT_FALSE(stats.empty());
+  EXPECT_GT(stats[0].useful, stats[0].false_positive);
+  EXPECT_LE(stats[0].useful + stats[0].false_positive, 99);
+  EXPECT_EQ(stats[0].invisible, 0);
+  auto absent_stats = stats[0];
+
+  // 存在且可见的 key 不影响统计
+  for (int i = 0; i < 200; i += 2) {
+    EXPECT_EQ(lsm.get(make_key(i), 0).value().first,
+              "value" + std::to_string(i));
+  }
+  // 存在但对事务 5 不可见的 key 不计为误判
+  for (int i = 100; i < 200; i += 2) {
+    EXPECT_FALSE(lsm.get(make_key(i), 5).has_value());
+  }
+  stats = lsm.get_bloom_filter_stats();
+  EXPECT_EQ(stats[0].useful, absent_stats.useful);
+  EXPECT_EQ(stats[0].false_positive, absent_stats.false_positive);
+  EXPECT_EQ(stats[0].invisible, 50);
+}
+
+TEST_F(LSMTest, RowCache) {
+  LSMEngine lsm(test_dir);
+  ASSERT_NE(lsm.row_cache, nullptr);
+
+  lsm.put("key1", "value1", 1);
+  lsm.put("key2", "value2", 2);
+  lsm.flush().wait();
+
+  // 第一次查询回填缓存, 之后的查询直接命中
+  EXPECT_EQ(lsm.get("key1", 0).value().first, "value1");
+  EXPECT_FALSE(lsm.get("key3", 0).has_value());
+  EXPECT_EQ(lsm.get("key1", 0).value().first, "value1");
+  EXPECT_FALSE(lsm.get("key3", 0).has_value());
+  EXPECT_GT(lsm.row_cache->hit_rate(), 0.0);
+  EXPECT_GT(lsm.row_cache->size_bytes(), 0);
+
+  // 写入 memtable 后缓存失效
+  lsm.put("key1", "value1_new", 3);
+  lsm.put("key3", "value3", 4);
+  EXPECT_EQ(lsm.get("key1", 0).value().first, "value1_new");
+  EXPECT_EQ(lsm.get("key3", 0).value().first, "value3");
+
+  // 缓存的最新版本对旧快照不可见
+  EXPECT_EQ(lsm.get("key1", 2).value().first, "value1");
+  EXPECT_FALSE(lsm.get("key3", 3).has_value());
+  EXPECT_EQ(lsm.get("key1", 5).value().first, "value1_new");
+
+  lsm.remove("key2", 5);
+  EXPECT_FALSE(lsm.get("key2", 0).has_value());
+  EXPECT_FALSE(lsm.get("key2", 0).has_value());
+  EXPECT_EQ(lsm.get("key2", 4).value().first, "value2");
+
+  auto results = lsm.get_batch({"key1", "key2", "key3", "key4"}, 0);
+  EXPECT_EQ(results[0].second.value().first, "value1_new");
+  EXPECT_EQ(results[1].second.value().first, ""); // 删除标记
+  EXPECT_EQ(results[2].second.value().first, "value3");
+  EXPECT_FALSE(results[3].second.has_value());
+
+  results = lsm.get_batch({"key1", "key2", "key3"}, 3);
+  EXPECT_EQ(results[0].second.value().first, "value1_new");
+  EXPECT_EQ(results[1].second.value().first, "value2");
+  EXPECT_FALSE(results[2].second.has_value());
+}
+
 TEST_F(LSMTest, TranContextTest) {
   LSM lsm(test_dir);
   auto tran_ctx = lsm.begin_tran(IsolationLevel::REPEATABLE_READ);
@@ -335,6 +688,84 @@ TEST_F(LSMTest, Recover) {
     }
   }
 }
+TEST_F(LSMTest, RecoverReplayOrder) {
+  // 直接写入多个 WAL 段, 重放的数据量超过一个 memtable, 重放期间会冻结
+  auto per_mem_limit = static_cast<size_t>(
+      TomlConfig::getInstance().getLsmPerMemSizeLimit());
+  uint64_t tranc_id = 0;
+  {
+    WAL wal(test_dir, 1024, 0, 1, per_mem_limit / 4);
+    std::string filler(100, 'x');
+    size_t written = 0;
+    while (written < per_mem_limit * 2) {
+      tranc_id++;
+      std::vector<Record> records;
+      records.push_back(Record::createRecord(tranc_id));
+      records.push_back(
+          Record::putRecord(tranc_id, "k", "old" + std::to_string(tranc_id)));
+      for (int i = 0; i < 8; i++) {
+        records.push_back(Record::putRecord(
+            tranc_id, "filler" + std::to_string(tranc_id * 8 + i), filler));
+        written += filler.size();
+      }
+      records.push_back(Record::commitRecord(tranc_id));
+      wal.log(records);
+    }
+    tranc_id++;
+    wal.log({Record::createRecord(tranc_id),
+             Record::putRecord(tranc_id, "k", "new"),
+             Record::commitRecord(tranc_id)},
+            true);
+    EXPECT_GT(wal.segment_count(), 4);
+  }
+
+  // 最新的事务在最后重放, 即使旧的值所在的活跃表之后被冻结,
+  // 读取到的也总是最新的值
+  LSM lsm(test_dir);
+  EXPECT_EQ(lsm.get("k", true), "new");
+}
+
+TEST_F(LSMTest, WriteBatch) {
+  LSM lsm(test_dir);
+  lsm.put("key2", "old");
+
+  WriteBatch batch;
+  batch.put("key1", "value1");
+  batch.put("key2", "value2");
+  batch.remove("key2");
+  batch.put("key3", "value3");
+  EXPECT_TRUE(lsm.write(batch));
+
+  EXPECT_EQ(lsm.get("key1").value(), "value1");
+  // 同一 batch 中后写入的删除覆盖之前的 put
+  EXPECT_FALSE(lsm.get("key2").has_value());
+  EXPECT_EQ(lsm.get("key3").value(), "value3");
+
+  WriteBatch no_wal;
+  no_wal.put("key4", "value4");
+  WriteOptions options;
+  options.disable_wal = true;
+  EXPECT_TRUE(lsm.write(no_wal, options));
+  EXPECT_EQ(lsm.get("key4").value(), "value4");
+
+  WriteBatch no_sync;
+  no_sync.put("key5", "value5");
+  options = WriteOptions();
+  options.sync = false;
+  EXPECT_TRUE(lsm.write(no_sync, options));
+
+  // batch 作为一个事务写入 WAL, disable_wal 的写入不出现在 WAL 中
+  auto tranc_records = WAL::recover(test_dir, 0);
+  ASSERT_EQ(tranc_records.size(), 2);
+  auto &records = tranc_records.begin()->second;
+  ASSERT_EQ(records.size(), 6);
+  EXPECT_EQ(records[0].getOperationType(), OperationType::CREATE);
+  EXPECT_EQ(records[2].getKey(), "key2");
+  EXPECT_EQ(records[3].getOperationType(), OperationType::DELETE);
+  EXPECT_EQ(records[5].getOperationType(), OperationType::COMMIT);
+  EXPECT_EQ(tranc_records.rbegin()->second[1].getKey(), "key5");
+}
+
 int main(int argc, char **argv) {
   testing::InitGoogleTest(&argc, argv);
   init_spdlog_file();
@@ -1,5 +1,6 @@
 #include "../include/consts.h"
 #include "../include/iterator/iterator.h"
+#include "../include/iterator/merge_iterator.h"
 #include "../include/logger/logger.h"
 #include "../include/memtable/memtable.h"
 #include <gtest/gtest.h>
@@ -193,6 +194,51 @@ TEST(MemTableTest, IteratorComplexOperations) {
   EXPECT_TRUE(res.get_value().empty());
 }
 
+TEST(MemTableTest, MergeIterator) {
+  // 三个跳表按从新到旧排列
+  auto newest = std::make_shared<SkipList>();
+  newest->put("a", "a3", 5);
+  newest->put("c", "", 4); // 删除标记
+  auto middle = std::make_shared<SkipList>();
+  middle->put("a", "a2", 3);
+  middle->put("b", "b1", 2);
+  auto oldest = std::make_shared<SkipList>();
+  oldest->put("a", "a1", 1);
+  oldest->put("c", "c1", 1);
+  oldest->put("d", "d1", 1);
+
+  auto scan = [&](uint64_t tranc_id, bool filter_empty) {
+    std::vector<std::shared_ptr<BaseIterator>> children;
+    for (auto &table : {newest, middle, oldest}) {
+      children.push_back(std::make_shared<MemTableIterator>(table, tranc_id));
+    }
+    std::vector<std::pair<std::string, std::string>> result;
+    for (MergeIterator it(children, tranc_id, filter_empty); it.is_valid();
+         ++it) {
+      result.emplace_back(it.key(), it.value());
+    }
+    return result;
+  };
+
+  using KVs = std::vector<std::pair<std::string, std::string>>;
+  EXPECT_EQ(scan(0, true), (KVs{{"a", "a3"}, {"b", "b1"}, {"d", "d1"}}));
+  EXPECT_EQ(scan(0, false),
+            (KVs{{"a", "a3"}, {"b", "b1"}, {"c", ""}, {"d", "d1"}}));
+  EXPECT_EQ(scan(3, true),
+            (KVs{{"a", "a2"}, {"b", "b1"}, {"c", "c1"}, {"d", "d1"}}));
+  EXPECT_EQ(scan(1, true), (KVs{{"a", "a1"}, {"c", "c1"}, {"d", "d1"}}));
+
+  // 单个数据源和空的数据源
+  MergeIterator single({std::make_shared<MemTableIterator>(middle, 0)}, 0);
+  ASSERT_TRUE(single.is_valid());
+  EXPECT_EQ(single.key(), "a");
+  ++single;
+  EXPECT_EQ(single.key(), "b");
+  ++single;
+  EXPECT_TRUE(single.is_end());
+  EXPECT_TRUE(MergeIterator({}, 0).is_end());
+}
+
 TEST(MemTableTest, ConcurrentOperations) {
   MemTable memtable;
   const int num_readers = 4;       // 读线程数
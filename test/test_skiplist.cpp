@@ -142,26 +142,98 @@ TEST(SkipListTest, RandomInsertAndRemove) {
 // 测试内存大小跟踪
 TEST(SkipListTest, MemorySizeTracking) {
   SkipList skipList;
+  // 头节点不计入内存大小, 空跳表的大小为 0
+  EXPECT_EQ(skipList.get_size(), 0);
 
   // 插入数据
   skipList.put("key1", "value1", 0);
   skipList.put("key2", "value2", 0);
 
-  // 验证内存大小
-  size_t expected_size = sizeof("key1") - 1 + sizeof("value1") - 1 +
-                         sizeof(uint64_t) + sizeof("key2") - 1 +
-                         sizeof("value2") - 1 + sizeof(uint64_t);
-  EXPECT_EQ(skipList.get_size(), expected_size);
+  // 内存大小为 arena 实际申请的内存, 不小于节点的数据和元信息
+  size_t data_size = sizeof("key1") - 1 + sizeof("value1") - 1 +
+                     sizeof(uint64_t) + sizeof("key2") - 1 +
+                     sizeof("value2") - 1 + sizeof(uint64_t);
+  EXPECT_GE(skipList.get_size(), data_size + 2 * sizeof(SkipListNode));
 
-  // 删除数据
+  // 删除的节点在 arena 释放前不会归还内存
+  size_t size_before_remove = skipList.get_size();
   skipList.remove("key1");
-  expected_size -= sizeof("key1") - 1 + sizeof("value1") - 1 + sizeof(uint64_t);
-  EXPECT_EQ(skipList.get_size(), expected_size);
+  EXPECT_EQ(skipList.get_size(), size_before_remove);
+
+  // 大量写入时按节点的实际占用增长
+  const int num_elements = 10000;
+  for (int i = 0; i < num_elements; ++i) {
+    skipList.put("key" + std::to_string(i), "value" + std::to_string(i), 0);
+  }
+  EXPECT_GE(skipList.get_size(), num_elements * sizeof(SkipListNode));
+  EXPECT_LE(skipList.get_size(), num_elements * 256);
 
   skipList.clear();
   EXPECT_EQ(skipList.get_size(), 0);
 }
 
+// 测试内存池的分配和内存统计
+TEST(SkipListTest, Arena) {
+  Arena arena(4096);
+  EXPECT_EQ(arena.memory_usage(), 0);
+
+  // 小对象在同一块中连续分配, 地址按 8 字节对齐
+  char *a = arena.allocate(3);
+  char *b = arena.allocate(10);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(a) % 8, 0);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(b) % 8, 0);
+  EXPECT_EQ(b - a, 8);
+  size_t usage = arena.memory_usage();
+  EXPECT_GE(usage, 4096);
+
+  // 当前块放不下的大对象单独分配一块, 当前块的剩余空间继续使用
+  arena.allocate(5000);
+  EXPECT_GE(arena.memory_usage(), usage + 5000);
+  char *c = arena.allocate(8);
+  EXPECT_EQ(c - b, 16);
+}
+
+// 多个线程并发分配, 返回的内存互不重叠
+TEST(SkipListTest, ArenaConcurrentAllocate) {
+  Arena arena(4096);
+  const int num_threads = 8;
+  const int allocs_per_thread = 5000;
+  std::vector<std::vector<std::pair<char *, size_t>>> allocs(num_threads);
+  std::latch start(num_threads);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&, t]() {
+      std::mt19937 rng(t);
+      start.arrive_and_wait();
+      for (int i = 0; i < allocs_per_thread; i++) {
+        size_t bytes = 1 + rng() % 200;
+        char *ptr = arena.allocate(bytes);
+        std::fill(ptr, ptr + bytes, static_cast<char>(t));
+        allocs[t].emplace_back(ptr, bytes);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  std::vector<std::pair<char *, size_t>> all;
+  for (int t = 0; t < num_threads; t++) {
+    for (auto &[ptr, bytes] : allocs[t]) {
+      // 其他线程没有写入这段内存
+      EXPECT_TRUE(std::all_of(ptr, ptr + bytes, [t](char c) {
+        return c == static_cast<char>(t);
+      }));
+      EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr) % 8, 0);
+      all.emplace_back(ptr, bytes);
+    }
+  }
+  std::sort(all.begin(), all.end());
+  for (size_t i = 1; i < all.size(); i++) {
+    EXPECT_LE(all[i - 1].first + all[i - 1].second, all[i].first);
+  }
+}
+
 // 测试迭代器
 TEST(SkipListTest, Iterator) {
   SkipList skipList;
@@ -344,8 +416,66 @@ TEST(SkipListTest, TransactionId) {
   EXPECT_EQ((skipList.get("key1", 2).get_value()), "value2");
 }
 
-// ! 现在的实现, 并发的锁由 SkipList 的上层 MemTable 实现, 因此不需要测试
-// SkipList 的并发性
+// 测试多个线程并发插入, 同时有线程无锁读取
+TEST(SkipListTest, ConcurrentPutAndGet) {
+  SkipList skipList;
+  const int num_writers = 4;
+  const int num_operations = 5000; // 每个写线程的插入数
+
+  std::atomic<bool> done{false};
+  std::atomic<int> reader_errors{0};
+  std::thread reader([&]() {
+    while (!done.load()) {
+      // 遍历过程中看到的 key 必须有序, 且已发布的节点的 value 完整
+      std::string prev;
+      for (auto it = skipList.begin(); it != skipList.end(); ++it) {
+        auto key = it.get_key();
+        if (key < prev || it.get_value() != "value_" + key.substr(4)) {
+          reader_errors++;
+        }
+        prev = key;
+      }
+    }
+  });
+
+  std::vector<std::thread> writers;
+  for (int t = 0; t < num_writers; ++t) {
+    writers.emplace_back([&, t]() {
+      for (int i = t; i < num_writers * num_operations; i += num_writers) {
+        std::string id = std::to_string(i);
+        // 同一 key 的不同版本与相同 (key, tranc_id) 的更新交错进行
+        skipList.put("key_" + id, "value_" + id, 1);
+        skipList.put("key_" + id, "value_" + id, 2);
+        skipList.put("key_" + id, "value_" + id, 2);
+      }
+    });
+  }
+  for (auto &w : writers) {
+    w.join();
+  }
+  done = true;
+  reader.join();
+
+  EXPECT_EQ(reader_errors.load(), 0);
+  for (int i = 0; i < num_writers * num_operations; ++i) {
+    std::string id = std::to_string(i);
+    auto it = skipList.get("key_" + id, 1);
+    ASSERT_TRUE(it.is_valid());
+    EXPECT_EQ(it.get_tranc_id(), 1);
+    EXPECT_EQ(skipList.get("key_" + id, 0).get_tranc_id(), 2);
+  }
+  auto data = skipList.flush();
+  EXPECT_EQ(data.size(), 2 * num_writers * num_operations);
+  EXPECT_TRUE(std::is_sorted(
+      data.begin(), data.end(), [](const auto &a, const auto &b) {
+        return std::get<0>(a) < std::get<0>(b) ||
+               (std::get<0>(a) == std::get<0>(b) &&
+                std::get<2>(a) > std::get<2>(b));
+      }));
+}
+
+// ! 跳表支持并发的插入和读取, 但 remove 仍需要上层保证独占访问,
+// ! 因此下面混合插入和删除的并发测试不再适用
 // // 测试跳表的并发性能
 // TEST(SkipListTest, ConcurrentOperations) {
 //   SkipList skipList;
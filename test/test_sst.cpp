@@ -4,6 +4,8 @@
 #include "../include/sst/sst.h"
 #include "../include/sst/sst_iterator.h"
 #include <filesystem>
+#include <iomanip>
+#include <sstream>
 #include <gtest/gtest.h>
 
 using namespace ::tiny_lsm;
@@ -67,6 +69,18 @@ TEST_F(SSTTest, BasicWriteAndRead) {
   auto value = block->get_value_binary("key2", 0);
   EXPECT_TRUE(value.has_value());
   EXPECT_EQ(*value, "value2");
+
+  // 越过末尾和未指向 sst 的迭代器返回空的 key 和 value
+  auto it = sst->begin(0);
+  for (int i = 0; i < 3; i++) {
+    ++it;
+  }
+  EXPECT_TRUE(it.is_end());
+  EXPECT_TRUE(it.key().empty());
+  EXPECT_TRUE(it.value().empty());
+  SstIterator empty_it(nullptr, 0);
+  EXPECT_TRUE(empty_it.key().empty());
+  EXPECT_TRUE(empty_it.value().empty());
 }
 
 // 测试block分裂
@@ -111,6 +125,51 @@ TEST_F(SSTTest, KeySearch) {
   EXPECT_EQ(sst->find_block_idx("key999"), -1);
 }
 
+// 测试点查时布隆过滤器的过滤效果
+TEST_F(SSTTest, BloomFilterGet) {
+  SSTBuilder builder(256, true);
+  for (int i = 0; i < 200; i += 2) {
+    std::ostringstream oss;
+    oss << "key" << std::setw(3) << std::setfill('0') << i;
+    builder.add(oss.str(), "value" + std::to_string(i), 0);
+  }
+  auto block_cache = std::make_shared<BlockCache>(
+      TomlConfig::getInstance().getLsmBlockCacheCapacity(),
+      TomlConfig::getInstance().getLsmBlockCacheK());
+  auto sst = builder.build(1, "test_data/bloom.sst", block_cache);
+
+  // 存在的key一定能通过布隆过滤器并被查到
+  for (int i = 0; i < 200; i += 2) {
+    std::ostringstream oss;
+    oss << "key" << std::setw(3) << std::setfill('0') << i;
+    EXPECT_TRUE(sst->may_contain(oss.str()));
+    auto it = sst->get(oss.str(), 0);
+    ASSERT_TRUE(it.is_valid());
+    EXPECT_EQ(it.value(), "value" + std::to_string(i));
+  }
+
+  // 在key范围内但不存在的key, 大部分应被布隆过滤器直接过滤
+  int rejected = 0;
+  for (int i = 1; i < 200; i += 2) {
+    std::ostringstream oss;
+    oss << "key" << std::setw(3) << std::setfill('0') << i;
+    if (!sst->may_contain(oss.str())) {
+      rejected++;
+    }
+    EXPECT_FALSE(sst->get(oss.str(), 0).is_valid());
+  }
+  EXPECT_GT(rejected, 50);
+
+  // 重新打开后布隆过滤器依然生效
+  auto reopened = SST::open(2, FileObj::open("test_data/bloom.sst", false),
+                            block_cache);
+  for (int i = 1; i < 200; i += 2) {
+    std::ostringstream oss;
+    oss << "key" << std::setw(3) << std::setfill('0') << i;
+    EXPECT_EQ(reopened->may_contain(oss.str()), sst->may_contain(oss.str()));
+  }
+}
+
 // 测试元数据
 TEST_F(SSTTest, Metadata) {
   auto sst = create_test_sst(512, 10);
@@ -149,6 +208,15 @@ TEST_F(SSTTest, ReopenSST) {
   EXPECT_EQ(sst->get_first_key(), reopened_sst->get_first_key());
   EXPECT_EQ(sst->get_last_key(), reopened_sst->get_last_key());
   EXPECT_EQ(sst->num_blocks(), reopened_sst->num_blocks());
+
+  // 常驻的只有栅栏索引和偏移, 完整的元数据按需从文件加载
+  for (size_t i = 0; i < sst->num_blocks(); i++) {
+    auto meta = sst->get_block_meta(i);
+    auto reopened_meta = reopened_sst->get_block_meta(i);
+    EXPECT_EQ(meta.offset, reopened_meta.offset);
+    EXPECT_EQ(meta.first_key, reopened_meta.first_key);
+    EXPECT_EQ(meta.last_key, reopened_meta.last_key);
+  }
 }
 
 // 测试大文件
@@ -240,8 +308,215 @@ TEST_F(SSTTest, LargeSSTPredicate) {
   EXPECT_EQ(iter_end.key(), "key501");
 }
 
+// 测试分区索引和分区布隆过滤器
+TEST_F(SSTTest, PartitionedIndex) {
+  SSTBuilder builder(256, true, 4); // 每个分区 4 个 block
+  for (int i = 0; i < 1000; i += 2) {
+    std::ostringstream oss;
+    oss << "key" << std::setw(4) << std::setfill('0') << i;
+    builder.add(oss.str(), "value" + std::to_string(i), i);
+  }
+  auto block_cache = std::make_shared<BlockCache>(
+      TomlConfig::getInstance().getLsmBlockCacheCapacity(),
+      TomlConfig::getInstance().getLsmBlockCacheK());
+  auto sst = builder.build(1, "test_data/partitioned.sst", block_cache);
+
+  EXPECT_TRUE(sst->is_partitioned());
+  EXPECT_GT(sst->num_blocks(), 4);
+  EXPECT_EQ(sst->get_first_key(), "key0000");
+  EXPECT_EQ(sst->get_last_key(), "key0998");
+  EXPECT_EQ(sst->get_tranc_id_range(), std::make_pair(0UL, 998UL));
+
+  auto reopened = SST::open(2, FileObj::open("test_data/partitioned.sst", false),
+                            block_cache);
+  EXPECT_TRUE(reopened->is_partitioned());
+  EXPECT_EQ(reopened->num_blocks(), sst->num_blocks());
+  EXPECT_EQ(reopened->get_first_key(), "key0000");
+  EXPECT_EQ(reopened->get_last_key(), "key0998");
+
+  for (auto &table : {sst, reopened}) {
+    for (int i = 0; i < 1000; i += 2) {
+      std::ostringstream oss;
+      oss << "key" << std::setw(4) << std::setfill('0') << i;
+      EXPECT_TRUE(table->may_contain(oss.str()));
+      auto it = table->get(oss.str(), 0);
+      ASSERT_TRUE(it.is_valid());
+      EXPECT_EQ(it.value(), "value" + std::to_string(i));
+    }
+
+    int rejected = 0;
+    for (int i = 1; i < 1000; i += 2) {
+      std::ostringstream oss;
+      oss << "key" << std::setw(4) << std::setfill('0') << i;
+      if (!table->may_contain(oss.str())) {
+        rejected++;
+      }
+      EXPECT_FALSE(table->get(oss.str(), 0).is_valid());
+    }
+    EXPECT_GT(rejected, 250);
+    EXPECT_FALSE(table->get("key9999", 0).is_valid());
+    EXPECT_FALSE(table->get("a", 0).is_valid());
+
+    // 顺序遍历
+    int count = 0;
+    for (auto it = table->begin(0); it != table->end(); ++it) {
+      std::ostringstream oss;
+      oss << "key" << std::setw(4) << std::setfill('0') << count * 2;
+      EXPECT_EQ(it.key(), oss.str());
+      count++;
+    }
+    EXPECT_EQ(count, 500);
+
+    // 谓词查询
+    auto result = sst_iters_monotony_predicate(
+        table, 0, [](const std::string &key) {
+          if (key < "key0100") {
+            return 1;
+          }
+          if (key > "key0500") {
+            return -1;
+          }
+          return 0;
+        });
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(result->first.key(), "key0100");
+    EXPECT_EQ(result->second.key(), "key0502");
+  }
+}
+
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
   init_spdlog_file();
   return RUN_ALL_TESTS();
-}
\ No newline at end of file
+}
+TEST_F(SSTTest, PrefixFilter) {
+  auto block_cache = std::make_shared<BlockCache>(
+      TomlConfig::getInstance().getLsmBlockCacheCapacity(),
+      TomlConfig::getInstance().getLsmBlockCacheK());
+
+  // 普通格式和分区格式都会附加前缀过滤器
+  for (size_t partition_blocks : {0, 4}) {
+    std::string path =
+        "test_data/prefix" + std::to_string(partition_blocks) + ".sst";
+    SSTBuilder builder(256, true, partition_blocks);
+    // 偶数编号的 set 才有成员, key 范围横跨所有奇数编号的 set
+    for (int i = 0; i < 100; i += 2) {
+      for (int j = 0; j < 3; j++) {
+        std::string key = "REDIS_SET_user" + std::to_string(i) + "_member" +
+                          std::to_string(j);
+        builder.add(key, "1", 1);
+      }
+    }
+    auto sst = builder.build(1, path, block_cache);
+    auto reopened = SST::open(2, FileObj::open(path, false), block_cache);
+
+    for (auto &table : {sst, reopened}) {
+      for (int i = 0; i < 100; i += 2) {
+        std::string prefix = "REDIS_SET_user" + std::to_string(i) + "_";
+        EXPECT_TRUE(table->may_contain_prefix(prefix));
+        EXPECT_TRUE(table->may_contain_prefix(prefix + "member1"));
+      }
+
+      int rejected = 0;
+      for (int i = 1; i < 100; i += 2) {
+        std::string prefix = "REDIS_SET_user" + std::to_string(i) + "_";
+        if (!table->may_contain_prefix(prefix)) {
+          rejected++;
+        }
+      }
+      EXPECT_GT(rejected, 35);
+
+      // 前缀短于一档长度时无法使用过滤器
+      EXPECT_TRUE(table->may_contain_prefix("RE"));
+      EXPECT_TRUE(table->may_contain_prefix(""));
+    }
+  }
+}
+
+TEST_F(SSTTest, ReadBlocks) {
+  auto sst = create_test_sst(256, 1000);
+  ASSERT_GT(sst->num_blocks(), 8);
+
+  // 不使用 mmap 打开, 未命中的 block 通过并发读取器读取
+  auto block_cache = std::make_shared<BlockCache>(
+      TomlConfig::getInstance().getLsmBlockCacheCapacity(),
+      TomlConfig::getInstance().getLsmBlockCacheK());
+  auto reopened =
+      SST::open(2, FileObj::open("test_data/test.sst", false), block_cache);
+
+  for (auto &table : {sst, reopened}) {
+    std::vector<size_t> block_idxs;
+    for (size_t i = 0; i < table->num_blocks(); i += 2) {
+      block_idxs.push_back(i);
+    }
+    // 第二次读取全部命中缓存
+    for (int round = 0; round < 2; round++) {
+      auto blocks = table->read_blocks(block_idxs);
+      ASSERT_EQ(blocks.size(), block_idxs.size());
+      for (size_t i = 0; i < blocks.size(); i++) {
+        auto expected = table->read_block(block_idxs[i]);
+        ASSERT_NE(blocks[i], nullptr);
+        EXPECT_EQ(blocks[i]->get_first_key(), expected->get_first_key());
+        EXPECT_EQ(blocks[i]->size(), expected->size());
+      }
+    }
+    EXPECT_THROW(table->read_blocks({table->num_blocks()}), std::out_of_range);
+
+    // 批量点查结果与逐个点查一致
+    std::vector<std::string> keys;
+    for (int i = 0; i < 1000; i += 37) {
+      keys.push_back("key" + std::to_string(i));
+    }
+    keys.push_back("key_missing");
+    std::sort(keys.begin(), keys.end());
+    auto results = table->get_batch(keys, 0);
+    for (size_t i = 0; i < keys.size(); i++) {
+      auto it = table->get(keys[i], 0);
+      ASSERT_EQ(results[i].has_value(), it.is_valid()) << keys[i];
+      if (it.is_valid()) {
+        EXPECT_EQ(results[i]->first, it.value());
+      }
+    }
+  }
+}
+
+TEST_F(SSTTest, Readahead) {
+  create_test_sst(256, 1000);
+
+  for (bool fill_cache : {true, false}) {
+    auto block_cache = std::make_shared<BlockCache>(
+        TomlConfig::getInstance().getLsmBlockCacheCapacity(),
+        TomlConfig::getInstance().getLsmBlockCacheK());
+    auto sst =
+        SST::open(2, FileObj::open("test_data/test.sst", false), block_cache);
+    ASSERT_GT(sst->num_blocks(), 8);
+
+    auto it = sst->begin(0);
+    if (!fill_cache) {
+      it.set_readahead(4, false);
+    }
+    std::vector<std::string> keys;
+    for (; it.is_valid(); ++it) {
+      keys.emplace_back(it.key());
+    }
+    ASSERT_EQ(keys.size(), 1000);
+    for (size_t i = 0; i < keys.size(); i++) {
+      EXPECT_EQ(keys[i], "key" + std::to_string(i));
+    }
+
+    // 自适应预读的 block 放入缓存, compaction 式的预读不放入缓存
+    for (size_t i = 1; i < sst->num_blocks(); i++) {
+      EXPECT_EQ(block_cache->get(2, i) != nullptr, fill_cache);
+    }
+
+    // 随机定位后从新位置继续顺序读取
+    it.seek("key500");
+    ASSERT_TRUE(it.is_valid());
+    EXPECT_EQ(it.key(), "key500");
+    size_t count = 0;
+    for (; it.is_valid(); ++it) {
+      count++;
+    }
+    EXPECT_EQ(count, 500);
+  }
+}
@@ -1,9 +1,17 @@
 #include "../include/logger/logger.h"
+#include "../include/utils/async_reader.h"
 #include "../include/utils/bloom_filter.h"
 #include "../include/utils/files.h"
+#include "../include/utils/job_scheduler.h"
+#include "../include/utils/row_cache.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
 #include <filesystem>
+#include <future>
 #include <gtest/gtest.h>
 #include <random>
+#include <thread>
 
 using namespace ::tiny_lsm;
 
@@ -172,6 +180,204 @@ TEST(BloomFilterTest, ComprehensiveTest) {
 #endif
 }
 
+// 测试行缓存的快照可见性, 失效和容量限制
+TEST(RowCacheTest, BasicTest) {
+  RowCache cache(4096, 1);
+  std::optional<std::pair<std::string, uint64_t>> value;
+
+  EXPECT_FALSE(cache.lookup("key1", 0, value));
+  cache.insert("key1", std::make_pair("value1", 10), cache.generation("key1"));
+  cache.insert("key2", std::nullopt, cache.generation("key2"));
+
+  ASSERT_TRUE(cache.lookup("key1", 0, value));
+  EXPECT_EQ(value->first, "value1");
+  ASSERT_TRUE(cache.lookup("key1", 10, value));
+  EXPECT_EQ(value->second, 10);
+  // 快照早于最新版本时不可见
+  EXPECT_FALSE(cache.lookup("key1", 9, value));
+  // 不存在的 key 对所有快照可见
+  ASSERT_TRUE(cache.lookup("key2", 1, value));
+  EXPECT_FALSE(value.has_value());
+
+  // 查询期间发生失效时放弃插入
+  auto generation = cache.generation("key1");
+  cache.invalidate("key1");
+  EXPECT_FALSE(cache.lookup("key1", 0, value));
+  cache.insert("key1", std::make_pair("stale", 10), generation);
+  EXPECT_FALSE(cache.lookup("key1", 0, value));
+
+  // 超出容量时淘汰最久未访问的项
+  for (int i = 0; i < 100; ++i) {
+    std::string key = "key" + std::to_string(i + 10);
+    cache.insert(key, std::make_pair(std::string(100, 'v'), 1),
+                 cache.generation(key));
+  }
+  EXPECT_LE(cache.size_bytes(), 4096);
+  EXPECT_FALSE(cache.lookup("key10", 0, value));
+  EXPECT_TRUE(cache.lookup("key109", 0, value));
+
+  cache.clear();
+  EXPECT_EQ(cache.size_bytes(), 0);
+  EXPECT_FALSE(cache.lookup("key109", 0, value));
+}
+
+TEST(AsyncReaderTest, ReadAll) {
+  std::filesystem::create_directory("test_data");
+  std::vector<uint8_t> content(1 << 16);
+  for (size_t i = 0; i < content.size(); i++) {
+    content[i] = static_cast<uint8_t>(i * 7);
+  }
+  FileObj::create_and_write("test_data/async.dat", content);
+  auto file = FileObj::open("test_data/async.dat", false);
+
+  for (size_t depth : {0, 1, 4}) {
+    AsyncReader reader(depth);
+    EXPECT_EQ(reader.queue_depth(), depth);
+
+    std::vector<ReadRequest> requests;
+    for (size_t offset = 0; offset + 1000 <= content.size(); offset += 999) {
+      requests.push_back({&file, offset, 1000, {}, nullptr});
+    }
+    // 越界读取的错误记录在请求中
+    requests.push_back({&file, content.size() - 10, 100, {}, nullptr});
+    reader.read_all(requests);
+
+    for (size_t i = 0; i + 1 < requests.size(); i++) {
+      auto &req = requests[i];
+      ASSERT_FALSE(req.error);
+      EXPECT_TRUE(std::equal(req.data.begin(), req.data.end(),
+                             content.begin() + req.offset));
+      EXPECT_EQ(req.data.size(), 1000);
+    }
+    EXPECT_TRUE(requests.back().error);
+  }
+  std::filesystem::remove_all("test_data");
+}
+
+TEST(FileObjTest, OpenMmap) {
+  std::filesystem::create_directory("test_data");
+  std::vector<uint8_t> content(4096);
+  for (size_t i = 0; i < content.size(); i++) {
+    content[i] = static_cast<uint8_t>(i);
+  }
+  FileObj::create_and_write("test_data/mmap.dat", content);
+
+  auto file = FileObj::open_mmap("test_data/mmap.dat");
+  EXPECT_TRUE(file.is_mapped());
+  EXPECT_EQ(file.size(), content.size());
+  EXPECT_EQ(file.read_uint8(10), 10);
+  uint32_t expected;
+  memcpy(&expected, content.data() + 100, sizeof(expected));
+  EXPECT_EQ(file.read_uint32(100), expected);
+  EXPECT_EQ(file.read_to_slice(200, 16),
+            std::vector<uint8_t>(content.begin() + 200, content.begin() + 216));
+
+  // 删除文件后映射仍然可以读取
+  file.del_file();
+  EXPECT_FALSE(std::filesystem::exists("test_data/mmap.dat"));
+  EXPECT_EQ(file.read_uint8(20), 20);
+  std::filesystem::remove_all("test_data");
+}
+
+TEST(JobSchedulerTest, PriorityPools) {
+  JobScheduler scheduler(1, 2);
+
+  // 低优先级线程池被占满时, 高优先级任务仍然可以执行
+  std::promise<void> release;
+  auto released = release.get_future().share();
+  std::atomic<int> low_started{0};
+  for (int i = 0; i < 2; i++) {
+    EXPECT_TRUE(scheduler.schedule(JobPriority::LOW, [&, released]() {
+      low_started++;
+      released.wait();
+    }));
+  }
+  std::atomic<int> low_done{0};
+  EXPECT_TRUE(scheduler.schedule(JobPriority::LOW, [&]() { low_done++; }));
+
+  std::promise<void> high_done;
+  EXPECT_TRUE(scheduler.schedule(JobPriority::HIGH,
+                                 [&]() { high_done.set_value(); }));
+  EXPECT_EQ(high_done.get_future().wait_for(std::chrono::seconds(5)),
+            std::future_status::ready);
+  while (low_started.load() < 2) {
+    std::this_thread::yield();
+  }
+  EXPECT_EQ(scheduler.pending(JobPriority::LOW), 1);
+  EXPECT_EQ(low_done.load(), 0);
+
+  release.set_value();
+  scheduler.wait_for_idle();
+  EXPECT_EQ(low_done.load(), 1);
+  EXPECT_EQ(scheduler.pending(JobPriority::LOW), 0);
+}
+
+TEST(JobSchedulerTest, ShutdownCancelsPendingJobs) {
+  JobScheduler scheduler(1, 1);
+
+  std::promise<void> started;
+  std::promise<void> release;
+  auto released = release.get_future().share();
+  std::atomic<bool> running_finished{false};
+  scheduler.schedule(JobPriority::LOW, [&, released]() {
+    started.set_value();
+    released.wait();
+    running_finished = true;
+  });
+  started.get_future().wait();
+
+  // 排在正在执行的任务之后, shutdown 时被丢弃
+  std::atomic<int> cancelled_ran{0};
+  for (int i = 0; i < 10; i++) {
+    scheduler.schedule(JobPriority::LOW, [&]() { cancelled_ran++; });
+  }
+
+  size_t dropped = 0;
+  std::thread closer([&]() { dropped = scheduler.shutdown(); });
+  while (!scheduler.is_shutting_down()) {
+    std::this_thread::yield();
+  }
+  EXPECT_FALSE(scheduler.schedule(JobPriority::HIGH, []() {}));
+  release.set_value();
+  closer.join();
+
+  // shutdown 等待正在执行的任务结束
+  EXPECT_TRUE(running_finished.load());
+  EXPECT_EQ(cancelled_ran.load(), 0);
+  EXPECT_EQ(dropped, 10);
+  EXPECT_EQ(scheduler.pending(JobPriority::LOW), 0);
+}
+
+TEST(JobSchedulerTest, DelayedJobDoesNotHoldThread) {
+  JobScheduler scheduler(1, 1);
+
+  auto start = std::chrono::steady_clock::now();
+  std::promise<std::chrono::steady_clock::time_point> delayed_ran;
+  EXPECT_TRUE(scheduler.schedule_after(
+      JobPriority::HIGH, std::chrono::milliseconds(200),
+      [&]() { delayed_ran.set_value(std::chrono::steady_clock::now()); }));
+
+  // 延迟任务等待期间, 唯一的高优先级线程仍然可以执行其他任务
+  std::promise<void> high_done;
+  EXPECT_TRUE(scheduler.schedule(JobPriority::HIGH,
+                                 [&]() { high_done.set_value(); }));
+  EXPECT_EQ(high_done.get_future().wait_for(std::chrono::milliseconds(100)),
+            std::future_status::ready);
+
+  auto ran_at = delayed_ran.get_future();
+  EXPECT_EQ(ran_at.wait_for(std::chrono::seconds(5)),
+            std::future_status::ready);
+  EXPECT_GE(ran_at.get() - start, std::chrono::milliseconds(200));
+
+  // shutdown 丢弃尚未到期的任务
+  std::atomic<bool> cancelled_ran{false};
+  EXPECT_TRUE(scheduler.schedule_after(JobPriority::LOW,
+                                       std::chrono::seconds(60),
+                                       [&]() { cancelled_ran = true; }));
+  EXPECT_EQ(scheduler.shutdown(), 1);
+  EXPECT_FALSE(cancelled_ran.load());
+}
+
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
   init_spdlog_file();
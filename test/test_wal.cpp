@@ -1,7 +1,11 @@
 #include "../include/logger/logger.h"
+#include "../include/utils/files.h"
+#include "../include/wal/log_writer.h"
 #include "../include/wal/record.h"
 #include "../include/wal/wal.h"
 #include <filesystem>
+#include <mutex>
+#include <thread>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
@@ -18,7 +22,7 @@ public:
   MOCK_METHOD(void, cleanWALFile, ());
   MOCK_METHOD(void, reset_file, ());
 
-  FileObj *get_log_file() { return &log_file_; }
+  LogWriter *get_log_file() { return &log_file_; }
 
   std::vector<Record> &get_log_buffer() { return log_buffer_; }
 
@@ -157,6 +161,184 @@ TEST_F(WALTest, RecoverTest) {
   }
 }
 
+TEST_F(WALTest, GroupCommit) {
+  const int thread_num = 8;
+  const int tranc_per_thread = 50;
+  {
+    WAL wal(test_dir, 1024, 0, 1, 1024 * 1024);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_num; t++) {
+      threads.emplace_back([&wal, t]() {
+        for (int i = 0; i < tranc_per_thread; i++) {
+          uint64_t tranc_id = t * tranc_per_thread + i + 1;
+          auto tranc_str = std::to_string(tranc_id);
+          std::vector<Record> records;
+          records.push_back(Record::createRecord(tranc_id));
+          records.push_back(
+              Record::putRecord(tranc_id, "key" + tranc_str, tranc_str));
+          records.push_back(Record::commitRecord(tranc_id));
+          wal.log(records, true);
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+  }
+
+  // 所有并发提交的事务都完整地落盘
+  auto tranc_records = WAL::recover(test_dir, 0);
+  ASSERT_EQ(tranc_records.size(), thread_num * tranc_per_thread);
+  for (auto &[tranc_id, records] : tranc_records) {
+    ASSERT_EQ(records.size(), 3);
+    auto tranc_str = std::to_string(tranc_id);
+    EXPECT_EQ(records[1],
+              Record::putRecord(tranc_id, "key" + tranc_str, tranc_str));
+  }
+}
+
+TEST_F(WALTest, LogWriterAppend) {
+  auto path = (std::filesystem::path(test_dir) / "writer.log").string();
+  std::vector<uint8_t> small(100, 'a');
+  std::vector<uint8_t> large(200, 'b');
+  {
+    auto writer = LogWriter::open(path, 4096, 128);
+    writer.append(small);
+    // 数据仍在缓冲区中
+    EXPECT_EQ(writer.size(), 100);
+    EXPECT_EQ(std::filesystem::file_size(path), 0);
+
+    // 超过缓冲区容量时先写出缓冲区, 再直接写入
+    writer.append(large);
+    EXPECT_EQ(std::filesystem::file_size(path), 300);
+
+    writer.append(small);
+    EXPECT_TRUE(writer.sync());
+    // 预分配不改变文件的逻辑大小
+    EXPECT_EQ(std::filesystem::file_size(path), 400);
+  }
+
+  // 重新打开后在末尾继续追加
+  {
+    auto writer = LogWriter::open(path, 4096, 128);
+    EXPECT_EQ(writer.size(), 400);
+    writer.append(small);
+  }
+  auto file = FileObj::open(path, false);
+  ASSERT_EQ(file.size(), 500);
+  auto data = file.read_to_slice(0, 500);
+  EXPECT_EQ(data[99], 'a');
+  EXPECT_EQ(data[100], 'b');
+  EXPECT_EQ(data[300], 'a');
+  EXPECT_EQ(data[499], 'a');
+}
+
+TEST_F(WALTest, SegmentRotationAndClean) {
+  auto log_tranc = [](WAL &wal, uint64_t tranc_id) {
+    auto tranc_str = std::to_string(tranc_id);
+    std::vector<Record> records;
+    records.push_back(Record::createRecord(tranc_id));
+    records.push_back(
+        Record::putRecord(tranc_id, "key" + tranc_str, "value" + tranc_str));
+    records.push_back(Record::commitRecord(tranc_id));
+    wal.log(records, true);
+  };
+
+  {
+    WAL wal(test_dir, 1024, 0, 1, 256);
+    for (uint64_t tranc_id = 1; tranc_id <= 20; tranc_id++) {
+      log_tranc(wal, tranc_id);
+    }
+    EXPECT_GT(wal.segment_count(), 1);
+    EXPECT_EQ(WAL::recover(test_dir, 0).size(), 20);
+
+    // 只删除其中事务全部 flush 的段, 活跃段保留
+    auto segment_cnt = wal.segment_count();
+    wal.set_max_flushed_tranc_id(10);
+    wal.clean_flushed_segments();
+    EXPECT_LT(wal.segment_count(), segment_cnt);
+
+    auto tranc_records = WAL::recover(test_dir, 10);
+    ASSERT_EQ(tranc_records.size(), 10);
+    EXPECT_EQ(tranc_records.begin()->first, 11);
+    EXPECT_EQ(tranc_records.rbegin()->first, 20);
+  }
+
+  // 重新打开时写入新的段, 上次留下的段在清理时读取计算最大的 tranc_id
+  {
+    WAL wal(test_dir, 1024, 0, 1, 256);
+    log_tranc(wal, 21);
+    EXPECT_EQ(WAL::recover(test_dir, 10).size(), 11);
+
+    wal.set_max_flushed_tranc_id(20);
+    wal.clean_flushed_segments();
+    EXPECT_EQ(wal.segment_count(), 1);
+    auto tranc_records = WAL::recover(test_dir, 0);
+    ASSERT_EQ(tranc_records.size(), 1);
+    EXPECT_EQ(tranc_records.begin()->first, 21);
+  }
+}
+
+TEST_F(WALTest, StreamingReplay) {
+  {
+    WAL wal(test_dir, 1024, 0, 1, 256);
+    for (uint64_t tranc_id = 1; tranc_id <= 30; tranc_id++) {
+      auto tranc_str = std::to_string(tranc_id);
+      std::vector<Record> records;
+      records.push_back(Record::createRecord(tranc_id));
+      records.push_back(
+          Record::putRecord(tranc_id, "key" + tranc_str, "value" + tranc_str));
+      if (tranc_id % 10 == 0) {
+        // 未提交的事务
+      } else if (tranc_id % 10 == 5) {
+        records.push_back(Record::rollbackRecord(tranc_id));
+      } else {
+        records.push_back(Record::commitRecord(tranc_id));
+      }
+      wal.log(records, true);
+    }
+    EXPECT_GT(wal.segment_count(), 2);
+  }
+
+  // 模拟写入时崩溃, 最后一个段末尾留下不完整的记录
+  std::string last_segment;
+  for (const auto &entry : std::filesystem::directory_iterator(test_dir)) {
+    auto path = entry.path().string();
+    if (last_segment.empty() || path.size() > last_segment.size() ||
+        (path.size() == last_segment.size() && path > last_segment)) {
+      last_segment = path;
+    }
+  }
+  {
+    auto writer = LogWriter::open(last_segment);
+    auto data = Record::commitRecord(30).encode();
+    data.resize(data.size() / 2);
+    writer.append(data);
+  }
+
+  std::mutex mtx;
+  std::map<uint64_t, std::vector<Record>> replayed;
+  WAL::replay(
+      test_dir, 3,
+      [&](uint64_t tranc_id, std::vector<Record> &records) {
+        std::lock_guard<std::mutex> lock(mtx);
+        EXPECT_TRUE(replayed.emplace(tranc_id, std::move(records)).second);
+      },
+      4);
+
+  // 只重放 max_flushed_tranc_id 之后已提交的事务
+  ASSERT_EQ(replayed.size(), 30 - 3 - 3 - 3);
+  for (auto &[tranc_id, records] : replayed) {
+    EXPECT_GT(tranc_id, 3);
+    EXPECT_NE(tranc_id % 10, 0);
+    EXPECT_NE(tranc_id % 10, 5);
+    ASSERT_EQ(records.size(), 3);
+    EXPECT_EQ(records.back().getOperationType(), OperationType::COMMIT);
+  }
+  EXPECT_EQ(WAL::recover(test_dir, 3), replayed);
+}
+
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
   init_spdlog_file();